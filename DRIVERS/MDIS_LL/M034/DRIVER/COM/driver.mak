@@ -38,6 +38,7 @@ MAK_LIBS=$(LIB_PREFIX)$(MEN_LIB_DIR)/desc$(LIB_SUFFIX)  \
 
 
 MAK_INCL=$(MEN_INC_DIR)/m34_drv.h     \
+         $(MEN_INC_DIR)/m34_scan.h    \
          $(MEN_INC_DIR)/men_typs.h    \
          $(MEN_INC_DIR)/oss.h         \
          $(MEN_INC_DIR)/mbuf.h        \
@@ -24,7 +24,7 @@
  *
  *               Interrupt Modes
  *               ---------------
- *               The driver supports four interrupt modes.
+ *               The driver supports six interrupt modes.
  *               The default mode (lagacy irq mode) was the first implemented
  *               mode. It is still available to be compatible to existing
  *               application software. However, this mode wastes some CPU time in
@@ -33,6 +33,9 @@
  *               The fix irq mode is the most efficient mode and requires no external
  *               trigger signal. However, this mode is not so flexible (reads always
  *               all available channels).
+ *
+ *               The timer mode acquires frames paced by a driver timer, the
+ *               burst mode a block of back-to-back conversions of one channel.
  *               
  *               For further information of the interrupt modes, see M34_Init, M34_SetStat
  *               and M34_BlockRead.
@@ -72,47 +75,205 @@
 #include <MEN/ll_defs.h>    /* low level driver definitions   */
 #include <MEN/ll_entry.h>   /* low level driver entry struct  */
 #include <MEN/m34_drv.h>    /* M34 driver header file         */
+#include <MEN/m34_scan.h>   /* register layout, scan sequence */
 
 static const char IdentString[]=MENT_XSTR(MAK_REVISION);
 
 #ifdef WINNT
 	#include <wdm.h>
 #endif
+#if defined(LINUX) && defined(__KERNEL__)
+	#include <linux/ktime.h>	/* fine timestamp */
+	#include <linux/math64.h>	/* 64 bit division */
+	#include <asm/barrier.h>	/* staging ring */
+#endif
 
 /*-----------------------------------------+
 |  TYPEDEFS                                |
 +------------------------------------------*/
-typedef struct
+#define M34_TRACE_RECS		256			/* trace ring size (power of 2) */
+#define M34_LAT_RECS		64			/* latency record ring size */
+#define M34_ID_WORDS		64			/* ID-PROM size (words) */
+
+typedef struct M34_HANDLE_T M34_HANDLE;
+
+/* mode specific isr / block read (see selectModeFkt) */
+typedef int32 (*M34_IRQ_FKT)( M34_HANDLE *m34Hdl );
+typedef int32 (*M34_BLKRD_FKT)( M34_HANDLE *m34Hdl, void *buf, int32 size,
+								int32 *nbrRdBytesP );
+
+struct M34_HANDLE_T
 {
-	MDIS_IDENT_FUNCT_TBL idFuncTbl;						/* id function table */
-    int32           ownMemSize;
-    u_int32         dbgLevel;
-	DBG_HANDLE*		dbgHdl;
-    OSS_HANDLE      *osHdl;         
+	/*
+	 * isr state - the fields M34_Irq and the frame publishing it calls
+	 * (read buffer, async slots, capture history, staging ring, latency
+	 * tracer) use, with a few process context fields of the same
+	 * features. Only the fields of the active mode and features are
+	 * touched by an irq. The large trace and latency rings are at the
+	 * end of the handle.
+	 */
+	M34_IRQ_FKT		irqFkt;							/* mode specific isr */
     MACCESS         ma34;
     MBUF_HANDLE     *inbuf;
-    OSS_IRQ_HANDLE  *irqHdl;
-    u_int32         irqCount;
-    u_int32         useModulId;
-    u_int32         singleEnded;
-    u_int32         nbrOfChannels;
     u_int32         irqIsEnabled;
-    u_int32         nbrCfgCh;
-    u_int16         chBlkRd[M34_SINGLE_ENDED_MAX_CH];   /* read ch in irq and blk read */
-    u_int16         chCtrl[M34_SINGLE_ENDED_MAX_CH];    /* shadow register */
-    u_int32         nbrDummyRd;							/* number of dummy reads in HwBlockRead */
 	u_int32         irqMode;
 	u_int32         isrCurrCh;
-	u_int32         skip;							
 	u_int32         nbrReadCh;
-	u_int32         blkReadReqWords;
-	u_int32         blkReadGotWords;
+    u_int32         nbrCfgCh;
+	u_int32         blkReadReqWords;				/* CHIRQ_AUTO: acquisition target */
+	u_int32         blkReadGotWords;				/* CHIRQ_AUTO: acquired, unconsumed words */
+	u_int32         skip;							
+	u_int32         convPending;					/* FIX: driver started conversion in flight */
+	u_int32         burstIdx;						/* BURST: stored samples */
+	u_int32         burstNbr;						/* BURST: samples to store */
+	u_int32         burstT0;						/* BURST: first sample [M34_TSTAMP] */
+	u_int32         burstT1;						/* BURST: last sample [M34_TSTAMP] */
+    u_int32         irqCount;
+	u_int32         isrTiming;						/* M34_TSTAMP fine enough to time the isr */
+	u_int32         isrStats;						/* isr time statistics (M34_ISR_STATS) */
+	u_int32         adaptOn;						/* adaptive LEGACY/CHIRQ switching */
+	u_int32         adaptCur;						/* current isr strategy (irq mode) */
+	volatile u_int32 adaptReq;						/* requested strategy (switch at frame end) */
+	u_int32         adaptIsrTs;						/* isr time of window [M34_TSTAMP] */
+	volatile u_int32 adaptMark;						/* switch not yet reported to the reader */
+	u_int32         adaptMarkWords;					/* words ready before the switch */
+	u_int32         latSample;						/* latency: every n-th frame (0=off) */
+	u_int32         latFrames;						/* latency: frames since start */
+	volatile u_int32 latState;						/* latency: M34_LAT_ST_XXX */
+	u_int32         latIsrTs;						/* latency: frame start isr entry */
+	u_int32         latSlot;						/* latency: staging slot (or NOSLOT) */
+	u_int32         latAhead;						/* latency: words to read before */
+	M34_LAT_REC     latRec;							/* latency: sample in flight */
+	u_int32			trcMask;						/* enabled trace classes */
+	u_int32         batchFrames;					/* min frames per wakeup (<2: off) */
+	u_int32         batchReady;						/* frames ready, not yet consumed */
+	u_int32         batchFirstTs;					/* tick of oldest ready frame */
+	u_int32         batchSleep;						/* reader sleeps on batchSem */
+	OSS_SEM_HANDLE  *batchSem;						/* batch wakeup */
+	u_int32         rdAvailWords;					/* words ready in read buffer */
+	u_int32         rdLostCh;						/* CHIRQ: lost channels of the next lost frame */
+	u_int32         sigDataArmed;					/* send sigData at next frame */
+	OSS_SIG_HANDLE  *sigData;						/* data ready signal */
+	u_int32         trigLastTs;						/* timestamp of last trigger edge */
+	u_int32         trigPer;						/* period estimate [ts, M34_TRIG_FRAC] */
+	u_int32         trigJit;						/* jitter estimate [ts, M34_TRIG_FRAC] */
+	volatile u_int32 trigLost;						/* no edge within trigLostK periods */
+	u_int32         asyncOn;						/* frames go to async slots */
+	u_int8          *asyncMem;						/* slot pool (nbr x recSize) */
+	u_int32         asyncNbrSlots;					/* slots in pool */
+	u_int32         asyncRecSize;					/* header + slot data [byte] */
+	u_int32         asyncSlotWords;					/* slot data size [words] */
+	u_int32         asyncHead;						/* slot being filled */
+	u_int32         asyncFill;						/* words in slot being filled */
+	u_int32         asyncPosted;					/* submitted slots (incl. head) */
+	u_int32         asyncDone;						/* completed slots not read */
+	u_int32         asyncSeq;						/* next slot sequence number */
+	u_int32         asyncLost;						/* dropped since last slot */
+	u_int32         asyncSleep;						/* reader sleeps on asyncSem */
+	u_int32         captOn;							/* frames go to capture history */
+	u_int16         *captMem;						/* capture history */
+	u_int32         captNbrFrames;					/* history size [frames] */
+	u_int32         captStride;						/* words per frame */
+	u_int32         captWr;							/* frame being written */
+	u_int32         captFill;						/* words in frame being written */
+	u_int32         captState;						/* M34_CAPT_ST_XXX */
+	u_int32         captValid;						/* pre-trigger frames stored */
+	u_int32         captPostLeft;					/* post-trigger frames to collect */
+	u_int32         captTrigIdx;					/* trigger frame */
+	u_int32         captTrigTs;						/* trigger timestamp */
+	u_int32         captPrev;						/* EXT level / level armed */
+	u_int32         captChIdx;						/* level channel in frame */
+	u_int32         captChBip;						/* level channel is bipolar */
+	u_int32         captLost;						/* dropped while record pending */
+	u_int32         captSleep;						/* reader sleeps on captSem */
+	M34_CAPT_CFG    captCfg;						/* trigger config */
+	u_int32         deferMask;						/* M34_DEFER_XXX */
+	u_int32         ntfPending;						/* deferred M34_NTF_XXX */
+	u_int16         *stageMem;						/* staging ring: count + words */
+	u_int32         stageNbr;						/* staging ring size [frames] */
+	u_int32         stageStride;					/* words per staged frame */
+	volatile u_int32 stageWr;						/* next frame written by isr */
+	volatile u_int32 stageRd;						/* next frame published */
+	u_int32         stageBusy;						/* drain running */
+	u_int32         pollOwner;						/* registers owned by user space */
 	u_int16			*buf;
+    u_int8          scanList[M34_SINGLE_ENDED_MAX_CH];  /* block read ch (nbrCfgCh) */
+    u_int16         chCtrl[M34_SINGLE_ENDED_MAX_CH];    /* shadow register */
+    u_int32         chDummyRd[M34_SINGLE_ENDED_MAX_CH]; /* nbrDummyRd + chSettle */
+    u_int32         nbrOfChannels;
+    u_int32         dbgLevel;
+	DBG_HANDLE*		dbgHdl;
 	OSS_SEM_HANDLE  *sem;
+    OSS_HANDLE      *osHdl;         
+	u_int32			trcIdx;							/* next trace record (free running) */
+	M34_TELEMETRY   tele;							/* acquisition statistics */
+
+	/* process context state */
+	M34_BLKRD_FKT	blkRdFkt;						/* mode specific block read */
+	int32			bufMode;						/* M_BUF_RD_MODE */
+	u_int32         inBufSize;						/* read buffer size [byte] */
+	u_int32         inBufDescSize;					/* RD_BUF/SIZE [byte] */
+	u_int32         inBufHighWater;					/* RD_BUF/HIGHWATER [byte] */
+	u_int32         dbgLevelMbuf;					/* DEBUG_LEVEL_MBUF */
+	u_int32         frameAlign;						/* buffer size whole frames */
+	u_int32         rdActive;						/* readers waiting, rdSem released */
+	u_int32         calConv;						/* conversions of last calibration */
+	u_int32         calTicks;						/* duration [M34_TSTAMP] */
+	u_int32         burstRate;						/* sample rate of last burst [Hz] */
+	u_int32         rdRaw;							/* block read returns raw words */
+	u_int32         readAhead;						/* CHIRQ_AUTO: read-ahead blocks */
+	u_int32         batchLatency;					/* max wakeup latency [us] (0: none) */
+	u_int32         rdNonBlock;						/* non-blocking block read */
+	u_int32         asyncTail;						/* oldest completed slot */
+	u_int32         asyncMemSize;					/* allocated pool size */
+	OSS_SEM_HANDLE  *asyncSem;						/* slot completion wakeup */
+	u_int32         captMemWords;					/* capture history [words] */
+	u_int32         captMemSize;					/* allocated history size */
+	u_int32         captSeq;						/* next capture sequence number */
+	OSS_SEM_HANDLE  *captSem;						/* capture record wakeup */
+	OSS_TIM_HANDLE  *deferTimer;					/* deferred stage drain */
+	u_int32         deferRun;						/* drain timer running */
+	u_int32         stageMemSize;					/* allocated staging size */
+	MDIS_IDENT_FUNCT_TBL idFuncTbl;						/* id function table */
+    int32           ownMemSize;
+    OSS_IRQ_HANDLE  *irqHdl;
+    u_int32         useModulId;
+    u_int32         preventBusErr;
+    u_int32         idRead;								/* idData read from the PROM */
+    u_int32         idValid;							/* idData magic ok */
+    u_int32         modId;								/* module id from idData */
+    u_int16         idData[M34_ID_WORDS];				/* ID-PROM cache */
+    u_int32         singleEnded;
+    u_int16         chBlkRd[M34_SINGLE_ENDED_MAX_CH];   /* read ch in irq and blk read */
+    u_int32         nbrDummyRd;							/* number of dummy reads in HwBlockRead */
+    u_int8          chSettle[M34_SINGLE_ENDED_MAX_CH];  /* additional dummy reads per ch */
+	OSS_SEM_HANDLE  *rdSem;							/* block read / acquisition setup */
+	OSS_SEM_HANDLE  *hwSem;							/* process context hw sequences */
+	OSS_TIM_HANDLE  *timer;							/* M34_IMODE_TIMER frame timer */
+	u_int32         sampleRate;						/* requested frame rate [Hz] */
+	u_int32         tmrPeriodMs;					/* timer period [ms] */
+	u_int32         tmrRun;							/* frame timer running */
+	u_int32         tmrLastTs;						/* timestamp of last frame */
+	u_int32         tmrTiming;						/* period statistics (M34_TSTAMP) */
+	OSS_TIM_HANDLE  *trigTimer;						/* trigger loss watchdog */
+	u_int32         trigWdRun;						/* watchdog running */
+	u_int32         trigLostK;						/* lost after k periods (0=off) */
+	OSS_SIG_HANDLE  *sigTrig;						/* trigger lost signal */
+	OSS_TIM_HANDLE  *adaptTimer;					/* adaptive irq mode policy */
+	u_int32         adaptRun;						/* policy timer running */
+	u_int32         adaptWinTs;						/* window start [M34_TSTAMP] */
+	u_int32         adaptIrqCnt;					/* irqCount at window start */
+	u_int32         adaptRateHi;					/* CHIRQ->LEGACY irq rate [Hz] */
+	u_int32         adaptLoadHi;					/* LEGACY->CHIRQ isr load [%] */
 #ifdef WINNT
 	LARGE_INTEGER	isrTicks; /* high-resolution time stamps  */
 #endif
-} M34_HANDLE;
+	M34_TRACE_REC	trcRing[M34_TRACE_RECS];		/* trace ring */
+	u_int32			latRdSeq;						/* latency: block reads since start */
+	u_int32			latIdx;							/* latency: next record (free running) */
+	u_int32			latRd;							/* latency: next record to get */
+	M34_LAT_REC		latRing[M34_LAT_RECS];			/* latency: completed records */
+};
 
 
 /*-----------------------------------------+
@@ -127,24 +288,160 @@ typedef struct
 
 #define M34_DEFAULT_BUF_SIZE	320		/* byte */
 #define M34_DEFAULT_BUF_TIMEOUT 1000	/* ms */
+#define M34_DEFAULT_SAMPLE_RATE	100		/* Hz */
+
+/* read buffer level warning (7/8 of the size) */
+#define M34_RD_WARN_LEVEL(size)	((size) - (size)/8)
+
+/* settle calibration */
+#define M34_CAL_ROUNDS			4		/* channel switches per channel */
+#define M34_CAL_SETTLED			(2*(M34_SETTLE_MAX+1))	/* conversions until settled */
+#define M34_CAL_REF				4		/* settled conversions for reference */
+
+/* burst mode: wait for a burst of n samples [ms] (min 1 kHz) */
+#define M34_BURST_TOUT(n)		(100 + (n))
+
+/*
+ * Byte swapped variant (MAC_BYTESWAP): the isr/scan loops store the raw
+ * bus words, the block read swaps them in one pass (see rdSwap).
+ * Values the driver evaluates itself are converted with M34_RAW2NATIVE.
+ */
+#if defined(MAC_BYTESWAP) && defined(MAC_MEM_MAPPED)
+# define M34_RAW_SWAP			1
+# define M34_RD_RAW16(ma,offs)	(*(volatile u_int16*)((U_INT32_OR_64)(ma)+(offs)))
+# define M34_RAW2NATIVE(w)		OSS_SWAP16(w)
+#else
+# define M34_RAW_SWAP			0
+# define M34_RD_RAW16(ma,offs)	MREAD_D16(ma,offs)
+# define M34_RAW2NATIVE(w)		(w)
+#endif
+#define M34_CONV_RAW(ma)		M34_RD_RAW16( ma, M34_DATA_START_RD )
+
+/* trigger estimate/watchdog (irq mode 0/1) */
+#define M34_TRIG_FRAC			4		/* fraction bits of the estimates */
+#define M34_TRIG_D_MAX			(0xffffffff >> (M34_TRIG_FRAC + 1)) /* max period [ts] */
+#define M34_TRIG_WD_PERIOD		1		/* watchdog check period [ms] */
+#define M34_TRIG_MIN_TS			2		/* min loss timeout [ts] */
+#define M34_TRIG_EST_TS			16		/* min period for the estimates [ts] */
+
+/* latency sample state (M34_LAT_SAMPLE) */
+#define M34_LAT_ST_IDLE			0		/* waiting for the next sampled frame */
+#define M34_LAT_ST_FRAME		1		/* frame converted, not yet ready */
+#define M34_LAT_ST_READY		2		/* frame in the read buffer */
+#define M34_LAT_ST_WAKE			3		/* frame copied by a block read */
+#define M34_LAT_NOSLOT			0xffffffff
+
+/* 64 bit division (no libgcc helpers in 32 bit kernels) */
+#if defined(LINUX) && defined(__KERNEL__)
+# define M34_DIV64(a,b)			div64_u64( (a), (b) )
+#else
+# define M34_DIV64(a,b)			((a) / (b))
+#endif
+
+/* settle calibration, burst: min duration [M34_TSTAMP] for a rate */
+#define M34_RATE_TS_MIN			16
+
+/* isr time statistics: min timestamp frequency [Hz] */
+#define M34_ISR_TSFREQ_MIN		1000000
+
+/* timer period statistics: min timestamp frequency [Hz] */
+#define M34_TMR_TSFREQ_MIN		10000
+
+/* adaptive irq mode (M34_IRQ_ADAPT) */
+#define M34_ADAPT_PERIOD		100		/* policy window [ms] */
+#define M34_ADAPT_LEVEL			50		/* read buffer level for LEGACY [%] */
+#define M34_ADAPT_RATE_DEF		20000	/* default M34_ADAPT_IRQ_RATE [Hz] */
+#define M34_ADAPT_LOAD_DEF		25		/* default M34_ADAPT_ISR_LOAD [%] */
+
+/* deferred stage */
+#define M34_DEFER_PERIOD		1		/* drain timer period [ms] */
+#define M34_NTF_SIGDATA			0x01	/* send data ready signal */
+#define M34_NTF_BATCH			0x02	/* wake batchSem */
+#define M34_NTF_ASYNC			0x04	/* wake asyncSem */
+#define M34_NTF_CAPT			0x08	/* wake captSem */
+
+/* capture state */
+#define M34_CAPT_ST_ARMED		0		/* pre-trigger history, wait for trigger */
+#define M34_CAPT_ST_POST		1		/* collect post-trigger frames */
+#define M34_CAPT_ST_DONE		2		/* record ready for block read */
 
 #define M34_HW_ACCESS_NO         0
 #define M34_HW_ACCESS_PERMITED   1
 
-/*--------------------- M34 register defs/offsets ------------------------*/
-#define M34_DATA_RD           0x00  /* read converted data */
-#define M34_CTRL_WR           0x00  /* set control data  */
-#define M34_DATA_RD_START     0x02  /* read data, start conv. */
-#define M34_CTRL_START_WR     0x02  /* start conv., set control data  */
-#define M34_DATA_RD_START_INC 0x06  /* read data, start conv., incr. */
-#define M34_DATA_START_RD     0x0A  /* start conv., read data */
-#define M34_DATA_START_RD_INC 0x0E  /* start conv., read data */
-#define M34_MODID			  0xFE  /* module id register */
-#define M34_MODID_BUSERBIT	  0x04  /* bit to prevent bus error */
-
-#define CTRL_IRQ			  4		/* bit shifts */
-#define CTRL_GAIN			  5		/* bit shifts */
-#define CTRL_BIPOLAR		  7		/* bit shifts */
+/*
+ * Timestamp source for the trace ring, latency tracer and the time
+ * statistics. Windows uses the performance counter, the Linux kernel
+ * the monotonic clock in 64 ns units (15.625 MHz, wraps after 274 s).
+ * Other builds fall back to the OSS tick counter, a build may define
+ * M34_TSTAMP/M34_TSTAMP_FREQ for a finer clock.
+ * Statistics that need a finer clock than the tick report 0 (unknown)
+ * if M34_TRACE_TSFREQ is below their minimum.
+ */
+#ifndef M34_TSTAMP
+# if defined(WINNT)
+#  define M34_TSTAMP(h)		((u_int32)KeQueryPerformanceCounter(NULL).LowPart)
+# elif defined(LINUX) && defined(__KERNEL__)
+#  define M34_TSTAMP_SHIFT	6
+#  define M34_TSTAMP(h)		((u_int32)(ktime_to_ns(ktime_get()) >> M34_TSTAMP_SHIFT))
+#  define M34_TSTAMP_FREQ(h)	(1000000000UL >> M34_TSTAMP_SHIFT)
+# else
+#  define M34_TSTAMP(h)		OSS_TickGet((h)->osHdl)
+#  define M34_TSTAMP_FREQ(h)	((u_int32)OSS_TickRateGet((h)->osHdl))
+# endif
+#endif
+
+#define M34_TRC_NOCH		  0xffff	/* trace record without channel */
+
+/* write trace record if the event class is enabled */
+#define M34_TRACE(h,ev,ch,a1,a2)										\
+	do {																\
+		if( (h)->trcMask & M34_TEV_CLASS(ev) )							\
+			traceRec( (h), (ev), (u_int32)(ch), (u_int32)(a1), (u_int32)(a2) );\
+	} while(0)
+
+/*
+ * Driver internal locking (see M34_Info LL_INFO_LOCKMODE).
+ * Lock order is rdSem before hwSem. State shared with the isr is
+ * additionally protected by OSS_IrqMaskR()/OSS_IrqRestore().
+ * A block read waiting for data releases rdSem (MBUF_Read, batch, async
+ * and capture waits, see rdSleep) and counts itself in rdActive while it
+ * sleeps.
+ */
+#define M34_LOCK(h,s)		OSS_SemWait( (h)->osHdl, (h)->s, OSS_SEM_WAITINFINITE )
+#define M34_UNLOCK(h,s)		OSS_SemSignal( (h)->osHdl, (h)->s )
+
+/* setStatNeedsRdLock() */
+#define M34_RDLOCK				1		/* take the read lock */
+#define M34_RDLOCK_IDLE			2		/* ... and fail while a reader waits */
+
+/*
+ * Memory barriers of the lock-free staging ring, the isr and the drain
+ * timer may run on different cpus of a weakly ordered SMP system.
+ */
+#if defined(WINNT)
+# define M34_WMB()			KeMemoryBarrier()
+# define M34_RMB()			KeMemoryBarrier()
+# define M34_MB()			KeMemoryBarrier()
+#elif defined(LINUX) && defined(__KERNEL__)
+# define M34_WMB()			smp_wmb()
+# define M34_RMB()			smp_rmb()
+# define M34_MB()			smp_mb()
+#elif defined(__GNUC__)
+# define M34_WMB()			__sync_synchronize()
+# define M34_RMB()			__sync_synchronize()
+# define M34_MB()			__sync_synchronize()
+#else
+# define M34_WMB()			/* single cpu targets */
+# define M34_RMB()
+# define M34_MB()
+#endif
+
+/* isr or frame timer may access the hw */
+#define M34_ACQ_RUNNING(h)	((h)->irqIsEnabled || (h)->tmrRun)
+
+/* acquisition dropped by the read buffer (async/capture count their own) */
+#define M34_RD_LOST(h)		do { if( !(h)->asyncOn && !(h)->captOn )	\
+								 (h)->tele.rdLost++; } while(0)
 
 /* debug setting */
 #define DBG_MYLEVEL			  m34Hdl->dbgLevel
@@ -190,6 +487,84 @@ static int32 getStatBlock
     M_SETGETSTAT_BLOCK *blockStruct
 );
 
+static int32 setStatNeedsRdLock( int32 code );
+static int32 setStatBlock(
+    M34_HANDLE         *m34Hdl,
+    int32              code,
+    M_SETGETSTAT_BLOCK *blockStruct
+);
+static void updDummyRd( M34_HANDLE *m34Hdl );
+static void readIdProm( M34_HANDLE *m34Hdl );
+static int32 idPromGet( M34_HANDLE *m34Hdl );
+static void setBusErrBit( M34_HANDLE *m34Hdl );
+static void multiRead( M34_HANDLE *m34Hdl, M34_MULTI_READ *mrdP, u_int32 nbrRecs );
+static void selectModeFkt( M34_HANDLE *m34Hdl );
+static void updScanList( M34_HANDLE *m34Hdl );
+static void readAheadStop( M34_HANDLE *m34Hdl );
+static void frameReady( M34_HANDLE *m34Hdl );
+static int32 rdSleep( M34_HANDLE *m34Hdl, OSS_SEM_HANDLE *sem, int32 ms );
+static int32 batchWait( M34_HANDLE *m34Hdl );
+static void frameConsumed( M34_HANDLE *m34Hdl, int32 nbrRdBytes );
+static u_int16* sinkGetBuf( M34_HANDLE *m34Hdl, int32 words, int32 *gotsizeP );
+static void sinkReady( M34_HANDLE *m34Hdl );
+static void asyncReset( M34_HANDLE *m34Hdl );
+static int32 blkRdAsync( M34_HANDLE *m34Hdl, void *buf, int32 size, int32 *nbrRdBytesP );
+static void captFrame( M34_HANDLE *m34Hdl );
+static void captArm( M34_HANDLE *m34Hdl );
+static int32 captEnable( M34_HANDLE *m34Hdl );
+static int32 blkRdCapt( M34_HANDLE *m34Hdl, void *buf, int32 size, int32 *nbrRdBytesP );
+static int32 rdBufBusy( M34_HANDLE *m34Hdl );
+static int32 rdBufAlign( M34_HANDLE *m34Hdl );
+static u_int32 settleCalCh( M34_HANDLE *m34Hdl, u_int32 ch, u_int32 prev,
+							u_int32 tol );
+static int32 settleCal( M34_HANDLE *m34Hdl, u_int32 tol );
+static u_int32 settleCalRate( M34_HANDLE *m34Hdl );
+static void notify( M34_HANDLE *m34Hdl, u_int32 what );
+static void notifySend( M34_HANDLE *m34Hdl, u_int32 what );
+static void stageDrain( M34_HANDLE *m34Hdl );
+static void deferTimerFkt( void *arg );
+static int32 deferSet( M34_HANDLE *m34Hdl, u_int32 mask );
+static int32 deferTimerSet( M34_HANDLE *m34Hdl );
+static int32 scanFrame( M34_HANDLE *m34Hdl );
+static u_int32 timerPeriodMs( u_int32 rate );
+static void timerFrame( void *arg );
+static int32 timerStart( M34_HANDLE *m34Hdl );
+static void timerStop( M34_HANDLE *m34Hdl );
+static void trigEdge( M34_HANDLE *m34Hdl );
+static void trigReset( M34_HANDLE *m34Hdl );
+static u_int32 trigUs( M34_HANDLE *m34Hdl, u_int32 val );
+static void trigWdFkt( void *arg );
+static void trigWdSet( M34_HANDLE *m34Hdl );
+static int32 trigLostCheck( M34_HANDLE *m34Hdl, int32 size );
+static void adaptApply( M34_HANDLE *m34Hdl );
+static void adaptFkt( void *arg );
+static void adaptSet( M34_HANDLE *m34Hdl );
+static void latFrame( M34_HANDLE *m34Hdl );
+static void latReady( M34_HANDLE *m34Hdl );
+static void latRead( M34_HANDLE *m34Hdl, int32 nbrRdBytes, u_int32 ts );
+static void latDone( M34_HANDLE *m34Hdl );
+static void latReset( M34_HANDLE *m34Hdl, u_int32 sample );
+static void irqDisable( M34_HANDLE *m34Hdl );
+static int32 irqFix( M34_HANDLE *m34Hdl );
+static int32 irqChIrq( M34_HANDLE *m34Hdl, const int autoIrq );
+static int32 irqChIrqMan( M34_HANDLE *m34Hdl );
+static int32 irqChIrqAuto( M34_HANDLE *m34Hdl );
+static int32 irqLegacy( M34_HANDLE *m34Hdl );
+static int32 irqBurst( M34_HANDLE *m34Hdl );
+static u_int32 burstRate( M34_HANDLE *m34Hdl, u_int32 conv, u_int32 ticks );
+static int32 blkRdBurst( M34_HANDLE *m34Hdl, void *buf, int32 size, int32 *nbrRdBytesP );
+static int32 blkRdBurstPoll( M34_HANDLE *m34Hdl, void *buf, int32 size, int32 *nbrRdBytesP );
+static void rdSwap( M34_HANDLE *m34Hdl, void *buf, u_int32 bytes );
+static int32 blkRdFix( M34_HANDLE *m34Hdl, void *buf, int32 size, int32 *nbrRdBytesP );
+static int32 blkRdUsrCtrl( M34_HANDLE *m34Hdl, void *buf, int32 size, int32 *nbrRdBytesP );
+static int32 blkRdBuf( M34_HANDLE *m34Hdl, void *buf, int32 size, int32 *nbrRdBytesP,
+					   const int chIrq, const int autoIrq );
+static int32 blkRdLegacy( M34_HANDLE *m34Hdl, void *buf, int32 size, int32 *nbrRdBytesP );
+static int32 blkRdChIrq( M34_HANDLE *m34Hdl, void *buf, int32 size, int32 *nbrRdBytesP );
+static int32 blkRdChIrqAuto( M34_HANDLE *m34Hdl, void *buf, int32 size, int32 *nbrRdBytesP );
+static void traceRec( M34_HANDLE *m34Hdl, u_int16 event, u_int32 ch,
+					  u_int32 arg1, u_int32 arg2 );
+static u_int32 traceTsFreq( M34_HANDLE *m34Hdl );
 static void setGain( u_int16 gain, u_int16 *chCtrlP );
 static void setBipolar( u_int16 bipolar, u_int16 *chCtrlP );
 static void setIrqEnable( u_int16 irqEnable, M34_HANDLE *m34Hdl );
@@ -231,8 +606,47 @@ static int32 M34_MemCleanup( M34_HANDLE *m34Hdl )
 {
 int32       retCode;
 
+	if( m34Hdl->timer ){
+		timerStop( m34Hdl );
+		OSS_TimerRemove(m34Hdl->osHdl, &m34Hdl->timer);
+	}
+	if( m34Hdl->adaptTimer ){
+		if( m34Hdl->adaptRun )
+			OSS_TimerStop(m34Hdl->osHdl, m34Hdl->adaptTimer);
+		OSS_TimerRemove(m34Hdl->osHdl, &m34Hdl->adaptTimer);
+	}
+	if( m34Hdl->trigTimer ){
+		if( m34Hdl->trigWdRun )
+			OSS_TimerStop(m34Hdl->osHdl, m34Hdl->trigTimer);
+		OSS_TimerRemove(m34Hdl->osHdl, &m34Hdl->trigTimer);
+	}
+	if( m34Hdl->deferTimer ){
+		if( m34Hdl->deferRun )
+			OSS_TimerStop(m34Hdl->osHdl, m34Hdl->deferTimer);
+		OSS_TimerRemove(m34Hdl->osHdl, &m34Hdl->deferTimer);
+	}
+	if( m34Hdl->stageMem )
+		OSS_MemFree(m34Hdl->osHdl, (int8*)m34Hdl->stageMem, m34Hdl->stageMemSize);
 	if( m34Hdl->sem )
 		OSS_SemRemove(m34Hdl->osHdl, &m34Hdl->sem);
+	if( m34Hdl->rdSem )
+		OSS_SemRemove(m34Hdl->osHdl, &m34Hdl->rdSem);
+	if( m34Hdl->hwSem )
+		OSS_SemRemove(m34Hdl->osHdl, &m34Hdl->hwSem);
+	if( m34Hdl->batchSem )
+		OSS_SemRemove(m34Hdl->osHdl, &m34Hdl->batchSem);
+	if( m34Hdl->sigData )
+		OSS_SigRemove(m34Hdl->osHdl, &m34Hdl->sigData);
+	if( m34Hdl->sigTrig )
+		OSS_SigRemove(m34Hdl->osHdl, &m34Hdl->sigTrig);
+	if( m34Hdl->asyncSem )
+		OSS_SemRemove(m34Hdl->osHdl, &m34Hdl->asyncSem);
+	if( m34Hdl->asyncMem )
+		OSS_MemFree(m34Hdl->osHdl, m34Hdl->asyncMem, m34Hdl->asyncMemSize);
+	if( m34Hdl->captSem )
+		OSS_SemRemove(m34Hdl->osHdl, &m34Hdl->captSem);
+	if( m34Hdl->captMem )
+		OSS_MemFree(m34Hdl->osHdl, (int8*)m34Hdl->captMem, m34Hdl->captMemSize);
 
     /*--------------------------+
     | remove buffer             |
@@ -326,7 +740,10 @@ int32       retCode;
  *                                                   1-no bus error (BI pin
  *                                                     must be connected to GND) 
  *
- *                M34_IRQ_MODE        0    0..3 (M34_IMODE_XXX defines)
+ *                M34_TRACE_MASK      0              0..0xff enabled trace
+ *                                                   classes (M34_TCL_XXX)
+ *
+ *                M34_IRQ_MODE        0    0..5 (M34_IMODE_XXX defines)
  *                                         0-legacy mode
  *                                           read all enabled ch per irq
  *                                           (wastes cpu time in isr)
@@ -340,6 +757,81 @@ int32       retCode;
  *                                           read always all ch per irq (ignores
  *                                           M34_CH_RDBLK_IRQ) without buffer
  *                                           (ignores RD_BUF)
+ *                                         4-timer mode
+ *                                           same as mode 0 but the frames
+ *                                           are started by a driver timer
+ *                                           (no external trigger)
+ *                                         5-burst mode
+ *                                           back-to-back conversions of
+ *                                           the first M34_CH_RDBLK_IRQ ch
+ *                                           without buffer (ignores RD_BUF)
+ *
+ *                M34_SAMPLE_RATE     100            1..1000 frame rate [Hz]
+ *                                                   of timer mode
+ *
+ *                M34_READ_AHEAD      0              0..64 number of blocks
+ *                                                   acquired in advance in
+ *                                                   mode 2 (see BlockRead)
+ *
+ *                M34_BATCH_FRAMES    0              0..max min frames ready
+ *                                                   before a block read is
+ *                                                   woken (0,1: off)
+ *
+ *                M34_BATCH_LATENCY   0              0..10000000 [us] max age
+ *                                                   of the oldest ready frame
+ *                                                   before wakeup (0: none)
+ *
+ *                M34_RD_NONBLOCK     0              0,1 non-blocking buffered
+ *                                                   block read
+ *
+ *                M34_RD_RATE         0              0..100000 expected frame
+ *                                                   rate [Hz] (default: the
+ *                                                   M34_SAMPLE_RATE in mode 4)
+ *
+ *                M34_RD_LATENCY      0              0..10000 max reader
+ *                                                   latency [ms]. If set,
+ *                                                   RD_BUF/SIZE is enlarged to
+ *                                                   hold twice the frames of
+ *                                                   all channels arriving
+ *                                                   within this time (max
+ *                                                   M34_RD_BUF_AUTO_MAX)
+ *
+ *                M34_TRIG_LOST_K     0              0..1000 trigger lost when
+ *                                                   no edge arrives within
+ *                                                   k estimated periods
+ *                                                   (irq mode 0/1, 0: off)
+ *
+ *                M34_IRQ_ADAPT       0              0,1 adaptive switching
+ *                                                   between irq mode 0 and 1
+ *                                                   (see M34_IRQ_ADAPT)
+ *                M34_ADAPT_IRQ_RATE  20000          1..1000000 max irq rate
+ *                                                   [Hz] for mode 1
+ *                M34_ADAPT_ISR_LOAD  25             1..100 isr load [%]
+ *                                                   switching to mode 1
+ *
+ *                M34_ISR_STATS       0              0,1 isr time statistics
+ *                                                   (see M34_ISR_STATS)
+ *
+ *                M34_STAGE_FRAMES    0              0,2..4096 staging ring
+ *                                                   size [frames] for the
+ *                                                   deferred stage
+ *
+ *                M34_DEFER_MASK      0              0..3 work done in the
+ *                                                   deferred stage
+ *                                                   (see M34_DEFER_MASK)
+ *
+ *                M34_FRAME_ALIGN     0              0,1 read buffer size is
+ *                                                   rounded down to whole
+ *                                                   frames (see BlockRead)
+ *
+ *                M34_ASYNC_SLOTS     0              0..64 number of async
+ *                                                   slots (0: no async mode)
+ *                M34_ASYNC_SLOT_SIZE 320            2..65536 slot data size
+ *                                                   in byte (see BlockRead)
+ *
+ *                M34_CAPT_FRAMES     0              0..65536 capture history
+ *                                                   [frames of all channels]
+ *                                                   (0: no capture mode)
  *
  *                RD_BUF/SIZE         320            buffer size in byte
  *                                                   (multiple of 2)
@@ -361,6 +853,11 @@ int32       retCode;
  *                                                   1-read chhannel at
  *                                                     M34_BlockRead/Irq
  *
+ *                CHANNEL_%d/
+ *                 M34_SETTLE         0              0..10 additional dummy
+ *                                                   reads for this channel
+ *                                                   (see M34_SETTLE_CAL)
+ *
  *---------------------------------------------------------------------------
  *  Input......:  descSpec   pointer to descriptor specifier
  *                osHdl      pointer to the os specific structure
@@ -391,20 +888,22 @@ static int32 M34_Init
     u_int32     gotsize;
     DESC_HANDLE *descHdl;
     int         hwAccess;
-    int         modIdMagic;
-    int         modId;
     u_int32     ch;
     u_int32     currCh;
     u_int32     gain;
     u_int32     bipolar;
     u_int32     chBlkRd;
+    u_int32     settle;
     u_int32     inBufferSize;
     u_int32     inBufferTimeout;
     u_int32     mode;
     u_int32     highWater;
     u_int32     dbgLevelDesc;
     u_int32     dbgLevelMbuf;
-	u_int32		preventBusErr;
+    u_int32     asyncSlotSize;
+    u_int32     captFrames;
+    u_int32     rdRate, rdLatency, autoSize;
+    u_int32     stageFrames, deferMask;
 
 
     hwAccess = M34_HW_ACCESS_NO;
@@ -482,7 +981,6 @@ static int32 M34_Init
     m34Hdl->osHdl      = osHdl;
     m34Hdl->ma34       = *ma;
     m34Hdl->irqHdl     = irqHdl;
-    m34Hdl->nbrCfgCh   = 0;
 
 
     /*-------------------------------+
@@ -505,6 +1003,168 @@ static int32 M34_Init
                               "M34_IRQ_MODE",
                               NULL );
     if( retCode != 0 && retCode != ERR_DESC_KEY_NOTFOUND ) goto CLEANUP;
+    retCode = 0;
+
+    /*-------------------------------+
+    |  descriptor - frame rate       |
+    +-------------------------------*/
+    retCode = DESC_GetUInt32( descHdl,
+                              M34_DEFAULT_SAMPLE_RATE,
+                              &m34Hdl->sampleRate,
+                              "M34_SAMPLE_RATE",
+                              NULL );
+    if( retCode != 0 && retCode != ERR_DESC_KEY_NOTFOUND ) goto CLEANUP;
+    retCode = 0;
+
+    if( m34Hdl->sampleRate < 1 || M34_SAMPLE_RATE_MAX < m34Hdl->sampleRate )
+    {
+		DBGWRT_ERR((DBH,"*** LL - M34_Init: M34_SAMPLE_RATE invalid\n"));
+        retCode = ERR_LL_DESC_PARAM;
+        goto CLEANUP;
+    }/*if*/
+
+    /*-------------------------------+
+    |  descriptor - read-ahead       |
+    +-------------------------------*/
+    retCode = DESC_GetUInt32( descHdl,
+                              0,
+                              &m34Hdl->readAhead,
+                              "M34_READ_AHEAD",
+                              NULL );
+    if( retCode != 0 && retCode != ERR_DESC_KEY_NOTFOUND ) goto CLEANUP;
+    retCode = 0;
+
+    if( M34_READ_AHEAD_MAX < m34Hdl->readAhead )
+    {
+		DBGWRT_ERR((DBH,"*** LL - M34_Init: M34_READ_AHEAD invalid\n"));
+        retCode = ERR_LL_DESC_PARAM;
+        goto CLEANUP;
+    }/*if*/
+
+    /*-------------------------------+
+    |  descriptor - wakeup batching  |
+    +-------------------------------*/
+    retCode = DESC_GetUInt32( descHdl,
+                              0,
+                              &m34Hdl->batchFrames,
+                              "M34_BATCH_FRAMES",
+                              NULL );
+    if( retCode != 0 && retCode != ERR_DESC_KEY_NOTFOUND ) goto CLEANUP;
+    retCode = 0;
+
+    retCode = DESC_GetUInt32( descHdl,
+                              0,
+                              &m34Hdl->batchLatency,
+                              "M34_BATCH_LATENCY",
+                              NULL );
+    if( retCode != 0 && retCode != ERR_DESC_KEY_NOTFOUND ) goto CLEANUP;
+    retCode = 0;
+
+    if( M34_BATCH_LATENCY_MAX < m34Hdl->batchLatency )
+    {
+		DBGWRT_ERR((DBH,"*** LL - M34_Init: M34_BATCH_LATENCY invalid\n"));
+        retCode = ERR_LL_DESC_PARAM;
+        goto CLEANUP;
+    }/*if*/
+
+    /*-------------------------------+
+    |  descriptor - trigger loss     |
+    +-------------------------------*/
+    retCode = DESC_GetUInt32( descHdl,
+                              0,
+                              &m34Hdl->trigLostK,
+                              "M34_TRIG_LOST_K",
+                              NULL );
+    if( retCode != 0 && retCode != ERR_DESC_KEY_NOTFOUND ) goto CLEANUP;
+    retCode = 0;
+
+    if( M34_TRIG_LOST_K_MAX < m34Hdl->trigLostK )
+    {
+		DBGWRT_ERR((DBH,"*** LL - M34_Init: M34_TRIG_LOST_K invalid\n"));
+        retCode = ERR_LL_DESC_PARAM;
+        goto CLEANUP;
+    }/*if*/
+
+    /*-------------------------------+
+    |  descriptor - adaptive irq     |
+    +-------------------------------*/
+    retCode = DESC_GetUInt32( descHdl,
+                              0,
+                              &m34Hdl->adaptOn,
+                              "M34_IRQ_ADAPT",
+                              NULL );
+    if( retCode != 0 && retCode != ERR_DESC_KEY_NOTFOUND ) goto CLEANUP;
+
+    retCode = DESC_GetUInt32( descHdl,
+                              M34_ADAPT_RATE_DEF,
+                              &m34Hdl->adaptRateHi,
+                              "M34_ADAPT_IRQ_RATE",
+                              NULL );
+    if( retCode != 0 && retCode != ERR_DESC_KEY_NOTFOUND ) goto CLEANUP;
+
+    retCode = DESC_GetUInt32( descHdl,
+                              M34_ADAPT_LOAD_DEF,
+                              &m34Hdl->adaptLoadHi,
+                              "M34_ADAPT_ISR_LOAD",
+                              NULL );
+    if( retCode != 0 && retCode != ERR_DESC_KEY_NOTFOUND ) goto CLEANUP;
+
+    retCode = DESC_GetUInt32( descHdl,
+                              0,
+                              &m34Hdl->isrStats,
+                              "M34_ISR_STATS",
+                              NULL );
+    if( retCode != 0 && retCode != ERR_DESC_KEY_NOTFOUND ) goto CLEANUP;
+    retCode = 0;
+
+    /* isr time statistics need a timestamp finer than the isr */
+    m34Hdl->isrTiming = (traceTsFreq( m34Hdl ) >= M34_ISR_TSFREQ_MIN);
+
+    if( 1 < m34Hdl->isrStats || (m34Hdl->isrStats && !m34Hdl->isrTiming) )
+    {
+		DBGWRT_ERR((DBH,"*** LL - M34_Init: M34_ISR_STATS invalid\n"));
+        retCode = ERR_LL_DESC_PARAM;
+        goto CLEANUP;
+    }/*if*/
+
+    /* the adaptive policy measures the isr load */
+    if( 1 < m34Hdl->adaptOn || (m34Hdl->adaptOn && !m34Hdl->isrTiming) ||
+        m34Hdl->adaptRateHi < 1 || M34_ADAPT_IRQ_RATE_MAX < m34Hdl->adaptRateHi ||
+        m34Hdl->adaptLoadHi < 1 || 100 < m34Hdl->adaptLoadHi )
+    {
+		DBGWRT_ERR((DBH,"*** LL - M34_Init: M34_IRQ_ADAPT/ADAPT_XXX invalid\n"));
+        retCode = ERR_LL_DESC_PARAM;
+        goto CLEANUP;
+    }/*if*/
+
+    /*-------------------------------+
+    |  descriptor - non-blocking rd  |
+    +-------------------------------*/
+    retCode = DESC_GetUInt32( descHdl,
+                              0,
+                              &m34Hdl->rdNonBlock,
+                              "M34_RD_NONBLOCK",
+                              NULL );
+    if( retCode != 0 && retCode != ERR_DESC_KEY_NOTFOUND ) goto CLEANUP;
+    retCode = 0;
+    m34Hdl->rdNonBlock = m34Hdl->rdNonBlock ? 1 : 0;
+
+    if( M34_IMODE_BURST < m34Hdl->irqMode )
+    {
+		DBGWRT_ERR((DBH,"*** LL - M34_Init: M34_IRQ_MODE invalid\n"));
+        retCode = ERR_LL_DESC_PARAM;
+        goto CLEANUP;
+    }/*if*/
+
+    /*-------------------------------+
+    |  descriptor - trace mask       |
+    +-------------------------------*/
+    retCode = DESC_GetUInt32( descHdl,
+                              0,
+                              &m34Hdl->trcMask,
+                              "M34_TRACE_MASK",
+                              NULL );
+    if( retCode != 0 && retCode != ERR_DESC_KEY_NOTFOUND ) goto CLEANUP;
     retCode = 0;
 
 	/*--------------------------------------------+
@@ -540,6 +1200,47 @@ static int32 M34_Init
     if( retCode != 0 && retCode != ERR_DESC_KEY_NOTFOUND ) goto CLEANUP;
     retCode = 0;
 
+    /* size from expected frame rate and max reader latency */
+    retCode = DESC_GetUInt32( descHdl,
+                              0,
+                              &rdLatency,
+                              "M34_RD_LATENCY",
+                              NULL );
+    if( retCode != 0 && retCode != ERR_DESC_KEY_NOTFOUND ) goto CLEANUP;
+    retCode = DESC_GetUInt32( descHdl,
+                              m34Hdl->irqMode == M34_IMODE_TIMER ?
+                              m34Hdl->sampleRate : 0,
+                              &rdRate,
+                              "M34_RD_RATE",
+                              NULL );
+    if( retCode != 0 && retCode != ERR_DESC_KEY_NOTFOUND ) goto CLEANUP;
+    retCode = 0;
+
+    if( M34_RD_LATENCY_MAX < rdLatency || M34_RD_RATE_MAX < rdRate ||
+        (rdLatency && rdRate == 0) )
+    {
+		DBGWRT_ERR((DBH,"*** LL - M34_Init: M34_RD_LATENCY/RATE invalid\n"));
+        retCode = ERR_LL_DESC_PARAM;
+        goto CLEANUP;
+    }/*if*/
+
+    /* twice the frames of all channels arriving within the latency */
+    if( rdLatency )
+    {
+        autoSize = 2 * ((rdRate * rdLatency + 999) / 1000) *
+                   m34Hdl->nbrOfChannels * M34_CH_WIDTH;
+        if( autoSize > M34_RD_BUF_AUTO_MAX )
+            autoSize = M34_RD_BUF_AUTO_MAX;
+        if( autoSize > inBufferSize )
+            inBufferSize = autoSize;
+        DBGWRT_2((DBH, " RD_BUF/SIZE from %d Hz/%d ms: %d\n",
+                  rdRate, rdLatency, inBufferSize));
+    }/*if*/
+
+    m34Hdl->inBufSize     = inBufferSize;
+    m34Hdl->inBufDescSize = inBufferSize;
+    m34Hdl->tele.rdBufSize = inBufferSize;
+
     retCode = DESC_GetUInt32( descHdl,
                               M_BUF_USRCTRL,
                               &mode,
@@ -563,55 +1264,239 @@ static int32 M34_Init
                               0 );
     if( retCode != 0 && retCode != ERR_DESC_KEY_NOTFOUND ) goto CLEANUP;
     retCode = 0;
+    m34Hdl->inBufHighWater = highWater;
 
-    retCode = MBUF_Create( osHdl, devSem, m34Hdl, inBufferSize,
-                           M34_CH_WIDTH,
-                           mode,
-                           MBUF_RD, highWater, inBufferTimeout,
-                           m34Hdl->irqHdl,
-                           &m34Hdl->inbuf );
+    retCode = DESC_GetUInt32( descHdl,
+                              0,
+                              &m34Hdl->frameAlign,
+                              "M34_FRAME_ALIGN",
+                              NULL );
+    if( retCode != 0 && retCode != ERR_DESC_KEY_NOTFOUND ) goto CLEANUP;
+    retCode = 0;
+
+    if( m34Hdl->frameAlign > 1 )
+    {
+		DBGWRT_ERR((DBH,"*** LL - M34_Init: M34_FRAME_ALIGN invalid\n"));
+        retCode = ERR_LL_DESC_PARAM;
+        goto CLEANUP;
+    }/*if*/
+
+    /*--------------------------+
+    |  driver locks             |
+    +--------------------------*/
+    retCode = OSS_SemCreate( osHdl, OSS_SEM_BIN, 1, &m34Hdl->rdSem );
+    if( retCode ) goto CLEANUP;
+    retCode = OSS_SemCreate( osHdl, OSS_SEM_BIN, 1, &m34Hdl->hwSem );
+    if( retCode ) goto CLEANUP;
+    retCode = OSS_SemCreate( osHdl, OSS_SEM_BIN, 0, &m34Hdl->batchSem );
     if( retCode ) goto CLEANUP;
 
-    /*----------------------------+
-    |  set debug level for MBUF   |
-    +----------------------------*/
-	MBUF_SetStat(
-		m34Hdl->inbuf,
-		NULL,
-		M_BUF_RD_DEBUG_LEVEL,
-		dbgLevelMbuf);
+    /*--------------------------+
+    |  frame timer              |
+    +--------------------------*/
+    retCode = OSS_TimerCreate( osHdl, timerFrame, (void*)m34Hdl, &m34Hdl->timer );
+    if( retCode ) goto CLEANUP;
 
-    /*-------------------+
-    |   current channel  |
-    +-------------------*/
-    currCh = 0;
+    /*--------------------------+
+    |  trigger loss watchdog    |
+    +--------------------------*/
+    retCode = OSS_TimerCreate( osHdl, trigWdFkt, (void*)m34Hdl, &m34Hdl->trigTimer );
+    if( retCode ) goto CLEANUP;
 
-    /*----------------------------+
-    |  descriptor - blk rd | irq  |
-    +----------------------------*/
-    for( ch=0; ch < m34Hdl->nbrOfChannels; ch++ )
-    {
-        retCode = DESC_GetUInt32( descHdl,
-                                  0,
-                                  &chBlkRd,
-                                  "CHANNEL_%d/M34_CH_RDBLK_IRQ",
-                                  ch );
-        if( retCode != 0 && retCode != ERR_DESC_KEY_NOTFOUND ) goto CLEANUP;
-        m34Hdl->chBlkRd[ch] = (u_int16) chBlkRd;
-        if( chBlkRd )
-            m34Hdl->nbrCfgCh++;
-    }/*for*/
+    /*--------------------------+
+    |  adaptive irq mode        |
+    +--------------------------*/
+    retCode = OSS_TimerCreate( osHdl, adaptFkt, (void*)m34Hdl, &m34Hdl->adaptTimer );
+    if( retCode ) goto CLEANUP;
+
+    /*--------------------------+
+    |  deferred stage           |
+    +--------------------------*/
+    retCode = DESC_GetUInt32( descHdl,
+                              0,
+                              &stageFrames,
+                              "M34_STAGE_FRAMES",
+                              NULL );
+    if( retCode != 0 && retCode != ERR_DESC_KEY_NOTFOUND ) goto CLEANUP;
+    retCode = DESC_GetUInt32( descHdl,
+                              0,
+                              &deferMask,
+                              "M34_DEFER_MASK",
+                              NULL );
+    if( retCode != 0 && retCode != ERR_DESC_KEY_NOTFOUND ) goto CLEANUP;
     retCode = 0;
 
-    /*--------------------+
-    |  descriptor - gain  |
-    +--------------------*/
-    for( ch=0; ch < m34Hdl->nbrOfChannels; ch++ )
+    if( M34_STAGE_FRAMES_MAX < stageFrames || stageFrames == 1 ||
+        (deferMask & ~(M34_DEFER_PUBLISH | M34_DEFER_WAKEUP)) ||
+        ((deferMask & M34_DEFER_PUBLISH) && stageFrames == 0) )
     {
-        retCode = DESC_GetUInt32( descHdl,
-                                  M34_GAIN_1,
-                                  &gain,
-                                  "CHANNEL_%d/M34_GAIN",
+		DBGWRT_ERR((DBH,"*** LL - M34_Init: M34_STAGE_FRAMES/DEFER_MASK invalid\n"));
+        retCode = ERR_LL_DESC_PARAM;
+        goto CLEANUP;
+    }/*if*/
+
+    retCode = OSS_TimerCreate( osHdl, deferTimerFkt, (void*)m34Hdl,
+                               &m34Hdl->deferTimer );
+    if( retCode ) goto CLEANUP;
+
+    /* frame count + values of all channels per staged frame */
+    if( stageFrames )
+    {
+        m34Hdl->stageNbr    = stageFrames;
+        m34Hdl->stageStride = m34Hdl->nbrOfChannels + 1;
+        m34Hdl->stageMem = (u_int16*)OSS_MemGet( osHdl,
+                            stageFrames * m34Hdl->stageStride * M34_CH_WIDTH,
+                            &m34Hdl->stageMemSize );
+        if( m34Hdl->stageMem == NULL )
+        {
+            retCode = ERR_OSS_MEM_ALLOC;
+            goto CLEANUP;
+        }/*if*/
+    }/*if*/
+
+    /*--------------------------+
+    |  async slot pool          |
+    +--------------------------*/
+    retCode = DESC_GetUInt32( descHdl,
+                              0,
+                              &m34Hdl->asyncNbrSlots,
+                              "M34_ASYNC_SLOTS",
+                              NULL );
+    if( retCode != 0 && retCode != ERR_DESC_KEY_NOTFOUND ) goto CLEANUP;
+
+    retCode = DESC_GetUInt32( descHdl,
+                              M34_DEFAULT_BUF_SIZE,
+                              &asyncSlotSize,
+                              "M34_ASYNC_SLOT_SIZE",
+                              NULL );
+    if( retCode != 0 && retCode != ERR_DESC_KEY_NOTFOUND ) goto CLEANUP;
+    retCode = 0;
+
+    if( M34_ASYNC_SLOTS_MAX < m34Hdl->asyncNbrSlots ||
+        asyncSlotSize < M34_CH_WIDTH || M34_ASYNC_SLOT_SIZE_MAX < asyncSlotSize )
+    {
+		DBGWRT_ERR((DBH,"*** LL - M34_Init: M34_ASYNC_SLOTS/SLOT_SIZE invalid\n"));
+        retCode = ERR_LL_DESC_PARAM;
+        goto CLEANUP;
+    }/*if*/
+
+    retCode = OSS_SemCreate( osHdl, OSS_SEM_BIN, 0, &m34Hdl->asyncSem );
+    if( retCode ) goto CLEANUP;
+
+    if( m34Hdl->asyncNbrSlots )
+    {
+        m34Hdl->asyncSlotWords = asyncSlotSize / M34_CH_WIDTH;
+        m34Hdl->asyncRecSize   = sizeof(M34_ASYNC_HDR) +
+                                 m34Hdl->asyncSlotWords * M34_CH_WIDTH;
+        m34Hdl->asyncMem = (u_int8*)OSS_MemGet( osHdl,
+                            m34Hdl->asyncNbrSlots * m34Hdl->asyncRecSize,
+                            &m34Hdl->asyncMemSize );
+        if( m34Hdl->asyncMem == NULL )
+        {
+            retCode = ERR_OSS_MEM_ALLOC;
+            goto CLEANUP;
+        }/*if*/
+    }/*if*/
+
+    /*--------------------------+
+    |  capture history          |
+    +--------------------------*/
+    retCode = DESC_GetUInt32( descHdl,
+                              0,
+                              &captFrames,
+                              "M34_CAPT_FRAMES",
+                              NULL );
+    if( retCode != 0 && retCode != ERR_DESC_KEY_NOTFOUND ) goto CLEANUP;
+    retCode = 0;
+
+    if( M34_CAPT_FRAMES_MAX < captFrames )
+    {
+		DBGWRT_ERR((DBH,"*** LL - M34_Init: M34_CAPT_FRAMES invalid\n"));
+        retCode = ERR_LL_DESC_PARAM;
+        goto CLEANUP;
+    }/*if*/
+
+    retCode = OSS_SemCreate( osHdl, OSS_SEM_BIN, 0, &m34Hdl->captSem );
+    if( retCode ) goto CLEANUP;
+
+    /* room for captFrames frames of all channels */
+    if( captFrames )
+    {
+        m34Hdl->captMemWords = captFrames * m34Hdl->nbrOfChannels;
+        m34Hdl->captMem = (u_int16*)OSS_MemGet( osHdl,
+                            m34Hdl->captMemWords * M34_CH_WIDTH,
+                            &m34Hdl->captMemSize );
+        if( m34Hdl->captMem == NULL )
+        {
+            retCode = ERR_OSS_MEM_ALLOC;
+            goto CLEANUP;
+        }/*if*/
+    }/*if*/
+
+    /* MBUF releases rdSem while waiting for data */
+    retCode = MBUF_Create( osHdl, m34Hdl->rdSem, m34Hdl, inBufferSize,
+                           M34_CH_WIDTH,
+                           mode,
+                           MBUF_RD, highWater, inBufferTimeout,
+                           m34Hdl->irqHdl,
+                           &m34Hdl->inbuf );
+    if( retCode ) goto CLEANUP;
+
+    /*----------------------------+
+    |  set debug level for MBUF   |
+    +----------------------------*/
+	MBUF_SetStat(
+		m34Hdl->inbuf,
+		NULL,
+		M_BUF_RD_DEBUG_LEVEL,
+		dbgLevelMbuf);
+	m34Hdl->dbgLevelMbuf = dbgLevelMbuf;
+
+    /*-------------------+
+    |   current channel  |
+    +-------------------*/
+    currCh = 0;
+
+    /*----------------------------+
+    |  descriptor - blk rd | irq  |
+    +----------------------------*/
+    for( ch=0; ch < m34Hdl->nbrOfChannels; ch++ )
+    {
+        retCode = DESC_GetUInt32( descHdl,
+                                  0,
+                                  &chBlkRd,
+                                  "CHANNEL_%d/M34_CH_RDBLK_IRQ",
+                                  ch );
+        if( retCode != 0 && retCode != ERR_DESC_KEY_NOTFOUND ) goto CLEANUP;
+        m34Hdl->chBlkRd[ch] = (u_int16) chBlkRd;
+    }/*for*/
+    retCode = 0;
+    updScanList( m34Hdl );
+
+    /* size read buffer in whole frames of the configured channels */
+    retCode = rdBufAlign( m34Hdl );
+    if( retCode ) goto CLEANUP;
+
+    /*--------------------------------+
+    |  isr/block read for irq/buffer  |
+    +--------------------------------*/
+    if( MBUF_GetBufferMode( m34Hdl->inbuf, &m34Hdl->bufMode ) )
+        m34Hdl->bufMode = M_BUF_USRCTRL;
+    selectModeFkt( m34Hdl );
+
+    /* deferred stage (descriptor checked above) */
+    retCode = deferSet( m34Hdl, deferMask );
+    if( retCode ) goto CLEANUP;
+
+    /*--------------------+
+    |  descriptor - gain  |
+    +--------------------*/
+    for( ch=0; ch < m34Hdl->nbrOfChannels; ch++ )
+    {
+        retCode = DESC_GetUInt32( descHdl,
+                                  M34_GAIN_1,
+                                  &gain,
+                                  "CHANNEL_%d/M34_GAIN",
                                   ch );
         if( retCode != 0 && retCode != ERR_DESC_KEY_NOTFOUND ) goto CLEANUP;
 
@@ -645,8 +1530,28 @@ static int32 M34_Init
         setBipolar( (u_int16)bipolar, &m34Hdl->chCtrl[ch] );
     }/*for*/
     retCode = 0;
-    if( retCode != 0 && retCode != ERR_DESC_KEY_NOTFOUND ) goto CLEANUP;
+
+    /*----------------------------+
+    |  descriptor - settle count  |
+    +----------------------------*/
+    for( ch=0; ch < m34Hdl->nbrOfChannels; ch++ )
+    {
+        retCode = DESC_GetUInt32( descHdl,
+                                  0,
+                                  &settle,
+                                  "CHANNEL_%d/M34_SETTLE",
+                                  ch );
+        if( retCode != 0 && retCode != ERR_DESC_KEY_NOTFOUND ) goto CLEANUP;
+        if( M34_SETTLE_MAX < settle ) /* not Valid */
+        {
+			DBGWRT_ERR((DBH,"*** LL - M34_Init: M34_SETTLE for ch %d invalid\n", ch));
+            retCode = ERR_LL_DESC_PARAM;
+            goto CLEANUP;
+        }/*if*/
+        m34Hdl->chSettle[ch] = (u_int8)settle;
+    }/*for*/
     retCode = 0;
+    updDummyRd( m34Hdl );
 
     /*-------------------------------------+
     |  descriptor - use module id ?        |
@@ -660,18 +1565,33 @@ static int32 M34_Init
     retCode = 0;
 
 
+    /*--------------------------------+
+    |  descriptor - prevent bus error |
+    +--------------------------------*/
+    retCode = DESC_GetUInt32( descHdl,
+                              0,
+                              &m34Hdl->preventBusErr,
+                              "M34_PREVENT_BUSERR",
+                              NULL );
+    if ( retCode != 0 && retCode != ERR_DESC_KEY_NOTFOUND ) goto CLEANUP;
+    retCode = 0;
+
+    /*--------------------------------+
+    |  read and check ID-PROM         |
+    |  (else read on first use)       |
+    +--------------------------------*/
     if( m34Hdl->useModulId != 0 )
     {
-        modIdMagic = m_read((U_INT32_OR_64)m34Hdl->ma34, 0);
-        modId      = m_read((U_INT32_OR_64)m34Hdl->ma34, 1);
-        if( modIdMagic != MOD_ID_MAGIC_WORD )
+        readIdProm( m34Hdl );
+
+        if( !m34Hdl->idValid )
         {
 			 DBGWRT_ERR((DBH,"*** LL - M34_Init: illegal magic id\n"));
              retCode = ERR_LL_ILL_ID;
              goto CLEANUP;
         }/*if*/
 
-        if( (modId != M34_MOD_ID) && (modId != M34_MOD_ID_M35 ) )
+        if( (m34Hdl->modId != M34_MOD_ID) && (m34Hdl->modId != M34_MOD_ID_M35 ) )
         {
 			 DBGWRT_ERR((DBH,"*** LL - M34_Init: illegal module id\n"));
              retCode = ERR_LL_ILL_ID;
@@ -679,17 +1599,6 @@ static int32 M34_Init
         }/*if*/
     }/*if*/
 
-    /*--------------------------------+
-    |  descriptor - prevent bus error |
-    +--------------------------------*/
-    retCode = DESC_GetUInt32( descHdl,
-                              0,
-                              &preventBusErr,
-                              "M34_PREVENT_BUSERR",
-                              NULL );
-    if ( retCode != 0 && retCode != ERR_DESC_KEY_NOTFOUND ) goto CLEANUP;
-    retCode = 0;
-
 	retCode = OSS_SemCreate(osHdl, OSS_SEM_BIN, 0, &m34Hdl->sem);
 	if (retCode)
 		goto CLEANUP;
@@ -700,14 +1609,7 @@ static int32 M34_Init
     hwAccess = M34_HW_ACCESS_PERMITED;
     MWRITE_D16( m34Hdl->ma34, M34_CTRL_WR, m34Hdl->chCtrl[currCh] );
 
-    if (preventBusErr) { 
-		/* set the bit that prevent the bus error */
-		MSETMASK_D16( m34Hdl->ma34, M34_MODID, M34_MODID_BUSERBIT );
-	}
-	else {
-		/* clear the bit that prevent the bus error */
-		MCLRMASK_D16( m34Hdl->ma34, M34_MODID, M34_MODID_BUSERBIT );
-	}
+    setBusErrBit( m34Hdl );
 
     DESC_Exit( &descHdl );
     return( retCode );
@@ -753,6 +1655,7 @@ static int32 M34_Exit
     /*--------------------------+
     | def values / disable irq  |
     +--------------------------*/
+    timerStop( m34Hdl );
     MWRITE_D16( m34Hdl->ma34, M34_CTRL_WR, 0 );
 
     retCode = M34_MemCleanup( m34Hdl );
@@ -802,12 +1705,25 @@ static int32 M34_Read
     M34_HANDLE*       m34Hdl = (M34_HANDLE*) llHdl;
     u_int16 dummy;
     u_int16 dummy2;
+    int32   error;
 
 
     DBGWRT_1((DBH, "LL - M34_Read: from ch=%d\n",ch));
 
-    if( m34Hdl->irqIsEnabled )
+    if( (error = M34_LOCK( m34Hdl, hwSem )) )
+       return( error );
+
+    if( M34_ACQ_RUNNING( m34Hdl ) )
+    {
+       M34_UNLOCK( m34Hdl, hwSem );
        return( ERR_LL_READ );        /* can't read ! */
+    }
+
+    if( m34Hdl->pollOwner )
+    {
+       M34_UNLOCK( m34Hdl, hwSem );
+       return( ERR_LL_DEV_BUSY );    /* registers owned by user space */
+    }
 
     /*--------------------+
     |  set current ch     |
@@ -821,6 +1737,10 @@ static int32 M34_Read
     dummy2  = MREAD_D16( m34Hdl->ma34, M34_DATA_START_RD ); /* conversion */
     *valueP = dummy2;
 
+    M34_UNLOCK( m34Hdl, hwSem );
+
+    M34_TRACE( m34Hdl, M34_TEV_READ, ch, dummy2, 0 );
+
     return(0);
 }/*M34_Read*/
 
@@ -865,6 +1785,16 @@ static int32 M34_Write
  *  M_LL_CH_DIR       all      M_CH_IN     direction of current channel
  *
  *  M_LL_IRQ_COUNT    all      0..max      interrupt counter
+ *                                         (also resets the isr time
+ *                                         statistics, M34_TELEMETRY)
+ *
+ *  M34_ISR_STATS     all      0,1         1 - time each irq into the
+ *                                         M34_TELEMETRY isr statistics
+ *                                         (two timestamps per irq, off
+ *                                         by default). Resets them.
+ *                                         ERR_LL_ILL_FUNC if the trace
+ *                                         timestamp is slower than
+ *                                         1 MHz.
  *
  *  M_MK_IRQ_ENABLE   all      0,1         irq mode M34_IMODE_LEGACY/_CHIRQ:
  *                                          0 - disables module interrupt
@@ -890,7 +1820,160 @@ static int32 M34_Write
  *
  *  M34_DUMMY_READS   all      0..10       additional dummy reads in BlkRd/Irq
  *
- *  M34_IRQ_MODE      all      0..3       interrupt mode (see M34_Init)
+ *  M34_IRQ_MODE      all      0..5        interrupt mode (see M34_Init)
+ *                                         Stops a running acquisition:
+ *                                         module irq disabled, frame
+ *                                         timer stopped (restart with
+ *                                         M_MK_IRQ_ENABLE)
+ *
+ *  M34_SAMPLE_RATE   all      1..1000     timer mode frame rate [Hz]
+ *                                         (rounded to the OSS timer ms
+ *                                         resolution, see getstat)
+ *
+ *  M34_READ_AHEAD    all      0..64       blocks acquired in advance in
+ *                                         M34_IMODE_CHIRQ_AUTO
+ *
+ *  M34_BATCH_FRAMES  all      0..max      min ready frames before a
+ *                                         buffered block read is woken
+ *                                         (0,1: off, see M34_BlockRead)
+ *
+ *  M34_BATCH_LATENCY all      0..1e7      max age [us] of the oldest ready
+ *                                         frame before wakeup (0: none)
+ *
+ *  M34_RD_NONBLOCK   all      0,1         1 - buffered block reads return
+ *                                         at once with the ready frames
+ *                                         (0 bytes if none)
+ *
+ *  M34_SIG_DATA_SET  all      signal      install data ready signal, sent
+ *                                         when the read buffer becomes
+ *                                         non-empty (re-armed when a read
+ *                                         drains it)
+ *
+ *  M34_SIG_DATA_CLR  all      -           remove data ready signal
+ *
+ *  M34_TRIG_LOST_K   all      0..1000     trigger lost when no edge
+ *                                         arrives within k estimated
+ *                                         periods (irq mode 0/1, 0: off)
+ *
+ *  M34_SIG_TRIG_SET  all      signal      install trigger lost signal
+ *
+ *  M34_SIG_TRIG_CLR  all      -           remove trigger lost signal
+ *
+ *  M34_IRQ_ADAPT     all      0,1         1 - switch adaptively between
+ *                                         irq mode 0 (one irq per frame)
+ *                                         and 1 (one irq per channel)
+ *                                         while irq mode 0/1 is set.
+ *                                         Each irq is one trigger edge in
+ *                                         both modes: mode 1 keeps the irq
+ *                                         rate, shortens the isr and
+ *                                         divides the frame rate by the
+ *                                         number of block read channels.
+ *                                         Each M34_ADAPT_PERIOD ms window:
+ *                                         mode 0 -> 1 if the isr load is
+ *                                           >= M34_ADAPT_ISR_LOAD, the irq
+ *                                           rate is below 3/4
+ *                                           M34_ADAPT_IRQ_RATE and the
+ *                                           read buffer is below half of
+ *                                           M34_ADAPT_LEVEL
+ *                                         mode 1 -> 0 if the irq rate is
+ *                                           >= M34_ADAPT_IRQ_RATE or the
+ *                                           load of mode 0 (isr load *
+ *                                           channels) would stay below
+ *                                           half of M34_ADAPT_ISR_LOAD
+ *                                         The isr switches at the end of a
+ *                                         frame. A buffered block read
+ *                                         returns the frames before the
+ *                                         switch, then fails once with
+ *                                         M34_ERR_IRQ_ADAPT. The switches
+ *                                         are counted in M34_BLK_TELEMETRY.
+ *                                         Needs the fine timestamp (else
+ *                                         ERR_LL_ILL_FUNC).
+ *                                         0 - back to the set irq mode at
+ *                                         the next frame end
+ *
+ *  M34_ADAPT_IRQ_RATE all     1..1e6      max irq rate [Hz] for mode 1
+ *
+ *  M34_ADAPT_ISR_LOAD all     1..100      isr load [%] for mode 0 -> 1
+ *
+ *  M34_ASYNC_ENABLE  all      0,1         1 - store frames into the async
+ *                                         slots instead of the read buffer
+ *                                         (needs M34_ASYNC_SLOTS, not in
+ *                                         irq mode 2/3/5, see BlockRead)
+ *
+ *  M34_ASYNC_SUBMIT  all      1..free     submit free slots for filling
+ *
+ *  M34_DEFER_MASK    all      0..3        work moved from the isr to the
+ *                                         deferred stage (drain timer and
+ *                                         block read entry, the 1 ms drain
+ *                                         timer runs only while the
+ *                                         acquisition is running):
+ *                                         M34_DEFER_PUBLISH - irq mode 0/4
+ *                                           frames are staged raw, copied
+ *                                           to the read buffer/slots/capture
+ *                                           with all bookkeeping later
+ *                                           (needs M34_STAGE_FRAMES, change
+ *                                           only with acquisition stopped)
+ *                                         M34_DEFER_WAKEUP - reader wakeups
+ *                                           and data ready signal
+ *
+ *  M34_SETTLE_CAL    all      1..0xffff   calibrate the channel settle
+ *                                         counts, value is the tolerance
+ *                                         [raw 16-bit units] (acquisition
+ *                                         stopped, see settleCal)
+ *
+ *  M34_RD_LEVEL_MAX  all      -           reset read buffer high-water
+ *                                         mark, warning and lost count
+ *
+ *  M34_FRAME_ALIGN   all      0,1         1 - recreate the read buffer with
+ *                                         RD_BUF/SIZE rounded down to whole
+ *                                         frames (acquisition stopped, data
+ *                                         and highwater signal are lost)
+ *
+ *  M34_CAPT_ENABLE   all      0,1         1 - store frames into the capture
+ *                                         history and arm the trigger
+ *                                         (needs M34_CAPT_FRAMES, not in
+ *                                         irq mode 2/3/5, see BlockRead)
+ *
+ *  M34_BLK_CAPT_CFG  -        -           set capture trigger config
+ *                                         (see setStatBlock)
+ *
+ *  M34_TRACE_MASK    all      0..0xff     enabled trace classes (M34_TCL_XXX)
+ *
+ *  M34_TRACE_CLEAR   all      -           discard all trace records
+ *
+ *  M34_LAT_SAMPLE    all      0..max      trace the latency of every n-th
+ *                                         frame (irq mode 0/1/2/4 read
+ *                                         buffer, see BlockRead), 0=off.
+ *                                         Restarts the frame and block
+ *                                         read count and discards the
+ *                                         latency records.
+ *                                         ERR_LL_ILL_FUNC if the trace
+ *                                         timestamp is slower than
+ *                                         M34_LAT_TSFREQ_MIN.
+ *
+ *  M34_ID_REFRESH    all      -           re-read the ID-PROM into the
+ *                                         driver cache (see M_LL_BLK_ID_DATA)
+ *
+ *  M34_POLL_OWNER    all      0,1         1 - hand the registers over to
+ *                                         user space (busy-poll scan, see
+ *                                         m34_scan.h), acquisition must be
+ *                                         stopped. Until released with 0,
+ *                                         reads, block reads and all other
+ *                                         setstats (except trace) return
+ *                                         ERR_LL_DEV_BUSY
+ *
+ *  M34_RD_RAW        all      0,1         1 - block reads return the raw
+ *                                         bus words, the application
+ *                                         converts them (M34_RAW_SWAPPED,
+ *                                         M34_SWAP16X2)
+ *
+ *  M34_BLK_CH_CFG    -        -           set channel config table
+ *                                         (see setStatBlock)
+ *
+ *                Setstats changing the acquisition setup wait for a
+ *                running block read; while a block read waits for data
+ *                most of them fail with ERR_LL_DEV_BUSY (see M34_Info
+ *                LL_INFO_LOCKMODE).
  *
  *---------------------------------------------------------------------------
  *  Input......:  llHdl             pointer to low-level driver data structure
@@ -914,9 +1997,43 @@ static int32 M34_SetStat
 {
     M34_HANDLE *m34Hdl = (M34_HANDLE*) llHdl;
     int32       value  = (int32) value32_or_64;
+    int32       error  = 0;
+    int32       rdLock;
+    OSS_IRQ_STATE irqState;
+    OSS_SIG_HANDLE *sigHdl;
 
     DBGWRT_1((DBH, "LL - M34_SetStat: code=$%04lx, ch=%d, data=%ld\n",code,ch,value));
+    M34_TRACE( m34Hdl, M34_TEV_SETSTAT, ch, code, value );
 
+    /*----------------------------------------------+
+    |  setstats changing the acquisition setup      |
+    |  wait for a pending block read                |
+    +----------------------------------------------*/
+    rdLock = setStatNeedsRdLock( code );
+    if( rdLock && (error = M34_LOCK( m34Hdl, rdSem )) )
+        return( error );
+
+    if( (error = M34_LOCK( m34Hdl, hwSem )) )
+    {
+        if( rdLock )
+            M34_UNLOCK( m34Hdl, rdSem );
+        return( error );
+    }
+
+    /*----------------------------------------------+
+    |  registers owned by user space:               |
+    |  only ownership and trace setup               |
+    +----------------------------------------------*/
+    if( m34Hdl->pollOwner && code != M34_POLL_OWNER &&
+        code != M34_TRACE_MASK && code != M34_TRACE_CLEAR )
+        error = ERR_LL_DEV_BUSY;
+    /*----------------------------------------------+
+    |  a reader sleeping with the read lock         |
+    |  released relies on the current setup         |
+    +----------------------------------------------*/
+    else if( rdLock == M34_RDLOCK_IDLE && m34Hdl->rdActive )
+        error = ERR_LL_DEV_BUSY;
+    else
     switch(code)
     {
         /* ------ common setstat codes --------- */
@@ -929,12 +2046,38 @@ static int32 M34_SetStat
 			if ((m34Hdl->irqMode == M34_IMODE_LEGACY) ||
 				(m34Hdl->irqMode == M34_IMODE_CHIRQ)) {
 
+				irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+				if (value && !m34Hdl->irqIsEnabled) {
+					trigReset( m34Hdl );
+					/* start with the set irq mode */
+					selectModeFkt( m34Hdl );
+					m34Hdl->tele.adaptMode     = m34Hdl->irqMode;
+					m34Hdl->tele.adaptSwitches = 0;
+					m34Hdl->adaptMark          = 0;
+				}
 				setIrqEnable( (u_int16)(value == 0 ? 0 : 1), m34Hdl );
 
 				m34Hdl->isrCurrCh = 0;
 				m34Hdl->nbrReadCh = 0;
 				MWRITE_D16( m34Hdl->ma34, M34_CTRL_WR, m34Hdl->chCtrl[ch] );
+				OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+
+				/* trigger loss watchdog, adaptive irq mode */
+				trigWdSet( m34Hdl );
+				adaptSet( m34Hdl );
+			}
+
+			/* timer mode: start/stop frame timer */
+			if (m34Hdl->irqMode == M34_IMODE_TIMER) {
+				if (value)
+					error = timerStart( m34Hdl );
+				else
+					timerStop( m34Hdl );
 			}
+
+			/* deferred stage drain timer */
+			if (!error)
+				error = deferTimerSet( m34Hdl );
           break;
 
         /*------------------+
@@ -942,14 +2085,19 @@ static int32 M34_SetStat
         +------------------*/
         case M_LL_CH_DIR:
             if( value != M_CH_IN )
-                return( ERR_LL_ILL_DIR );
+                error = ERR_LL_ILL_DIR;
             break;
 
         /*------------------+
         |  irq count        |
         +------------------*/
         case M_LL_IRQ_COUNT:
+            irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
             m34Hdl->irqCount = value;
+            m34Hdl->tele.isrCount   = 0;
+            m34Hdl->tele.isrTime    = 0;
+            m34Hdl->tele.isrTimeMax = 0;
+            OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
             break;
 
         /*------------------+
@@ -959,6 +2107,59 @@ static int32 M34_SetStat
             m34Hdl->dbgLevel = value;
             break;
 
+        /*------------------+
+        |  trace mask       |
+        +------------------*/
+        case M34_TRACE_MASK:
+            m34Hdl->trcMask = value;
+            break;
+
+        /*------------------+
+        |  trace clear      |
+        +------------------*/
+        case M34_TRACE_CLEAR:
+            m34Hdl->trcIdx = 0;
+            break;
+
+        /*------------------+
+        |  latency tracer   |
+        +------------------*/
+        case M34_LAT_SAMPLE:
+            /* stages are a few us: tick clock can't resolve them */
+            if( value && traceTsFreq( m34Hdl ) < M34_LAT_TSFREQ_MIN ) {
+                error = ERR_LL_ILL_FUNC;
+                break;
+            }
+            latReset( m34Hdl, (u_int32)value );
+            break;
+
+        /*------------------+
+        |  isr statistics   |
+        +------------------*/
+        case M34_ISR_STATS:
+            if( value != 0 && value != 1 ) {
+                error = ERR_LL_ILL_PARAM;
+                break;
+            }
+            if( value && !m34Hdl->isrTiming ) {
+                error = ERR_LL_ILL_FUNC;
+                break;
+            }
+            irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+            m34Hdl->isrStats        = value;
+            m34Hdl->tele.isrCount   = 0;
+            m34Hdl->tele.isrTime    = 0;
+            m34Hdl->tele.isrTimeMax = 0;
+            OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+            break;
+
+        /*------------------+
+        |  ID-PROM cache    |
+        +------------------*/
+        case M34_ID_REFRESH:
+            readIdProm( m34Hdl );
+            setBusErrBit( m34Hdl );
+            break;
 
 
         /* ------ special setstat codes --------- */
@@ -968,14 +2169,14 @@ static int32 M34_SetStat
         case M34_CH_GAIN:
           if( value < M34_GAIN_1 || M34_GAIN_8 < value ) /* not Valid */
           {
-                return( ERR_LL_ILL_PARAM );
+                error = ERR_LL_ILL_PARAM;
+                break;
           }
-          else            /* valid */
-          {
-              setGain( (u_int16) value, &m34Hdl->chCtrl[ch] );
-          }/*if*/
 
+          irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+          setGain( (u_int16) value, &m34Hdl->chCtrl[ch] );
           MWRITE_D16( m34Hdl->ma34, M34_CTRL_WR, m34Hdl->chCtrl[ch] );
+          OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
           break;
 
 
@@ -986,14 +2187,14 @@ static int32 M34_SetStat
           if( value != M34_BIPOLAR &&
               value != M34_UNIPOLAR ) /* not Valid */
           {
-                return( ERR_LL_ILL_PARAM );
+                error = ERR_LL_ILL_PARAM;
+                break;
           }
-          else            /* valid */
-          {
-              setBipolar( (u_int16) value, &m34Hdl->chCtrl[ch] );
-          }/*if*/
 
+          irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+          setBipolar( (u_int16) value, &m34Hdl->chCtrl[ch] );
           MWRITE_D16( m34Hdl->ma34, M34_CTRL_WR, m34Hdl->chCtrl[ch] );
+          OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
           break;
 
         /*------------------+
@@ -1002,13 +2203,24 @@ static int32 M34_SetStat
         case M34_CH_RDBLK_IRQ:
 		  if ( (value < 0) || (value > 1) )
 		  {
-			return( ERR_LL_ILL_PARAM );
+			error = ERR_LL_ILL_PARAM;
+			break;
+		  }
+		  /* capture history/aligned buffer depend on the frame layout */
+		  if ( m34Hdl->chBlkRd[ch] != (u_int16)value &&
+			   (m34Hdl->captOn || rdBufBusy( m34Hdl )) )
+		  {
+			error = ERR_LL_DEV_BUSY;
+			break;
 		  }
 		  if ( m34Hdl->chBlkRd[ch] != (u_int16)value )
 		  {
-			/* update number of configured channels */
-			value ? m34Hdl->nbrCfgCh++ : m34Hdl->nbrCfgCh--;
+			irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+			/* update configured channels */
 			m34Hdl->chBlkRd[ch] = (u_int16)value;
+			updScanList( m34Hdl );
+			OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+			error = rdBufAlign( m34Hdl );
 		  }
           break;
 
@@ -1018,11 +2230,14 @@ static int32 M34_SetStat
         case M34_DUMMY_READS:
           if( value < 0 || 10 < value ) /* not Valid */
           {
-              return( ERR_LL_ILL_PARAM );
+              error = ERR_LL_ILL_PARAM;
           }
           else            /* valid */
           {
+              irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
               m34Hdl->nbrDummyRd = value;
+              updDummyRd( m34Hdl );
+              OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
           }/*if*/
           break;
 
@@ -1030,61 +2245,459 @@ static int32 M34_SetStat
 		|  fast irq mode    |
 		+------------------*/
 		case M34_IRQ_MODE:
-			if ((value < 0) || (value > 3))
+			if ((value < 0) || (value > M34_IMODE_BURST))
+			{
+				error = ERR_LL_ILL_PARAM;
+			}
+			/* async slots/capture are only filled in the irq/timer paced modes */
+			else if ((m34Hdl->asyncOn || m34Hdl->captOn) &&
+					 ((value == M34_IMODE_CHIRQ_AUTO) || (value == M34_IMODE_FIX) ||
+					  (value == M34_IMODE_BURST)))
 			{
-				return(ERR_LL_ILL_PARAM);
+				error = ERR_LL_DEV_BUSY;
 			}
 			else            /* valid */
 			{
+				if (value != M34_IMODE_TIMER)
+					timerStop( m34Hdl );
+
+				irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+				if ((m34Hdl->irqMode == M34_IMODE_CHIRQ_AUTO) ||
+					(value == M34_IMODE_CHIRQ_AUTO))
+					readAheadStop( m34Hdl );
+				/* no irq of the old mode may reach the new mode's isr */
+				if (m34Hdl->irqIsEnabled)
+					irqDisable( m34Hdl );
 				m34Hdl->irqMode = value;
+				selectModeFkt( m34Hdl );
+				OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+				trigWdSet( m34Hdl );
+				adaptSet( m34Hdl );
+				deferTimerSet( m34Hdl );
 			}/*if*/
 			break;
 
-        /*--------------------+
-        |  (unknown)          |
-        +--------------------*/
-        default:
-            if(    ( M_RDBUF_OF <= code && code <= (M_WRBUF_OF+0x0f) )
-                || ( M_RDBUF_BLK_OF <= code && code <= (M_RDBUF_BLK_OF+0x0f) )
-              )
-                return( MBUF_SetStat( m34Hdl->inbuf,
-                                      NULL,
-                                      code,
-                                      value ) );
+		/*------------------+
+		|  read-ahead       |
+		+------------------*/
+		case M34_READ_AHEAD:
+			if ((value < 0) || (value > M34_READ_AHEAD_MAX))
+			{
+				error = ERR_LL_ILL_PARAM;
+				break;
+			}
+			/* used by the next block read */
+			m34Hdl->readAhead = value;
+			break;
 
-            return(ERR_LL_UNK_CODE);
-    }/*switch*/
+		/*------------------+
+		|  wakeup batching  |
+		+------------------*/
+		case M34_BATCH_FRAMES:
+			if (value < 0)
+			{
+				error = ERR_LL_ILL_PARAM;
+				break;
+			}
+			irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+			m34Hdl->batchFrames = value;
+			m34Hdl->batchReady  = 0;
+			OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+			break;
 
-    return(0);
-}/*M34_SetStat*/
+		case M34_BATCH_LATENCY:
+			if ((value < 0) || (value > M34_BATCH_LATENCY_MAX))
+			{
+				error = ERR_LL_ILL_PARAM;
+				break;
+			}
+			m34Hdl->batchLatency = value;
+			break;
 
-/****************************** M34_GetStat **********************************
- *
- *  Description:  Changes the device state.
- *
- *  COMMON CODES       CH       VALUES       MEANING
- *  -------------------------------------------------------------------------
- *  M_LL_CH_NUMBER      -       16/8         number of channels
- *
- *  M_LL_CH_DIR         -       M_CH_IN      direction of curr ch
- *
- *  M_LL_CH_LEN         -       16           channel length in bit
- *
- *  M_LL_CH_TYP         -       M_CH_ANALOG  channel type
- *
- *  M_LL_IRQ_COUNT      -       0..max       interrupt counter
- *
- *  M_LL_ID_CHECK       -       0,1          1 - check EEPROM-Id from module
- *                                               in init
- *
- *  M_LL_DEBUG_LEVEL    -       see dbg.h    current debug level of the
- *                                           low-level driver
- *
- *  M_LL_ID_SIZE		-		128			 eeprom size [bytes]	
- *
- *  M_LL_BLK_ID_DATA    -                    read the M-Module ID from EEPROM
- *   ((M_SETGETSTAT_BLOCK*)valueP)->size     number of bytes to read
- *   ((M_SETGETSTAT_BLOCK*)valueP)->data     user buffer for the ID data
+		/*------------------+
+		|  non-blocking rd  |
+		+------------------*/
+		case M34_RD_NONBLOCK:
+			if ((value < 0) || (value > 1))
+			{
+				error = ERR_LL_ILL_PARAM;
+				break;
+			}
+			m34Hdl->rdNonBlock = value;
+			break;
+
+		/*------------------+
+		|  data ready sig   |
+		+------------------*/
+		case M34_SIG_DATA_SET:
+			if (m34Hdl->sigData)
+			{
+				error = ERR_OSS_BUSY_RESOURCE;
+				break;
+			}
+			if ((error = OSS_SigCreate(m34Hdl->osHdl, value, &sigHdl)))
+				break;
+
+			/* data already ready: signal at once */
+			irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+			m34Hdl->sigData      = sigHdl;
+			m34Hdl->sigDataArmed = 1;
+			if (m34Hdl->nbrCfgCh && m34Hdl->rdAvailWords >= m34Hdl->nbrCfgCh) {
+				m34Hdl->sigDataArmed = 0;
+				OSS_SigSend( m34Hdl->osHdl, m34Hdl->sigData );
+			}
+			OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+			break;
+
+		case M34_SIG_DATA_CLR:
+			if (m34Hdl->sigData == NULL)
+			{
+				error = ERR_LL_ILL_PARAM;
+				break;
+			}
+			irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+			sigHdl               = m34Hdl->sigData;
+			m34Hdl->sigData      = NULL;
+			m34Hdl->sigDataArmed = 0;
+			OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+			error = OSS_SigRemove(m34Hdl->osHdl, &sigHdl);
+			break;
+
+		/*------------------+
+		|  trigger loss     |
+		+------------------*/
+		case M34_TRIG_LOST_K:
+			if ((value < 0) || (value > M34_TRIG_LOST_K_MAX))
+			{
+				error = ERR_LL_ILL_PARAM;
+				break;
+			}
+			irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+			m34Hdl->trigLostK = value;
+			m34Hdl->trigLost  = 0;
+			OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+			trigWdSet( m34Hdl );
+			break;
+
+		case M34_SIG_TRIG_SET:
+			if (m34Hdl->sigTrig)
+			{
+				error = ERR_OSS_BUSY_RESOURCE;
+				break;
+			}
+			if ((error = OSS_SigCreate(m34Hdl->osHdl, value, &sigHdl)))
+				break;
+			irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+			m34Hdl->sigTrig = sigHdl;
+			OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+			break;
+
+		case M34_SIG_TRIG_CLR:
+			if (m34Hdl->sigTrig == NULL)
+			{
+				error = ERR_LL_ILL_PARAM;
+				break;
+			}
+			irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+			sigHdl          = m34Hdl->sigTrig;
+			m34Hdl->sigTrig = NULL;
+			OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+			error = OSS_SigRemove(m34Hdl->osHdl, &sigHdl);
+			break;
+
+		/*------------------+
+		|  adaptive irq     |
+		+------------------*/
+		case M34_IRQ_ADAPT:
+			if ((value != 0) && (value != 1))
+			{
+				error = ERR_LL_ILL_PARAM;
+				break;
+			}
+			/* isr load can't be measured with a coarse timestamp */
+			if (value && !m34Hdl->isrTiming)
+			{
+				error = ERR_LL_ILL_FUNC;
+				break;
+			}
+			m34Hdl->adaptOn = value;
+			adaptSet( m34Hdl );
+			break;
+
+		case M34_ADAPT_IRQ_RATE:
+			if ((value < 1) || (value > M34_ADAPT_IRQ_RATE_MAX))
+			{
+				error = ERR_LL_ILL_PARAM;
+				break;
+			}
+			m34Hdl->adaptRateHi = value;
+			break;
+
+		case M34_ADAPT_ISR_LOAD:
+			if ((value < 1) || (value > 100))
+			{
+				error = ERR_LL_ILL_PARAM;
+				break;
+			}
+			m34Hdl->adaptLoadHi = value;
+			break;
+
+		/*------------------+
+		|  async slots      |
+		+------------------*/
+		case M34_ASYNC_ENABLE:
+			if ((value < 0) || (value > 1))
+			{
+				error = ERR_LL_ILL_PARAM;
+				break;
+			}
+			/* pool for one frame required, irq/timer must pace the acquisition */
+			if (value && m34Hdl->captOn)
+			{
+				error = ERR_LL_DEV_BUSY;
+				break;
+			}
+			if (value && (m34Hdl->asyncNbrSlots == 0 ||
+						  m34Hdl->asyncSlotWords < m34Hdl->nbrCfgCh ||
+						  m34Hdl->irqMode == M34_IMODE_CHIRQ_AUTO ||
+						  m34Hdl->irqMode == M34_IMODE_FIX ||
+						  m34Hdl->irqMode == M34_IMODE_BURST))
+			{
+				error = ERR_LL_ILL_PARAM;
+				break;
+			}
+			irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+			asyncReset( m34Hdl );
+			m34Hdl->asyncOn = value;
+			selectModeFkt( m34Hdl );
+			OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+			break;
+
+		/*------------------+
+		|  deferred stage   |
+		+------------------*/
+		case M34_DEFER_MASK:
+			if ((value < 0) || (value & ~(M34_DEFER_PUBLISH | M34_DEFER_WAKEUP)) ||
+				((value & M34_DEFER_PUBLISH) && m34Hdl->stageMem == NULL))
+			{
+				error = ERR_LL_ILL_PARAM;
+				break;
+			}
+			/* frames must not be split between isr and stage */
+			if (((value ^ m34Hdl->deferMask) & M34_DEFER_PUBLISH) &&
+				M34_ACQ_RUNNING(m34Hdl))
+			{
+				error = ERR_LL_DEV_BUSY;
+				break;
+			}
+			error = deferSet( m34Hdl, (u_int32)value );
+			break;
+
+		/*------------------+
+		|  settle calib.    |
+		+------------------*/
+		case M34_SETTLE_CAL:
+			if ((value < 1) || (value > 0xffff))
+			{
+				error = ERR_LL_ILL_PARAM;
+				break;
+			}
+			error = settleCal( m34Hdl, (u_int32)value );
+			break;
+
+		/*------------------+
+		|  register owner   |
+		+------------------*/
+		case M34_POLL_OWNER:
+			if ((value != 0) && (value != 1))
+			{
+				error = ERR_LL_ILL_PARAM;
+				break;
+			}
+			if (value && M34_ACQ_RUNNING(m34Hdl))
+			{
+				error = ERR_LL_DEV_BUSY;
+				break;
+			}
+			/* given back: restore the control register */
+			if (!value && m34Hdl->pollOwner)
+				MWRITE_D16( m34Hdl->ma34, M34_CTRL_WR, m34Hdl->chCtrl[0] );
+			m34Hdl->pollOwner = value;
+			break;
+
+		/*------------------+
+		|  raw block read   |
+		+------------------*/
+		case M34_RD_RAW:
+			if ((value != 0) && (value != 1))
+			{
+				error = ERR_LL_ILL_PARAM;
+				break;
+			}
+			m34Hdl->rdRaw = value;
+			break;
+
+		/*------------------+
+		|  buffer level     |
+		+------------------*/
+		case M34_RD_LEVEL_MAX:
+			irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+			m34Hdl->tele.rdLevelMax  = 0;
+			m34Hdl->tele.rdLevelWarn = 0;
+			m34Hdl->tele.rdLost      = 0;
+			m34Hdl->rdLostCh         = 0;
+			OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+			break;
+
+		/*------------------+
+		|  frame alignment  |
+		+------------------*/
+		case M34_FRAME_ALIGN:
+			if ((value < 0) || (value > 1))
+			{
+				error = ERR_LL_ILL_PARAM;
+				break;
+			}
+			if (value == 0) {
+				/* buffer keeps its size, isr splits frames again */
+				m34Hdl->frameAlign = 0;
+				break;
+			}
+			m34Hdl->frameAlign = 1;
+			if ((error = rdBufAlign( m34Hdl )))
+				m34Hdl->frameAlign = 0;
+			break;
+
+		/*------------------+
+		|  capture          |
+		+------------------*/
+		case M34_CAPT_ENABLE:
+			if ((value < 0) || (value > 1))
+			{
+				error = ERR_LL_ILL_PARAM;
+				break;
+			}
+			if (value) {
+				error = captEnable( m34Hdl );
+				break;
+			}
+			irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+			m34Hdl->captOn = 0;
+			selectModeFkt( m34Hdl );
+			if (m34Hdl->captSleep) {
+				m34Hdl->captSleep = 0;
+				OSS_SemSignal( m34Hdl->osHdl, m34Hdl->captSem );
+			}
+			OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+			break;
+
+		case M34_ASYNC_SUBMIT:
+			irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+			if ((value < 1) || ((u_int32)value > m34Hdl->asyncNbrSlots -
+								m34Hdl->asyncPosted - m34Hdl->asyncDone))
+				error = ERR_LL_ILL_PARAM;
+			else
+				m34Hdl->asyncPosted += value;
+			OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+			break;
+
+		/*------------------+
+		|  frame rate       |
+		+------------------*/
+		case M34_SAMPLE_RATE:
+			if ((value < 1) || (value > M34_SAMPLE_RATE_MAX))
+			{
+				error = ERR_LL_ILL_PARAM;
+				break;
+			}
+			m34Hdl->sampleRate = value;
+
+			/* running: restart with new period */
+			if (m34Hdl->tmrRun) {
+				timerStop( m34Hdl );
+				error = timerStart( m34Hdl );
+			}
+			break;
+
+        /*--------------------+
+        |  (unknown)          |
+        +--------------------*/
+        default:
+            if( M_DEV_BLK_OF <= code && code <= (M_DEV_BLK_OF+0xff) )
+            {
+                error = setStatBlock( m34Hdl, code,
+                                      (M_SETGETSTAT_BLOCK*) value32_or_64 );
+                break;
+            }
+
+            if(    ( M_RDBUF_OF <= code && code <= (M_WRBUF_OF+0x0f) )
+                || ( M_RDBUF_BLK_OF <= code && code <= (M_RDBUF_BLK_OF+0x0f) )
+              )
+            {
+                /* acquired words no longer match the buffer contents */
+                irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+                if( m34Hdl->irqMode == M34_IMODE_CHIRQ_AUTO )
+                    readAheadStop( m34Hdl );
+                m34Hdl->batchReady   = 0;
+                m34Hdl->rdAvailWords = 0;
+                m34Hdl->adaptMarkWords = 0;
+                m34Hdl->sigDataArmed = m34Hdl->sigData ? 1 : 0;
+                OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+
+                error = MBUF_SetStat( m34Hdl->inbuf,
+                                      NULL,
+                                      code,
+                                      value );
+
+                /* buffer mode changed: select block read */
+                if( !error && code == M_BUF_RD_MODE )
+                {
+                    if( MBUF_GetBufferMode( m34Hdl->inbuf, &m34Hdl->bufMode ) )
+                        m34Hdl->bufMode = M_BUF_USRCTRL;
+                    irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+                    selectModeFkt( m34Hdl );
+                    OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+                }
+                break;
+            }
+
+            error = ERR_LL_UNK_CODE;
+    }/*switch*/
+
+    M34_UNLOCK( m34Hdl, hwSem );
+    if( rdLock )
+        M34_UNLOCK( m34Hdl, rdSem );
+
+    return( error );
+}/*M34_SetStat*/
+
+/****************************** M34_GetStat **********************************
+ *
+ *  Description:  Changes the device state.
+ *
+ *  COMMON CODES       CH       VALUES       MEANING
+ *  -------------------------------------------------------------------------
+ *  M_LL_CH_NUMBER      -       16/8         number of channels
+ *
+ *  M_LL_CH_DIR         -       M_CH_IN      direction of curr ch
+ *
+ *  M_LL_CH_LEN         -       16           channel length in bit
+ *
+ *  M_LL_CH_TYP         -       M_CH_ANALOG  channel type
+ *
+ *  M_LL_IRQ_COUNT      -       0..max       interrupt counter
+ *
+ *  M_LL_ID_CHECK       -       0,1          1 - check EEPROM-Id from module
+ *                                               in init
+ *
+ *  M_LL_DEBUG_LEVEL    -       see dbg.h    current debug level of the
+ *                                           low-level driver
+ *
+ *  M_LL_ID_SIZE		-		128			 eeprom size [bytes]	
+ *
+ *  M_LL_BLK_ID_DATA    -                    read the M-Module ID from EEPROM
+ *   ((M_SETGETSTAT_BLOCK*)valueP)->size     number of bytes to read
+ *   ((M_SETGETSTAT_BLOCK*)valueP)->data     user buffer for the ID data
  *
  *  M_MK_BLK_REV_ID     -       -            pointer to ident function table
  *
@@ -1120,7 +2733,111 @@ static int32 M34_SetStat
  *  M34_DUMMY_READS     all      0..10       additional dummy reads in
  *                                           M34_BlockRead/Irq
  *
- *  M34_IRQ_MODE        all      0..3        interrupt mode (see M34_Init)                                           
+ *  M34_IRQ_MODE        all      0..5        interrupt mode (see M34_Init)                                           
+ *
+ *  M34_TRACE_MASK      all      0..0xff     enabled trace classes (M34_TCL_XXX)
+ *
+ *  M34_TRACE_TSFREQ    all      0..max      trace timestamp frequency [Hz]
+ *
+ *  M34_LAT_SAMPLE      all      0..max      latency sampled frames (0=off)
+ *
+ *  M34_ISR_STATS       all      0,1         isr time statistics enabled
+ *
+ *  M34_LAT_TSTAMP      all      0..max      current timestamp (application
+ *                                           side stamp, see M34_LAT_REC)
+ *                                           (0 = unknown)
+ *
+ *  M34_RESOLUTION      all      12,14       ADC resolution from ID-PROM
+ *                                           12 - M34, 14 - M35
+ *                                           (ERR_LL_ILL_ID if unknown)
+ *
+ *  M34_BLK_TRACE       -                    read trace ring (see getStatBlock)
+ *
+ *  M34_BLK_CH_CFG      -                    get channel config table
+ *                                           (see getStatBlock)
+ *
+ *  M34_BLK_MULTI_READ  -                    read list of channels
+ *                                           (see getStatBlock)
+ *
+ *  M34_SAMPLE_RATE     all      1..1000     effective timer mode frame
+ *                                           rate [Hz]
+ *
+ *  M34_READ_AHEAD      all      0..64       blocks acquired in advance in
+ *                                           M34_IMODE_CHIRQ_AUTO
+ *
+ *  M34_BATCH_FRAMES    all      0..max      min ready frames per wakeup
+ *
+ *  M34_BATCH_LATENCY   all      0..1e7      max wakeup latency [us]
+ *
+ *  M34_RD_NONBLOCK     all      0,1         non-blocking block read
+ *
+ *  M34_TRIG_LOST_K     all      0..1000     trigger lost after k periods
+ *
+ *  M34_TRIG_PERIOD     all      0..max      estimated trigger period [us]
+ *                                           (irq mode 0/1, 0=unknown or
+ *                                           too short for the timestamp)
+ *
+ *  M34_TRIG_JITTER     all      0..max      estimated trigger jitter [us]
+ *                                           (mean deviation from period,
+ *                                           0=unknown as above)
+ *
+ *  M34_IRQ_ADAPT       all      0,1         adaptive irq mode 0/1 switching
+ *                                           (current: M34_BLK_TELEMETRY)
+ *
+ *  M34_ADAPT_IRQ_RATE  all      1..1e6      max irq rate [Hz] for mode 1
+ *
+ *  M34_ADAPT_ISR_LOAD  all      1..100      isr load [%] for mode 0 -> 1
+ *
+ *  M34_RD_AVAIL        all      0..max      bytes ready in the read buffer
+ *                                           (async: completed records)
+ *
+ *  M34_ASYNC_ENABLE    all      0,1         async slot acquisition
+ *
+ *  M34_ASYNC_SUBMIT    all      0..max      free slots (can be submitted)
+ *
+ *  M34_ASYNC_RECSIZE   all      0..max      async block read record size
+ *                                           (M34_ASYNC_HDR + slot data)
+ *
+ *  M34_FRAME_ALIGN     all      0,1         frame aligned read buffer
+ *
+ *  M34_DEFER_MASK      all      0..3        work done in deferred stage
+ *
+ *  M34_POLL_OWNER      all      0,1         registers owned by user space
+ *
+ *  M34_BURST_RATE      all      0..max      sample rate [Hz] achieved by
+ *                                           the last M34_IMODE_BURST block
+ *                                           read (0=unknown, e.g. burst
+ *                                           too short for the timestamp)
+ *
+ *  M34_RD_RAW          all      0,1         block reads return raw words
+ *
+ *  M34_RAW_SWAPPED     all      0,1         raw words are byte swapped
+ *                                           (swapped variant, M34_RD_RAW)
+ *
+ *  M34_SETTLE_CAL      all      0..max      achievable frame rate [Hz] of
+ *                                           the current channel selection
+ *                                           and settle counts, measured by
+ *                                           the last calibration (0=none,
+ *                                           too short for the timestamp)
+ *
+ *  M34_RD_LEVEL_MAX    all      0..size     max ready data in the read
+ *                                           buffer [byte] (see also
+ *                                           M34_BLK_TELEMETRY)
+ *
+ *  M34_CAPT_ENABLE     all      0,1         triggered capture mode
+ *
+ *  M34_CAPT_RECSIZE    all      0..max      max capture record size for
+ *                                           the current config
+ *
+ *  M34_BLK_CAPT_CFG    -                    get capture trigger config
+ *                                           (see getStatBlock)
+ *
+ *  M34_BLK_TELEMETRY   -                    get timer mode/read buffer
+ *                                           statistics
+ *                                           (see getStatBlock)
+ *
+ *  M34_BLK_LAT         -                    get latency records
+ *                                           (see getStatBlock)
  *
  *---------------------------------------------------------------------------
  *  Input......:  llHdl             pointer to low-level driver data structure
@@ -1147,9 +2864,11 @@ static int32 M34_GetStat
     M34_HANDLE  *m34Hdl    = (M34_HANDLE*) llHdl;
     int32       *valueP    = (int32 *) value32_or_64P;
     INT32_OR_64 *value64P  = value32_or_64P;
+    int32       error;
     u_int16 dummy;
 
     DBGWRT_1((DBH, "LL - M34_GetStat: code=$%04lx, ch=%d\n",code,ch));
+    M34_TRACE( m34Hdl, M34_TEV_GETSTAT, ch, code, 0 );
 
     switch(code)
     {
@@ -1218,6 +2937,20 @@ static int32 M34_GetStat
             break;
 
         /* ------ special getstat codes --------- */
+        /*--------------------------+
+        |   resolution              |
+        +--------------------------*/
+        case M34_RESOLUTION:
+            if( (error = idPromGet( m34Hdl )) )
+                return( error );
+            if( m34Hdl->idValid && m34Hdl->modId == M34_MOD_ID )
+                *valueP = 12;
+            else if( m34Hdl->idValid && m34Hdl->modId == M34_MOD_ID_M35 )
+                *valueP = 14;
+            else
+                return( ERR_LL_ILL_ID );        /* unknown module */
+            break;
+
         /*------------------+
         |   gain            |
         +------------------*/
@@ -1244,6 +2977,8 @@ static int32 M34_GetStat
         |  extern pin read  |
         +------------------*/
         case M34_EXT_PIN:
+          if( m34Hdl->pollOwner )
+              return( ERR_LL_DEV_BUSY );
           dummy   = MREAD_D16( m34Hdl->ma34, M34_DATA_RD ); /* read no conversion */
           *valueP = (dummy & 0x02 ? 1 : 0);    /* read data (bit 1) */
           break;
@@ -1269,53 +3004,210 @@ static int32 M34_GetStat
 			*valueP = m34Hdl->irqMode;
 			break;
 
-#ifdef WINNT
-		  /*------------------+
-		  |  isr time         |
-		  +------------------*/
-		case M34_ISR_TIME:
-		{
-			LARGE_INTEGER	freq, us; 
-			KeQueryPerformanceCounter(&freq);
+		/*------------------+
+		|  frame rate       |
+		+------------------*/
+		case M34_SAMPLE_RATE:
+			*valueP = 1000 / timerPeriodMs( m34Hdl->sampleRate );
+			break;
 
-			us.QuadPart = m34Hdl->isrTicks.QuadPart;
-			us.QuadPart *= 1000000;
-			us.QuadPart /= freq.QuadPart;
+		/*------------------+
+		|  read-ahead       |
+		+------------------*/
+		case M34_READ_AHEAD:
+			*valueP = m34Hdl->readAhead;
+			break;
 
-			*valueP = (int32)us.LowPart;
-			m34Hdl->isrTicks.QuadPart = 0;
+		/*------------------+
+		|  wakeup batching  |
+		+------------------*/
+		case M34_BATCH_FRAMES:
+			*valueP = m34Hdl->batchFrames;
 			break;
-		}
-#endif
 
-        /*--------------------+
-        |  (unknown)          |
-        +--------------------*/
-        default:
-            if(    ( M_LL_BLK_OF <= code && code <= (M_LL_BLK_OF+0xff) )
-                || ( M_DEV_BLK_OF <= code && code <= (M_DEV_BLK_OF+0xff) )
-              )
-                return( getStatBlock( m34Hdl, code, (M_SETGETSTAT_BLOCK*) value64P ) );
+		case M34_BATCH_LATENCY:
+			*valueP = m34Hdl->batchLatency;
+			break;
 
-            if(    ( M_RDBUF_OF <= code && code <= (M_WRBUF_OF+0x0f) )
-                || ( M_RDBUF_BLK_OF <= code && code <= (M_RDBUF_BLK_OF+0x0f) )
-              )
-                return( MBUF_GetStat( m34Hdl->inbuf,
-                                      NULL,
-                                      code,
-                                      valueP ) );
+		/*------------------+
+		|  non-blocking rd  |
+		+------------------*/
+		case M34_RD_NONBLOCK:
+			*valueP = m34Hdl->rdNonBlock;
+			break;
 
-            return(ERR_LL_UNK_CODE);
+		/*------------------+
+		|  trigger estimate |
+		+------------------*/
+		case M34_TRIG_LOST_K:
+			*valueP = m34Hdl->trigLostK;
+			break;
 
-    }/*switch*/
+		case M34_TRIG_PERIOD:
+			*valueP = trigUs( m34Hdl, m34Hdl->trigPer );
+			break;
 
-    return(0);
-}/*M34_GetStat*/
+		case M34_TRIG_JITTER:
+			*valueP = trigUs( m34Hdl, m34Hdl->trigJit );
+			break;
 
-/******************************* M34_BlockRead *******************************
- *
- *  Description:  Reads all configured channels to buffer.
- *                The read sequence is from lowest configured channel number to
+		/*------------------+
+		|  adaptive irq     |
+		+------------------*/
+		case M34_IRQ_ADAPT:
+			*valueP = m34Hdl->adaptOn;
+			break;
+
+		case M34_ADAPT_IRQ_RATE:
+			*valueP = m34Hdl->adaptRateHi;
+			break;
+
+		case M34_ADAPT_ISR_LOAD:
+			*valueP = m34Hdl->adaptLoadHi;
+			break;
+
+		case M34_RD_AVAIL:
+			*valueP = m34Hdl->asyncOn ?
+					  m34Hdl->asyncDone * m34Hdl->asyncRecSize :
+					  m34Hdl->rdAvailWords * 2;
+			break;
+
+		/*------------------+
+		|  async slots      |
+		+------------------*/
+		case M34_ASYNC_ENABLE:
+			*valueP = m34Hdl->asyncOn;
+			break;
+
+		case M34_ASYNC_SUBMIT:
+			*valueP = m34Hdl->asyncNbrSlots - m34Hdl->asyncPosted -
+					  m34Hdl->asyncDone;
+			break;
+
+		case M34_ASYNC_RECSIZE:
+			*valueP = m34Hdl->asyncRecSize;
+			break;
+
+		/*------------------+
+		|  capture          |
+		+------------------*/
+		case M34_CAPT_ENABLE:
+			*valueP = m34Hdl->captOn;
+			break;
+
+		case M34_FRAME_ALIGN:
+			*valueP = m34Hdl->frameAlign;
+			break;
+
+		case M34_RD_LEVEL_MAX:
+			*valueP = m34Hdl->tele.rdLevelMax;
+			break;
+
+		case M34_SETTLE_CAL:
+			*valueP = settleCalRate( m34Hdl );
+			break;
+
+		case M34_DEFER_MASK:
+			*valueP = m34Hdl->deferMask;
+			break;
+
+		case M34_POLL_OWNER:
+			*valueP = m34Hdl->pollOwner;
+			break;
+
+		case M34_BURST_RATE:
+			*valueP = m34Hdl->burstRate;
+			break;
+
+		case M34_RD_RAW:
+			*valueP = m34Hdl->rdRaw;
+			break;
+
+		case M34_RAW_SWAPPED:
+			*valueP = M34_RAW_SWAP;
+			break;
+
+		case M34_CAPT_RECSIZE:
+			*valueP = sizeof(M34_CAPT_HDR) + M34_CH_WIDTH * m34Hdl->nbrCfgCh *
+					  (m34Hdl->captCfg.pre + 1 + m34Hdl->captCfg.post);
+			break;
+
+        /*------------------+
+        |  trace mask       |
+        +------------------*/
+        case M34_TRACE_MASK:
+          *valueP = m34Hdl->trcMask;
+          break;
+
+        /*------------------+
+        |  trace tstamp freq|
+        +------------------*/
+        case M34_TRACE_TSFREQ:
+          *valueP = traceTsFreq( m34Hdl );
+          break;
+
+        /*------------------+
+        |  latency tracer   |
+        +------------------*/
+        case M34_LAT_SAMPLE:
+          *valueP = m34Hdl->latSample;
+          break;
+
+        case M34_LAT_TSTAMP:
+          *valueP = M34_TSTAMP( m34Hdl );
+          break;
+
+        case M34_ISR_STATS:
+          *valueP = m34Hdl->isrStats;
+          break;
+
+#ifdef WINNT
+		  /*------------------+
+		  |  isr time         |
+		  +------------------*/
+		case M34_ISR_TIME:
+		{
+			LARGE_INTEGER	freq, us; 
+			KeQueryPerformanceCounter(&freq);
+
+			us.QuadPart = m34Hdl->isrTicks.QuadPart;
+			us.QuadPart *= 1000000;
+			us.QuadPart /= freq.QuadPart;
+
+			*valueP = (int32)us.LowPart;
+			m34Hdl->isrTicks.QuadPart = 0;
+			break;
+		}
+#endif
+
+        /*--------------------+
+        |  (unknown)          |
+        +--------------------*/
+        default:
+            if(    ( M_LL_BLK_OF <= code && code <= (M_LL_BLK_OF+0xff) )
+                || ( M_DEV_BLK_OF <= code && code <= (M_DEV_BLK_OF+0xff) )
+              )
+                return( getStatBlock( m34Hdl, code, (M_SETGETSTAT_BLOCK*) value64P ) );
+
+            if(    ( M_RDBUF_OF <= code && code <= (M_WRBUF_OF+0x0f) )
+                || ( M_RDBUF_BLK_OF <= code && code <= (M_RDBUF_BLK_OF+0x0f) )
+              )
+                return( MBUF_GetStat( m34Hdl->inbuf,
+                                      NULL,
+                                      code,
+                                      valueP ) );
+
+            return(ERR_LL_UNK_CODE);
+
+    }/*switch*/
+
+    return(0);
+}/*M34_GetStat*/
+
+/******************************* M34_BlockRead *******************************
+ *
+ *  Description:  Reads all configured channels to buffer.
+ *                The read sequence is from lowest configured channel number to
  *                the highest.
  *                Supported buffer modes:
  *                  M_BUF_USRCTRL         reads from hw
@@ -1365,6 +3257,11 @@ static int32 M34_GetStat
  *                    (this reduces the irq amount)
  *                  - size must be multiple of enabled channels to read x2
  *                  - buffer mode M_BUF_CURRBUF is not supported
+ *                  - with M34_READ_AHEAD=K the isr keeps acquiring K more
+ *                    blocks of the requested size after the current request
+ *                    (limited to RD_BUF/SIZE), so back-to-back reads
+ *                    don't lose triggers. The irq is disabled when the
+ *                    read-ahead is complete or the buffer is full.
  *
  *                M34_IMODE_FIX (=3): fix mode
  *                  - read always all available ch per irq (ignores M34_CH_RDBLK_IRQ config)
@@ -1376,6 +3273,132 @@ static int32 M34_GetStat
  *                      an external trigger signal to generate irqs)
  *                  - this is the fastest and less cpu time consuming mode
  *
+ *                M34_IMODE_TIMER (=4): timer mode
+ *                  - same as legacy mode, but a driver timer starts the
+ *                    conversion of one frame every 1/M34_SAMPLE_RATE s
+ *                  - no external trigger required
+ *                  - the timer is started/stopped with M_MK_IRQ_ENABLE
+ *                  - frames missed due to a busy isr are counted in
+ *                    M34_BLK_TELEMETRY
+ *
+ *                M34_IMODE_BURST (=5): single channel burst
+ *                  - size/2 back-to-back conversions of the first
+ *                    M34_CH_RDBLK_IRQ channel per block read
+ *                  - the control word is written once, the input settles
+ *                    once (dummy reads as in the other modes), then no
+ *                    control write and no dummy conversion follows
+ *                  - M_BUF_USRCTRL: polled conversions, at most
+ *                    M34_BURST_POLL_MAX per block read (the block read
+ *                    returns fewer bytes for a larger size), the other
+ *                    paths are locked out during the burst
+ *                  - other buffer modes: one irq per conversion, the isr
+ *                    reads the data and starts the next conversion
+ *                    (the module interrupt is automatically enabled/disabled)
+ *                  - without buffer usage (ignores RD_BUF/.. config)
+ *                  - the achieved sample rate is returned by M34_BURST_RATE
+ *
+ *                Wakeup batching (buffered irq modes, not M_BUF_CURRBUF):
+ *                  With M34_BATCH_FRAMES=N (N>1) a block read first sleeps
+ *                  until N frames (all M34_CH_RDBLK_IRQ channels) are
+ *                  ready or the oldest ready frame is older than
+ *                  M34_BATCH_LATENCY us, then reads from the buffer.
+ *                  N is limited to the frames RD_BUF/SIZE can hold, the
+ *                  latency is rounded up to the OSS tick. The wait ends
+ *                  also when the acquisition stops or after RD_BUF/TIMEOUT.
+ *
+ *                Non-blocking read (buffered irq modes, not M_BUF_CURRBUF):
+ *                  With M34_RD_NONBLOCK=1 a block read copies only the
+ *                  complete frames ready in the buffer (up to size) and
+ *                  returns 0 bytes if there are none. The data ready signal
+ *                  (M34_SIG_DATA_SET) is edge triggered: after it the
+ *                  application must read until 0 bytes are returned.
+ *                  On Linux the signal can be waited for with other file
+ *                  descriptors via signalfd().
+ *
+ *                Async slots (M34_ASYNC_ENABLE=1, irq mode 0/1/4):
+ *                  The isr stores the frames directly into driver slots
+ *                  (no read buffer) the application has submitted with
+ *                  M34_ASYNC_SUBMIT. A slot is completed when no further
+ *                  frame fits. The block read returns completed slots,
+ *                  oldest first, as records of M34_ASYNC_RECSIZE bytes
+ *                  (M34_ASYNC_HDR followed by the slot data); size must be
+ *                  at least one record. It waits for one completed slot
+ *                  (RD_BUF/TIMEOUT) unless M34_RD_NONBLOCK is set, and
+ *                  fails with ERR_LL_READ if no slot is submitted or
+ *                  completed. Read slots are free for M34_ASYNC_SUBMIT.
+ *                  An installed data ready signal is sent per slot.
+ *
+ *                Deferred stage (M34_DEFER_MASK):
+ *                  With M34_DEFER_PUBLISH the irq mode 0/4 frames are
+ *                  only converted into the staging ring by the isr/timer.
+ *                  A drain timer (every M34_DEFER_PERIOD ms) and each
+ *                  block read publish them into the read buffer, async
+ *                  slots or capture history. With M34_DEFER_WAKEUP the
+ *                  reader wakeups and the data ready signal are sent from
+ *                  there too. Frames are lost if the staging ring is full
+ *                  (M34_BLK_TELEMETRY stageLost).
+ *
+ *                Frame aligned read buffer (M34_FRAME_ALIGN=1):
+ *                  The read buffer holds whole frames of the configured
+ *                  channels, so the isr/timer reserves exactly one
+ *                  contiguous frame and never splits it at the buffer
+ *                  wrap. The block read size is rounded down to whole
+ *                  frames (at least one), so in irq mode 0/4 a block read
+ *                  never returns a torn frame. Changing the channel
+ *                  selection recreates the buffer and needs the
+ *                  acquisition to be stopped.
+ *
+ *                Triggered capture (M34_CAPT_ENABLE=1, irq mode 0/1/4):
+ *                  The isr keeps the last M34_CAPT_CFG.pre frames in the
+ *                  capture history until the trigger condition is met on
+ *                  a frame (EXT pin edge in the first value of the frame,
+ *                  or level crossing of M34_CAPT_CFG.ch, armed again after
+ *                  the value left the level by hyst), then collects post
+ *                  more frames. The block read returns the finished
+ *                  record (M34_CAPT_HDR followed by the frames, oldest
+ *                  first) and re-arms the trigger; size must be at least
+ *                  M34_CAPT_RECSIZE. It waits like the async mode. Frames
+ *                  are dropped while a record is pending.
+ *
+ *                Trigger loss (M34_TRIG_LOST_K=k, irq mode 0/1):
+ *                  The isr keeps a running estimate of the trigger period
+ *                  and jitter (M34_TRIG_PERIOD/M34_TRIG_JITTER). When no
+ *                  edge arrives within k estimated periods (checked every
+ *                  M34_TRIG_WD_PERIOD ms, after the second edge) the
+ *                  trigger is lost until the next edge: a block read that
+ *                  would wait for frames fails with M34_ERR_TRIG_LOST
+ *                  (ready frames are returned first), a batch wait ends
+ *                  and the M34_SIG_TRIG_SET signal is sent. A reader
+ *                  already sleeping in the read buffer returns after
+ *                  RD_BUF/TIMEOUT.
+ *
+ *                Adaptive irq mode (M34_IRQ_ADAPT, irq mode 0/1):
+ *                  A switch changes the frame time base (mode 1: one
+ *                  channel per trigger edge). The block read returns the
+ *                  frames acquired before the switch, then fails once
+ *                  with M34_ERR_IRQ_ADAPT; the current mode is in
+ *                  M34_BLK_TELEMETRY adaptMode.
+ *
+ *                Latency tracer (M34_LAT_SAMPLE=n, irq mode 0/1/2/4 with
+ *                read buffer):
+ *                  Every n-th frame (one at a time) is followed through
+ *                  the driver: isr entry of the frame start, frame
+ *                  converted, MBUF_ReadyBuf, the block read copying it
+ *                  returned from MBUF_Read and from M34_BlockRead. The
+ *                  completed M34_LAT_REC can be read with M34_BLK_LAT;
+ *                  the application adds its own stamp (M34_LAT_TSTAMP
+ *                  right after the block read, rdSeq identifies it).
+ *                  The stamps use the trace timestamp (M34_TRACE_TSFREQ),
+ *                  which must be at least M34_LAT_TSFREQ_MIN. Builds with
+ *                  the OSS tick as timestamp can't enable the tracer.
+ *
+ *                Byte swapped variant (m34_sw):
+ *                  The isr and scan loops store the bus words unswapped,
+ *                  the block read converts the returned data in one pass
+ *                  (two words per 32-bit access, async/capture headers
+ *                  excluded). With M34_RD_RAW=1 this is left to the
+ *                  application (M34_RAW_SWAPPED, M34_SWAP16X2).
+ *
  *---------------------------------------------------------------------------
  *  Input......:  llHdl  pointer to low-level driver data structure
  *                ch     current channel (always ignored)
@@ -1399,441 +3422,3105 @@ static int32 M34_BlockRead
 )
 {
     M34_HANDLE *m34Hdl = (M34_HANDLE*) llHdl;
-    u_int32    t;
-    u_int32    nbrOfReads;
-    u_int16    dummy, dummy2;
-    u_int16    *bufP;
-    u_int32    haveRead;
     int32      fktRetCode;
-    int32      bufMode;
 
     DBGWRT_1((DBH, "LL - M34_BlockRead: entered\n"));
+    M34_TRACE( m34Hdl, M34_TEV_BLKRD, M34_TRC_NOCH, size, m34Hdl->irqMode );
 
 	*nbrRdBytesP = 0;
 
-	/*---------------------------------------------------------------------------------+
-	|  F I X   I R Q   M O D E                                                         |
-	+---------------------------------------------------------------------------------*/
-	if (m34Hdl->irqMode == M34_IMODE_FIX) {
-
-		/* one block read store the data for all available channels */
-		if ( size != 2 * m34Hdl->nbrOfChannels ){
-			DBGWRT_ERR((DBH,
-				"*** LL - M34_BlockRead: illegal byte size (M34_IMODE_FIX)\n"));
-			return ERR_LL_ILL_PARAM;
-		}
-
-		m34Hdl->isrCurrCh = 0;
-		m34Hdl->buf = (u_int16*)buf;
-		m34Hdl->skip = 1;
-		
-		/* enable irq */
-		DBGWRT_2((DBH, " enable irq\n"));
-		setIrqEnable(1, m34Hdl);
-
-		/* start, set control data */
-		MWRITE_D16(m34Hdl->ma34, M34_CTRL_START_WR, m34Hdl->chCtrl[m34Hdl->isrCurrCh]);
-
-		/* wait for data */
-		fktRetCode = OSS_SemWait(m34Hdl->osHdl, m34Hdl->sem, 100);
-		if (fktRetCode){
-			DBGWRT_ERR((DBH,
-				"*** LL - M34_BlockRead: no data gotten (fktRetCode=0x%x)\n"));
-			return fktRetCode;
-		}
+	/* serialize block reads and acquisition setup changes */
+	if( (fktRetCode = M34_LOCK( m34Hdl, rdSem )) )
+		return( fktRetCode );
 
-		*nbrRdBytesP = 2 * m34Hdl->nbrOfChannels;
+	/* registers owned by user space (M34_POLL_OWNER) */
+	if( m34Hdl->pollOwner )
+	{
+		M34_UNLOCK( m34Hdl, rdSem );
+		return( ERR_LL_DEV_BUSY );
 	}
-	/*---------------------------------------------------------------------------------+
-	|  I R Q   M O D E   W I T H   B U F F E R                                         |
-	+---------------------------------------------------------------------------------*/
-	else{
-		bufP     = (u_int16*) buf;
-		haveRead = 0;
-		ch       = 0;
-
-		nbrOfReads = size / M34_CH_WIDTH;
-
 
-		fktRetCode = MBUF_GetBufferMode( m34Hdl->inbuf , &bufMode );
-		if( fktRetCode != 0 && fktRetCode != ERR_MBUF_NO_BUF )
-		{
-		   return( fktRetCode );
-		}/*if*/
+	/* publish staged frames now instead of at the next drain tick */
+	if( m34Hdl->deferMask )
+		stageDrain( m34Hdl );
 
-		switch( bufMode )
-		{
+	/* acquisition stopped by the isr (CHIRQ_AUTO): stop the drain timer */
+	if( m34Hdl->deferRun && !M34_ACQ_RUNNING( m34Hdl ) &&
+		M34_LOCK( m34Hdl, hwSem ) == 0 ) {
+		deferTimerSet( m34Hdl );
+		M34_UNLOCK( m34Hdl, hwSem );
+	}
 
-			case M_BUF_USRCTRL:
-			   if( m34Hdl->irqIsEnabled )
-				  return( ERR_LL_READ );        /* can't read ! */
-
-			   while( nbrOfReads > 0 )
-			   {
-				   /* ch scheduling */
-				   if( m34Hdl->chBlkRd[ch] )
-				   {
-					   /*--------------------+
-					   |  set current ch     |
-					   +--------------------*/
-					   MWRITE_D16( m34Hdl->ma34, M34_CTRL_WR, m34Hdl->chCtrl[ch] );
-
-					   /*----------------------------------+
-					   |  star conversion & rd with delay  |
-					   +----------------------------------*/
-					   for (t=0; t<=m34Hdl->nbrDummyRd; t++)						/* dummy reads min 1 */
-						   dummy   = MREAD_D16( m34Hdl->ma34, M34_DATA_START_RD );	/* dummy conversion */
-					   dummy2  = MREAD_D16( m34Hdl->ma34, M34_DATA_START_RD );		/* conversion */
-					   *bufP++ = dummy2;
-
-					   nbrOfReads--;
-					   haveRead = 1;
-				   }/*if*/
-				   ch++;
-
-				   /*-----------------+
-				   |  ch wrap around  |
-				   +-----------------*/
-				   if( (u_int32)ch == m34Hdl->nbrOfChannels )
-				   {
-					   ch = 0;
-					   if( !haveRead )
-					   {
-						   DBGWRT_ERR((DBH,
-							   "*** LL - M34_BlockRead: no ch configured M34_BLK_RD_IRQ\n"));
-						   break;
-					   }/*if*/
-				   }/*if*/
-			   }/*while*/
-
-			   /* This cast to int32 is OK, because (bufP - buf) constitutes the buffer size  *
-				* requested by the (32 bit wide) size parameter.                              */
-			   *nbrRdBytesP = (int32) ((char*)bufP - (char*)buf);
-			   fktRetCode   = 0; /* ovrwr ERR_MBUF_NO_BUFFER */
-			   break;
-
-			case M_BUF_RINGBUF:
-			case M_BUF_RINGBUF_OVERWR:
-			case M_BUF_CURRBUF:
-			default:
+	if( m34Hdl->latSample )
+		m34Hdl->latRdSeq++;
 
-				/* buffer irq mode with irq/ch? */
-				if ((m34Hdl->irqMode == M34_IMODE_CHIRQ) ||
-					(m34Hdl->irqMode == M34_IMODE_CHIRQ_AUTO)) {
-
-					/* the requestet byte size must be a multiple
-					   of the number of block read configured channels */
-					if (size % (2 * m34Hdl->nbrCfgCh)) {
-						DBGWRT_ERR((DBH,
-							"*** LL - M34_BlockRead: illegal byte size (M34_IMODE_CHIRQ[_AUTO])\n"));
-						return ERR_LL_ILL_PARAM;
-					}
-
-					m34Hdl->blkReadGotWords = 0;
-					m34Hdl->blkReadReqWords = size/2;
-
-					/* buffer irq mode with auto irq enable/disable? */
-					if (m34Hdl->irqMode == M34_IMODE_CHIRQ_AUTO) {
-
-						m34Hdl->isrCurrCh = 0;
-						m34Hdl->nbrReadCh = 0;
-
-						/* at least one channel must be configured for block read */
-						if (m34Hdl->nbrCfgCh == 0) {
-							DBGWRT_ERR((DBH,
-								"*** LL - M34_BlockRead: no ch configured\n"));
-							return ERR_LL_ILL_PARAM;
-						}
-
-						/* M_BUF_CURRBUF makes no sense */
-						if (bufMode == M_BUF_CURRBUF) {
-							DBGWRT_ERR((DBH,
-								"*** LL - M34_BlockRead: M_BUF_CURRBUF not supported (IMODE_CHIRQ_AUTO)\n"));
-							return ERR_LL_ILL_PARAM;
-						}
-
-						/* enable irq */
-						DBGWRT_2((DBH, " enable irq\n"));
-						setIrqEnable(1, m34Hdl);
-						MWRITE_D16(m34Hdl->ma34, M34_CTRL_WR, m34Hdl->chCtrl[m34Hdl->isrCurrCh]);
-					}
-				}
+	/* irq/buffer mode specific implementation (see selectModeFkt) */
+	fktRetCode = m34Hdl->blkRdFkt( m34Hdl, buf, size, nbrRdBytesP );
 
-			   fktRetCode = MBUF_Read( m34Hdl->inbuf, (u_int8*) buf, size,
-									   nbrRdBytesP );
+	/* sampled frame returned by this block read */
+	if( m34Hdl->latState == M34_LAT_ST_WAKE )
+		latDone( m34Hdl );
 
-		}/*switch*/
-	}/*  I R Q   M O D E   W I T H   B U F F E R */
+    M34_UNLOCK( m34Hdl, rdSem );
 
+    M34_TRACE( m34Hdl, M34_TEV_BLKRD_END, M34_TRC_NOCH, *nbrRdBytesP, fktRetCode );
     return( fktRetCode );
 }/*M34_BlockRead*/
 
-/****************************** M34_BlockWrite *******************************
+/****************************** blkRdFix ************************************
  *
- *  Description:  Write data block to device
- *
- *                The function is not supported and returns always an
- *                ERR_LL_ILL_FUNC error.
+ *  Description:  Block read for M34_IMODE_FIX.
+ *                Called with the read lock taken.
  *
  *---------------------------------------------------------------------------
- *  Input......:  llHdl        pointer to low-level driver data structure
- *                ch           current channel  (always ignored)
+ *  Input......:  m34Hdl       m34 handle
  *                buf          buffer to store read values
- *                size         should be multiple of width
+ *                size         byte size to read
  *
- *  Output.....:  nbrWrBytesP  number of written bytes
- *                return       ERR_LL_ILL_FUNC
+ *  Output.....:  nbrRdBytesP  number of read bytes
+ *                return       0 | error code
  *
  *  Globals....:  ---
  *
  ****************************************************************************/
-static int32 M34_BlockWrite
+static int32 blkRdFix
 (
-    LL_HANDLE *llHdl,
-    int32     ch,
-    void      *buf,
-    int32     size,
-    int32     *nbrWrBytesP
+	M34_HANDLE	*m34Hdl,
+	void		*buf,
+	int32		size,
+	int32		*nbrRdBytesP
 )
 {
-    DBGCMD(M34_HANDLE  *m34Hdl = (M34_HANDLE*) llHdl);
+	int32			fktRetCode;
+	OSS_IRQ_STATE	irqState;
+
+	/* one block read store the data for all available channels */
+	if ( size != 2 * m34Hdl->nbrOfChannels ){
+		DBGWRT_ERR((DBH,
+			"*** LL - M34_BlockRead: illegal byte size (M34_IMODE_FIX)\n"));
+		return( ERR_LL_ILL_PARAM );
+	}
 
-    DBGWRT_1((DBH, "LL - M34_BlockWrite: size=%ld\n",size));
+	if( (fktRetCode = M34_LOCK( m34Hdl, hwSem )) )
+		return( fktRetCode );
 
-    *nbrWrBytesP = 0;
+	irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+	m34Hdl->isrCurrCh = 0;
+	m34Hdl->buf = (u_int16*)buf;
+	m34Hdl->skip = 1;
+	m34Hdl->convPending = 1;
+	
+	/* enable irq */
+	DBGWRT_2((DBH, " enable irq\n"));
+	setIrqEnable(1, m34Hdl);
+
+	/* start, set control data */
+	MWRITE_D16(m34Hdl->ma34, M34_CTRL_START_WR, m34Hdl->chCtrl[m34Hdl->isrCurrCh]);
+	OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+
+	M34_UNLOCK( m34Hdl, hwSem );
+
+	/* wait for data */
+	fktRetCode = OSS_SemWait(m34Hdl->osHdl, m34Hdl->sem, 100);
+	if (fktRetCode){
+		DBGWRT_ERR((DBH,
+			"*** LL - M34_BlockRead: no data gotten (fktRetCode=0x%x)\n"));
+		M34_TRACE( m34Hdl, M34_TEV_ERR_TIMEOUT, M34_TRC_NOCH, fktRetCode, 0 );
+
+		/* stop the scan, the isr must not handle further irqs */
+		irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+		if( !m34Hdl->convPending ) {
+			/* completed after the timeout: consume its signal */
+			OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+			OSS_SemWait( m34Hdl->osHdl, m34Hdl->sem, OSS_SEM_NOWAIT );
+			fktRetCode = 0;
+		}
+		else {
+			setIrqEnable(0, m34Hdl);
+			MWRITE_D16(m34Hdl->ma34, M34_CTRL_WR, m34Hdl->chCtrl[0]);
+			m34Hdl->convPending = 0;
+			OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+			return( fktRetCode );
+		}
+	}
 
+	*nbrRdBytesP = 2 * m34Hdl->nbrOfChannels;
+	rdSwap( m34Hdl, buf, *nbrRdBytesP );
+	return( 0 );
+}/*blkRdFix*/
 
-    return( ERR_LL_ILL_FUNC );
-}
+/****************************** burstRate ***********************************
+ *
+ *  Description:  Calculates the sample rate of a burst. A burst shorter
+ *                than M34_RATE_TS_MIN timestamp units gives no usable
+ *                rate (unknown).
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl   m34 handle
+ *                conv     conversions within ticks
+ *                ticks    duration [M34_TSTAMP]
+ *
+ *  Output.....:  return   sample rate [Hz] (0=unknown)
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static u_int32 burstRate( M34_HANDLE *m34Hdl, u_int32 conv, u_int32 ticks )
+{
+	u_int32	freq = traceTsFreq( m34Hdl );
 
-/****************************** M34_Irq *************************************
+	if( conv == 0 || ticks < M34_RATE_TS_MIN || freq == 0 )
+		return( 0 );
+
+	return( (u_int32)M34_DIV64( (u_int64)conv * freq, ticks ) );
+}/*burstRate*/
+
+/****************************** blkRdBurst **********************************
  *
- *  Description:  Reads all configured ( M34_CH_RDBLK_IRQ ) to buffer or
- *                current channel (dummy) to reset irq cause.
- *                Stores the values to buffer in M_BUF_CURRBUF, M_BUF_RINGBUF
- *                and M_BUF_RINGBUF_OVERWR buffer mode.
+ *  Description:  Block read for M34_IMODE_BURST (irq driven).
+ *                Called with the read lock taken.
  *
  *---------------------------------------------------------------------------
- *  Input......:  llHdl  pointer to low-level driver data structure
+ *  Input......:  m34Hdl       m34 handle
+ *                buf          buffer to store read values
+ *                size         byte size to read
  *
- *  Output.....:  return LL_IRQ_UNKNOWN
+ *  Output.....:  nbrRdBytesP  number of read bytes
+ *                return       0 | error code
  *
  *  Globals....:  ---
  *
  ****************************************************************************/
-static int32 M34_Irq
+static int32 blkRdBurst
 (
-    LL_HANDLE *llHdl
+	M34_HANDLE	*m34Hdl,
+	void		*buf,
+	int32		size,
+	int32		*nbrRdBytesP
 )
 {
-	M34_HANDLE	*m34Hdl = (M34_HANDLE*) llHdl;
-	u_int16		dummy;
-	u_int32		ch;
-	u_int32		t;
-	u_int16		*buf;
-	u_int32		nbrRdCh = 0;	/* number of read channels */
-	int32		nbrOfBlocks;
-	int32		gotsize;
-
-#ifdef WINNT
-	LARGE_INTEGER	t1, t2;
-	t1 = KeQueryPerformanceCounter(NULL);
-#endif
+	int32			fktRetCode;
+	u_int32			ch, nbr = size / M34_CH_WIDTH;
+	OSS_IRQ_STATE	irqState;
+
+	if( nbr == 0 || m34Hdl->nbrCfgCh == 0 ){
+		DBGWRT_ERR((DBH,
+			"*** LL - M34_BlockRead: no ch configured/illegal size (M34_IMODE_BURST)\n"));
+		return( ERR_LL_ILL_PARAM );
+	}
 
-	/*---------------------------------------------------------------------------------+
-	| F I X   I R Q   M O D E                                                          |
-	+---------------------------------------------------------------------------------*/
-	if (m34Hdl->irqMode == M34_IMODE_FIX) {
+	if( (fktRetCode = M34_LOCK( m34Hdl, hwSem )) )
+		return( fktRetCode );
 
-		IDBGWRT_1((DBH, "LL - M34_Irq: M34_IMODE_FIX\n"));
+	if( M34_ACQ_RUNNING( m34Hdl ) )
+	{
+		M34_UNLOCK( m34Hdl, hwSem );
+		return( ERR_LL_READ );        /* can't read ! */
+	}
 
-		if( m34Hdl->skip ){
-			/* read data and start next conversion */
-			dummy = MREAD_D16(m34Hdl->ma34, M34_DATA_RD_START_INC);
-			m34Hdl->skip--;
+	ch = m34Hdl->scanList[0];
+
+	irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+	m34Hdl->isrCurrCh   = ch;
+	m34Hdl->buf         = (u_int16*)buf;
+	m34Hdl->burstIdx    = 0;
+	m34Hdl->burstNbr    = nbr;
+	m34Hdl->skip        = m34Hdl->chDummyRd[ch] + 1;	/* settle as dummy reads */
+	m34Hdl->convPending = 1;
+
+	/* enable irq */
+	DBGWRT_2((DBH, " enable irq\n"));
+	setIrqEnable(1, m34Hdl);
+
+	/* start, set control data (only control write of the burst) */
+	MWRITE_D16(m34Hdl->ma34, M34_CTRL_START_WR, m34Hdl->chCtrl[ch]);
+	OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+
+	M34_UNLOCK( m34Hdl, hwSem );
+
+	/* wait for data */
+	fktRetCode = OSS_SemWait(m34Hdl->osHdl, m34Hdl->sem, M34_BURST_TOUT(nbr));
+	if (fktRetCode){
+		DBGWRT_ERR((DBH,
+			"*** LL - M34_BlockRead: no data gotten (fktRetCode=0x%x)\n"));
+		M34_TRACE( m34Hdl, M34_TEV_ERR_TIMEOUT, M34_TRC_NOCH, fktRetCode, 0 );
+
+		/* stop the burst, the isr must not handle further irqs */
+		irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+		if( m34Hdl->burstIdx == m34Hdl->burstNbr ) {
+			/* completed after the timeout: consume its signal */
+			OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+			OSS_SemWait( m34Hdl->osHdl, m34Hdl->sem, OSS_SEM_NOWAIT );
+			fktRetCode = 0;
 		}
 		else {
-			/* read data and start next conversion */
-			m34Hdl->buf[m34Hdl->isrCurrCh] = MREAD_D16(m34Hdl->ma34, M34_DATA_RD_START_INC);
-			IDBGWRT_2((DBH, " buf[%d] = 0x%x\n",
-				m34Hdl->isrCurrCh, m34Hdl->buf[m34Hdl->isrCurrCh]));
-
-			/* not all data read? */
-			if (m34Hdl->isrCurrCh < (m34Hdl->nbrOfChannels - 1)) {
-				m34Hdl->isrCurrCh++;
-			}
-			/* all data read */
-			else {
-				IDBGWRT_2((DBH, " all data read\n"));
-				OSS_SemSignal(m34Hdl->osHdl, m34Hdl->sem);
-				goto DISABLE_CLEANUP;
-			}
+			setIrqEnable(0, m34Hdl);
+			MWRITE_D16(m34Hdl->ma34, M34_CTRL_WR, m34Hdl->chCtrl[ch]);
+			m34Hdl->convPending = 0;
+			OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+			return( fktRetCode );
 		}
-
-		goto CLEANUP;
 	}
 
-	/*---------------------------------------------------------------------------------+
-	|  I R Q   M O D E   W I T H   B U F F E R                                         |
-	+---------------------------------------------------------------------------------*/
+	m34Hdl->burstRate = burstRate( m34Hdl, nbr - 1,
+								   m34Hdl->burstT1 - m34Hdl->burstT0 );
 
-	/* buffer irq mode without auto irq enable/disable? */
-	if ((m34Hdl->irqMode == M34_IMODE_LEGACY) ||
-		(m34Hdl->irqMode == M34_IMODE_CHIRQ)) {
-		/* at least one channel must be configured for block read */
-		if (m34Hdl->nbrCfgCh == 0) {
-			IDBGWRT_ERR((DBH,
-				"*** LL - M34_Irq: no ch configured: disable irq\n"));
-			setIrqEnable(0, m34Hdl);
-			MWRITE_D16(m34Hdl->ma34, M34_CTRL_WR, m34Hdl->chCtrl[m34Hdl->isrCurrCh]);
-		}
+	*nbrRdBytesP = nbr * M34_CH_WIDTH;
+	rdSwap( m34Hdl, buf, *nbrRdBytesP );
+	return( 0 );
+}/*blkRdBurst*/
+
+/****************************** blkRdBurstPoll ******************************
+ *
+ *  Description:  Block read for M34_IMODE_BURST with M_BUF_USRCTRL (polled).
+ *                Called with the read lock taken. The burst holds the hw
+ *                lock, it is limited to M34_BURST_POLL_MAX conversions.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl       m34 handle
+ *                buf          buffer to store read values
+ *                size         byte size to read
+ *
+ *  Output.....:  nbrRdBytesP  number of read bytes
+ *                return       0 | error code
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static int32 blkRdBurstPoll
+(
+	M34_HANDLE	*m34Hdl,
+	void		*buf,
+	int32		size,
+	int32		*nbrRdBytesP
+)
+{
+	int32		fktRetCode;
+	u_int32		ch, n, t0, nbr = size / M34_CH_WIDTH;
+	u_int16		*bufP = (u_int16*) buf;
+
+	if( nbr == 0 || m34Hdl->nbrCfgCh == 0 ){
+		DBGWRT_ERR((DBH,
+			"*** LL - M34_BlockRead: no ch configured/illegal size (M34_IMODE_BURST)\n"));
+		return( ERR_LL_ILL_PARAM );
 	}
-	
-	/* -------------------- buffer irq mode with irq/ch? -------------------- */
-	if ((m34Hdl->irqMode == M34_IMODE_CHIRQ) ||
-		(m34Hdl->irqMode == M34_IMODE_CHIRQ_AUTO)) {
 
-		IDBGWRT_1((DBH, "LL - M34_Irq: M34_IMODE_CHIRQ[_AUTO]\n"));
+	/* bound the time getstat/setstat and other readers are locked out */
+	if( nbr > M34_BURST_POLL_MAX )
+		nbr = M34_BURST_POLL_MAX;
 
-		/* get space for one channel */
-		if ((buf = (u_int16*)MBUF_GetNextBuf(m34Hdl->inbuf, 1, &gotsize)) != 0)
-		{
-			IDBGWRT_2((DBH, " buffer space available\n"));
+	if( (fktRetCode = M34_LOCK( m34Hdl, hwSem )) )
+		return( fktRetCode );
 
-			/* skip unused channels */
-			while ((m34Hdl->isrCurrCh < m34Hdl->nbrOfChannels) &&
-				(m34Hdl->chBlkRd[m34Hdl->isrCurrCh] == 0)) {
-				m34Hdl->isrCurrCh++;
+	if( M34_ACQ_RUNNING( m34Hdl ) )
+	{
+		M34_UNLOCK( m34Hdl, hwSem );
+		return( ERR_LL_READ );        /* can't read ! */
+	}
 
-				/* wrap around ch number */
-				if (m34Hdl->isrCurrCh == m34Hdl->nbrOfChannels)
-					m34Hdl->isrCurrCh = 0;
-			}
+	/* set ch and let the input settle once */
+	ch = m34Hdl->scanList[0];
+	M34_SCAN_SETTLE( m34Hdl->ma34, m34Hdl->chCtrl[ch], m34Hdl->chDummyRd[ch] );
 
-			IDBGWRT_3((DBH, " read ch=%d\n", m34Hdl->isrCurrCh));
+	/* back-to-back conversions */
+	t0 = M34_TSTAMP( m34Hdl );
+	for( n = nbr; n > 0; n-- )
+		*bufP++ = M34_CONV_RAW( m34Hdl->ma34 );
+	m34Hdl->burstRate = burstRate( m34Hdl, nbr, M34_TSTAMP( m34Hdl ) - t0 );
 
-			/* set current ch */
-			MWRITE_D16(m34Hdl->ma34, M34_CTRL_WR, m34Hdl->chCtrl[m34Hdl->isrCurrCh]);
+	M34_UNLOCK( m34Hdl, hwSem );
 
-			/* dummy reads */
-			for (t = 0; t <= m34Hdl->nbrDummyRd; t++)
-				dummy = MREAD_D16(m34Hdl->ma34, M34_DATA_START_RD);
+	*nbrRdBytesP = nbr * M34_CH_WIDTH;
+	rdSwap( m34Hdl, buf, *nbrRdBytesP );
+	return( 0 );
+}/*blkRdBurstPoll*/
 
-			/* conversion */
-			*buf++ = MREAD_D16(m34Hdl->ma34, M34_DATA_START_RD);
-			m34Hdl->nbrReadCh++;
-			m34Hdl->isrCurrCh++;
+/****************************** blkRdUsrCtrl ********************************
+ *
+ *  Description:  Block read for buffer mode M_BUF_USRCTRL (direct hw read
+ *                of the block read channels, see M34_CH_RDBLK_IRQ).
+ *                Called with the read lock taken.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl       m34 handle
+ *                buf          buffer to store read values
+ *                size         byte size to read
+ *
+ *  Output.....:  nbrRdBytesP  number of read bytes
+ *                return       0 | error code
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static int32 blkRdUsrCtrl
+(
+	M34_HANDLE	*m34Hdl,
+	void		*buf,
+	int32		size,
+	int32		*nbrRdBytesP
+)
+{
+	u_int32		nbrOfReads, idx, ch;
+	u_int16		*bufP = (u_int16*) buf;
+	int32		fktRetCode;
 
-			/* all configured ch read? */
-			if (m34Hdl->nbrReadCh == m34Hdl->nbrCfgCh) {
-				IDBGWRT_3((DBH, " all configured ch read\n"));
-				/*
-				* let MBUF_Read():
-				* 1. copy data
-				* 2. wait for more data if requested
-				*/
-				MBUF_ReadyBuf(m34Hdl->inbuf);
-				m34Hdl->nbrReadCh = 0;
-				m34Hdl->isrCurrCh = 0;
-				m34Hdl->blkReadGotWords += m34Hdl->nbrCfgCh;
+	nbrOfReads = size / M34_CH_WIDTH;
 
-				/* buffer irq mode with auto irq enable/disable? */
-				if (m34Hdl->irqMode == M34_IMODE_CHIRQ_AUTO) {
-					/* all requested data read? */
-					if (m34Hdl->blkReadGotWords == m34Hdl->blkReadReqWords)
-						goto DISABLE_CLEANUP;
-				}
-			}
-		}
-		/* no more buffer space (all requested date read) */
-		else
-		{
-			IDBGWRT_2((DBH, " no buffer space\n"));
-			/* reset irq cause */
-			dummy = MREAD_D16(m34Hdl->ma34, M34_DATA_START_RD); /* dummy conversion */
-		}
-		goto CLEANUP;
+	if( (fktRetCode = M34_LOCK( m34Hdl, hwSem )) )
+		return( fktRetCode );
+
+	if( M34_ACQ_RUNNING( m34Hdl ) )
+	{
+		M34_UNLOCK( m34Hdl, hwSem );
+		return( ERR_LL_READ );        /* can't read ! */
 	}
 
-	/* -------------------- legacy irq mode -------------------- */
-	IDBGWRT_1((DBH, "LL - M34_Irq: M34_IMODE_LEGACY\n"));
+	if( m34Hdl->nbrCfgCh == 0 )
+	{
+		DBGWRT_ERR((DBH,
+			"*** LL - M34_BlockRead: no ch configured M34_BLK_RD_IRQ\n"));
+		nbrOfReads = 0;
+	}/*if*/
 
-	/*-------------------------------------+
-	|  input values (configured channels)  |
-	+-------------------------------------*/
-	/* if m34Hdl->nbrCfgCh == 0, also buf is NULL and a dummy read is performed */
-	if ((buf = (u_int16*)MBUF_GetNextBuf(
-		m34Hdl->inbuf, m34Hdl->nbrCfgCh, &gotsize)) != 0)
+	for( idx = 0; nbrOfReads > 0; nbrOfReads-- )
 	{
-		IDBGWRT_2((DBH, " buffer space available\n"));
+		ch = m34Hdl->scanList[idx];
+
+		/*-------------------------------------+
+		|  set current ch, settle & conversion |
+		+-------------------------------------*/
+		M34_SCAN_SETTLE( m34Hdl->ma34, m34Hdl->chCtrl[ch], m34Hdl->chDummyRd[ch] );
+		*bufP++ = M34_CONV_RAW( m34Hdl->ma34 );
+
+		/*-----------------+
+		|  ch wrap around  |
+		+-----------------*/
+		if( ++idx == m34Hdl->nbrCfgCh )
+			idx = 0;
+	}/*for*/
+
+	M34_UNLOCK( m34Hdl, hwSem );
+
+	/* This cast to int32 is OK, because (bufP - buf) constitutes the buffer size  *
+	 * requested by the (32 bit wide) size parameter.                              */
+	*nbrRdBytesP = (int32) ((char*)bufP - (char*)buf);
+	rdSwap( m34Hdl, buf, *nbrRdBytesP );
+	return( 0 );
+}/*blkRdUsrCtrl*/
+
+/****************************** blkRdBuf ************************************
+ *
+ *  Description:  Common block read for the buffered irq modes.
+ *                The mode flags are constant for each caller, so the
+ *                compiler generates one specialized body per mode.
+ *                Called with the read lock taken.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl       m34 handle
+ *                buf          buffer to store read values
+ *                size         byte size to read
+ *                chIrq        one ch per irq mode (size check, frame count)
+ *                autoIrq      automatic irq enable/disable
+ *
+ *  Output.....:  nbrRdBytesP  number of read bytes
+ *                return       0 | error code
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static int32 blkRdBuf
+(
+	M34_HANDLE	*m34Hdl,
+	void		*buf,
+	int32		size,
+	int32		*nbrRdBytesP,
+	const int	chIrq,
+	const int	autoIrq
+)
+{
+	int32			fktRetCode;
+	u_int32			need, lim, avail, cons, mark;
+	OSS_IRQ_STATE	irqState;
+
+	/* aligned buffer: read whole frames only */
+	if( m34Hdl->frameAlign && m34Hdl->nbrCfgCh ) {
+		size -= size % (2 * m34Hdl->nbrCfgCh);
+		if( size == 0 )
+			return( ERR_LL_ILL_PARAM );
+	}
+
+	if( chIrq )
+	{
+		/* at least one channel must be configured for block read */
+		if (autoIrq && m34Hdl->nbrCfgCh == 0) {
+			DBGWRT_ERR((DBH,
+				"*** LL - M34_BlockRead: no ch configured\n"));
+			return( ERR_LL_ILL_PARAM );
+		}
+
+		/* the requestet byte size must be a multiple
+		   of the number of block read configured channels */
+		if (m34Hdl->nbrCfgCh == 0 || size % (2 * m34Hdl->nbrCfgCh)) {
+			DBGWRT_ERR((DBH,
+				"*** LL - M34_BlockRead: illegal byte size (M34_IMODE_CHIRQ[_AUTO])\n"));
+			return( ERR_LL_ILL_PARAM );
+		}
+
+		/* M_BUF_CURRBUF makes no sense */
+		if (autoIrq && m34Hdl->bufMode == M_BUF_CURRBUF) {
+			DBGWRT_ERR((DBH,
+				"*** LL - M34_BlockRead: M_BUF_CURRBUF not supported (IMODE_CHIRQ_AUTO)\n"));
+			return( ERR_LL_ILL_PARAM );
+		}
+
+		if( (fktRetCode = M34_LOCK( m34Hdl, hwSem )) )
+			return( fktRetCode );
+
+		/* request plus read-ahead, limited to the buffer size */
+		need = (u_int32)size/2 * (m34Hdl->readAhead + 1);
+		lim  = m34Hdl->inBufSize/2 - (m34Hdl->inBufSize/2) % m34Hdl->nbrCfgCh;
+		if( need > lim )
+			need = ((u_int32)size/2 > lim) ? (u_int32)size/2 : lim;
+
+		irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+
+		/* buffer irq mode with auto irq enable/disable? */
+		if( autoIrq ) {
+			/* idle and all acquired data consumed: start from scratch */
+			if( !m34Hdl->irqIsEnabled && m34Hdl->blkReadGotWords == 0 ) {
+				m34Hdl->blkReadReqWords = 0;
+				m34Hdl->isrCurrCh = 0;
+				m34Hdl->nbrReadCh = 0;
+			}
+
+			/* extend the acquisition target (never shrink it) */
+			if( need > m34Hdl->blkReadReqWords )
+				m34Hdl->blkReadReqWords = need;
+
+			/* (re)enable irq if the target isn't reached yet */
+			if( !m34Hdl->irqIsEnabled &&
+				m34Hdl->blkReadGotWords < m34Hdl->blkReadReqWords ) {
+				DBGWRT_2((DBH, " enable irq\n"));
+				setIrqEnable(1, m34Hdl);
+				MWRITE_D16(m34Hdl->ma34, M34_CTRL_WR,
+						   m34Hdl->chCtrl[m34Hdl->scanList[m34Hdl->nbrReadCh]]);
+			}
+		}
+		else {
+			m34Hdl->blkReadGotWords = 0;
+			m34Hdl->blkReadReqWords = size/2;
+		}
+		OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+
+		if( autoIrq && (fktRetCode = deferTimerSet( m34Hdl )) ) {
+			M34_UNLOCK( m34Hdl, hwSem );
+			return( fktRetCode );
+		}
+
+		M34_UNLOCK( m34Hdl, hwSem );
+	}
+
+	/* adaptive irq mode switch: frames before it, then report it once */
+	if( m34Hdl->adaptMark )
+	{
+		irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+		mark = m34Hdl->bufMode == M_BUF_CURRBUF ? 0 : m34Hdl->adaptMarkWords;
+		if( mark == 0 )
+			m34Hdl->adaptMark = 0;
+		OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+
+		if( mark == 0 )
+			return( M34_ERR_IRQ_ADAPT );
+		if( (u_int32)size/2 > mark )
+			size = (int32)mark * 2;
+	}
+
+	if( m34Hdl->bufMode != M_BUF_CURRBUF )
+	{
+		/* non-blocking: read only the ready frames */
+		if( m34Hdl->rdNonBlock )
+		{
+			irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+			avail = m34Hdl->rdAvailWords;
+			OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+
+			if( m34Hdl->nbrCfgCh )
+				avail -= avail % m34Hdl->nbrCfgCh;
+			if( (u_int32)size/2 > avail )
+				size = (int32)avail * 2;
+
+			if( size == 0 ) {
+				*nbrRdBytesP = 0;
+				return( 0 );
+			}
+		}
+		/* wakeup batching */
+		else if( m34Hdl->batchFrames > 1 &&
+				 (fktRetCode = batchWait( m34Hdl )) )
+			return( fktRetCode );
+
+		/* trigger lost: don't wait for frames that won't come */
+		if( (fktRetCode = trigLostCheck( m34Hdl, size )) )
+			return( fktRetCode );
+	}
+
+	/* MBUF releases rdSem while waiting (setup can't be changed) */
+	m34Hdl->rdActive++;
+	fktRetCode = MBUF_Read( m34Hdl->inbuf, (u_int8*) buf, size, nbrRdBytesP );
+	m34Hdl->rdActive--;
+	if( m34Hdl->latState == M34_LAT_ST_READY )
+		latRead( m34Hdl, *nbrRdBytesP, M34_TSTAMP( m34Hdl ) );
+	rdSwap( m34Hdl, buf, *nbrRdBytesP );
+
+	/*
+	 * rdSem is held again: account consumed words. Target and acquired
+	 * words count from the consumed data, so they can't wrap while
+	 * read-ahead keeps the irq running.
+	 */
+	if( autoIrq ) {
+		irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+		cons = (u_int32)*nbrRdBytesP / 2;
+		if( cons > m34Hdl->blkReadGotWords )
+			cons = m34Hdl->blkReadGotWords;
+		m34Hdl->blkReadGotWords -= cons;
+		m34Hdl->blkReadReqWords -= cons < m34Hdl->blkReadReqWords ?
+								   cons : m34Hdl->blkReadReqWords;
+		OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+	}
+	frameConsumed( m34Hdl, *nbrRdBytesP );
+
+	return( fktRetCode );
+}/*blkRdBuf*/
+
+/****************************** rdSwap **************************************
+ *
+ *  Description:  Converts raw bus words returned by a block read to the
+ *                cpu byte order (byte swapped variant only, nothing to do
+ *                otherwise or with M34_RD_RAW set).
+ *                Two words are swapped per 32-bit access.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl   m34 handle
+ *                buf      read data (16-bit aligned)
+ *                bytes    byte size of buf
+ *
+ *  Output.....:  -
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static void rdSwap( M34_HANDLE *m34Hdl, void *buf, u_int32 bytes )
+{
+#if M34_RAW_SWAP
+	u_int16	*wP = (u_int16*)buf;
+	u_int32	*dP, n = bytes / M34_CH_WIDTH;
+
+	if( m34Hdl->rdRaw || n == 0 )
+		return;
+
+	/* align to 32 bit */
+	if( (U_INT32_OR_64)wP & 2 ) {
+		*wP = OSS_SWAP16( *wP );
+		wP++;
+		n--;
+	}
+
+	for( dP = (u_int32*)wP; n >= 2; n -= 2, dP++ )
+		*dP = M34_SWAP16X2( *dP );
+
+	/* odd word left */
+	if( n ) {
+		wP  = (u_int16*)dP;
+		*wP = OSS_SWAP16( *wP );
+	}
+#endif
+}/*rdSwap*/
+
+/* specialized block read for each buffered irq mode */
+static int32 blkRdLegacy( M34_HANDLE *m34Hdl, void *buf, int32 size, int32 *nbrRdBytesP )
+{
+	return( blkRdBuf( m34Hdl, buf, size, nbrRdBytesP, 0, 0 ) );
+}
+
+static int32 blkRdChIrq( M34_HANDLE *m34Hdl, void *buf, int32 size, int32 *nbrRdBytesP )
+{
+	return( blkRdBuf( m34Hdl, buf, size, nbrRdBytesP, 1, 0 ) );
+}
+
+static int32 blkRdChIrqAuto( M34_HANDLE *m34Hdl, void *buf, int32 size, int32 *nbrRdBytesP )
+{
+	return( blkRdBuf( m34Hdl, buf, size, nbrRdBytesP, 1, 1 ) );
+}
+
+/****************************** M34_BlockWrite *******************************
+ *
+ *  Description:  Write data block to device
+ *
+ *                The function is not supported and returns always an
+ *                ERR_LL_ILL_FUNC error.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl        pointer to low-level driver data structure
+ *                ch           current channel  (always ignored)
+ *                buf          buffer to store read values
+ *                size         should be multiple of width
+ *
+ *  Output.....:  nbrWrBytesP  number of written bytes
+ *                return       ERR_LL_ILL_FUNC
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static int32 M34_BlockWrite
+(
+    LL_HANDLE *llHdl,
+    int32     ch,
+    void      *buf,
+    int32     size,
+    int32     *nbrWrBytesP
+)
+{
+    DBGCMD(M34_HANDLE  *m34Hdl = (M34_HANDLE*) llHdl);
+
+    DBGWRT_1((DBH, "LL - M34_BlockWrite: size=%ld\n",size));
+
+    *nbrWrBytesP = 0;
+
+
+    return( ERR_LL_ILL_FUNC );
+}
+
+/****************************** M34_Irq *************************************
+ *
+ *  Description:  Reads all configured ( M34_CH_RDBLK_IRQ ) to buffer or
+ *                current channel (dummy) to reset irq cause.
+ *                Stores the values to buffer in M_BUF_CURRBUF, M_BUF_RINGBUF
+ *                and M_BUF_RINGBUF_OVERWR buffer mode.
+ *
+ *                The irq can't be caused by the module while its irq is
+ *                disabled. In M34_IMODE_FIX/BURST the conversions are started
+ *                by the driver, so only a conversion in flight can interrupt.
+ *                In both cases foreign irqs are rejected without hw access.
+ *                Otherwise the irq is handled as unknown: the module has no
+ *                irq status (see m34_scan.h), so an irq with enabled module
+ *                irq is never provably ours and the other handlers of a
+ *                shared line are called too. A foreign irq during a
+ *                conversion still reads the channel early; don't share the
+ *                line with a busy device in M34_IMODE_FIX/BURST.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl  pointer to low-level driver data structure
+ *
+ *  Output.....:  return LL_IRQ_DEV_NOT  irq disabled/no conversion pending
+ *                       LL_IRQ_UNKNOWN  irq handled (no irq status)
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static int32 M34_Irq
+(
+    LL_HANDLE *llHdl
+)
+{
+	M34_HANDLE	*m34Hdl = (M34_HANDLE*) llHdl;
+	int32		irqRet;
+	u_int32		ts = 0, d, timed;
+
+#ifdef WINNT
+	LARGE_INTEGER	t1, t2;
+#endif
+
+	/* module irq disabled: can't be our irq (shared irq line) */
+	if (!m34Hdl->irqIsEnabled)
+		return( LL_IRQ_DEV_NOT );
+
+#ifdef WINNT
+	t1 = KeQueryPerformanceCounter(NULL);
+#endif
+
+	/* isr time statistics, adaptive irq mode, latency frame start:
+	   timestamps only if one of them is on (all off by default) */
+	timed = m34Hdl->isrStats | m34Hdl->adaptOn;
+	if( timed || m34Hdl->latSample ) {
+		ts = M34_TSTAMP( m34Hdl );
+		if( m34Hdl->nbrReadCh == 0 )
+			m34Hdl->latIsrTs = ts;
+	}
+
+	/* irq mode specific implementation (see selectModeFkt) */
+	irqRet = m34Hdl->irqFkt( m34Hdl );
+
+	if( irqRet != LL_IRQ_DEV_NOT ) {
+		m34Hdl->irqCount++;
+		if( timed ) {
+			d = M34_TSTAMP( m34Hdl ) - ts;
+			if( m34Hdl->isrStats ) {
+				m34Hdl->tele.isrCount++;
+				m34Hdl->tele.isrTime += d;
+				if( m34Hdl->tele.isrTimeMax < d )
+					m34Hdl->tele.isrTimeMax = d;
+			}
+			if( m34Hdl->adaptOn )
+				m34Hdl->adaptIsrTs += d;
+		}
+	}
+
+#ifdef WINNT
+	t2 = KeQueryPerformanceCounter(NULL);
+	m34Hdl->isrTicks.QuadPart += t2.QuadPart - t1.QuadPart;
+#endif
+
+    return( irqRet );
+}/*M34_Irq*/
+
+/****************************** irqDisable **********************************
+ *
+ *  Description:  Disables the module irq (isr or irq masked).
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl   m34 handle
+ *
+ *  Output.....:  -
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static void irqDisable( M34_HANDLE *m34Hdl )
+{
+	IDBGWRT_2((DBH, " disable irq\n"));
+	M34_TRACE( m34Hdl, M34_TEV_IRQ_DISABLE, M34_TRC_NOCH, m34Hdl->irqMode, 0 );
+	setIrqEnable(0, m34Hdl);
+	MWRITE_D16(m34Hdl->ma34, M34_CTRL_WR, m34Hdl->chCtrl[m34Hdl->isrCurrCh]);
+	m34Hdl->convPending = 0;
+}/*irqDisable*/
+
+/****************************** irqFix **************************************
+ *
+ *  Description:  Isr for M34_IMODE_FIX. Reads one channel per irq into the
+ *                block read buffer and starts the next conversion.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl   m34 handle
+ *
+ *  Output.....:  return   LL_IRQ_UNKNOWN | LL_IRQ_DEV_NOT
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static int32 irqFix( M34_HANDLE *m34Hdl )
+{
+	u_int16		dummy;
+
+	/* driver paced: only a started conversion can interrupt */
+	if (!m34Hdl->convPending)
+		return( LL_IRQ_DEV_NOT );
+
+	IDBGWRT_1((DBH, "LL - M34_Irq: M34_IMODE_FIX\n"));
+	M34_TRACE( m34Hdl, M34_TEV_IRQ_FIX, m34Hdl->isrCurrCh, m34Hdl->isrCurrCh, m34Hdl->skip );
+
+	if( m34Hdl->skip ){
+		/* read data and start next conversion */
+		dummy = MREAD_D16(m34Hdl->ma34, M34_DATA_RD_START_INC);
+		m34Hdl->skip--;
+	}
+	else {
+		/* read data and start next conversion */
+		m34Hdl->buf[m34Hdl->isrCurrCh] = M34_RD_RAW16(m34Hdl->ma34, M34_DATA_RD_START_INC);
+		IDBGWRT_2((DBH, " buf[%d] = 0x%x\n",
+			m34Hdl->isrCurrCh, m34Hdl->buf[m34Hdl->isrCurrCh]));
+
+		/* not all data read? */
+		if (m34Hdl->isrCurrCh < (m34Hdl->nbrOfChannels - 1)) {
+			m34Hdl->isrCurrCh++;
+		}
+		/* all data read */
+		else {
+			IDBGWRT_2((DBH, " all data read\n"));
+			OSS_SemSignal(m34Hdl->osHdl, m34Hdl->sem);
+			irqDisable( m34Hdl );
+		}
+	}
+
+	return( LL_IRQ_UNKNOWN );
+}/*irqFix*/
+
+/****************************** irqBurst ************************************
+ *
+ *  Description:  Isr for M34_IMODE_BURST. Reads the conversion of the burst
+ *                channel into the block read buffer and starts the next
+ *                conversion (no control write). The first skip conversions
+ *                let the input settle.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl   m34 handle
+ *
+ *  Output.....:  return   LL_IRQ_UNKNOWN | LL_IRQ_DEV_NOT
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static int32 irqBurst( M34_HANDLE *m34Hdl )
+{
+	u_int16		val;
+
+	/* driver paced: only a started conversion can interrupt */
+	if (!m34Hdl->convPending)
+		return( LL_IRQ_DEV_NOT );
+
+	M34_TRACE( m34Hdl, M34_TEV_IRQ_BURST, m34Hdl->isrCurrCh,
+			   m34Hdl->burstIdx, m34Hdl->skip );
+
+	/* read data and start next conversion */
+	val = M34_RD_RAW16(m34Hdl->ma34, M34_DATA_RD_START);
+
+	if (m34Hdl->skip) {
+		m34Hdl->skip--;
+		return( LL_IRQ_UNKNOWN );
+	}
+
+	if (m34Hdl->burstIdx == 0)
+		m34Hdl->burstT0 = M34_TSTAMP( m34Hdl );
+	m34Hdl->buf[m34Hdl->burstIdx] = val;
+
+	/* all samples read */
+	if (++m34Hdl->burstIdx == m34Hdl->burstNbr) {
+		m34Hdl->burstT1 = M34_TSTAMP( m34Hdl );
+		IDBGWRT_2((DBH, " burst complete\n"));
+		OSS_SemSignal(m34Hdl->osHdl, m34Hdl->sem);
+		irqDisable( m34Hdl );
+	}
+
+	return( LL_IRQ_UNKNOWN );
+}/*irqBurst*/
+
+/****************************** irqChIrq ************************************
+ *
+ *  Description:  Common isr for the one ch per irq modes.
+ *                Reads the next block read channel (scanList) per irq.
+ *                The mode flag is constant for each caller, so the
+ *                compiler generates one specialized body per mode.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl   m34 handle
+ *                autoIrq  automatic irq disable (M34_IMODE_CHIRQ_AUTO)
+ *
+ *  Output.....:  return   LL_IRQ_UNKNOWN
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static int32 irqChIrq( M34_HANDLE *m34Hdl, const int autoIrq )
+{
+	u_int16		dummy;
+	u_int16		*buf;
+	u_int32		ch;
+	int32		gotsize;
+
+	IDBGWRT_1((DBH, "LL - M34_Irq: M34_IMODE_CHIRQ[_AUTO]\n"));
+
+	/* at least one channel must be configured for block read */
+	if (m34Hdl->nbrCfgCh == 0) {
+		IDBGWRT_ERR((DBH,
+			"*** LL - M34_Irq: no ch configured: disable irq\n"));
+		M34_TRACE( m34Hdl, M34_TEV_ERR_NOCH, M34_TRC_NOCH, m34Hdl->irqMode, 0 );
+		irqDisable( m34Hdl );
+		/* reset irq cause */
+		dummy = MREAD_D16(m34Hdl->ma34, M34_DATA_START_RD); /* dummy conversion */
+		return( LL_IRQ_UNKNOWN );
+	}
+
+	/* trigger edge (the auto mode sees gaps between the reads) */
+	if (!autoIrq)
+		trigEdge( m34Hdl );
+
+	/* get space for one channel */
+	if ((buf = sinkGetBuf(m34Hdl, 1, &gotsize)) != 0)
+	{
+		IDBGWRT_2((DBH, " buffer space available\n"));
+
+		ch = m34Hdl->scanList[m34Hdl->nbrReadCh];
+		m34Hdl->isrCurrCh = ch;
+
+		IDBGWRT_3((DBH, " read ch=%d\n", ch));
+		M34_TRACE( m34Hdl, M34_TEV_IRQ_CHIRQ, ch,
+				   m34Hdl->nbrReadCh, m34Hdl->blkReadGotWords );
+
+		/* set current ch, dummy reads */
+		M34_SCAN_SETTLE(m34Hdl->ma34, m34Hdl->chCtrl[ch], m34Hdl->chDummyRd[ch]);
+
+		/* conversion */
+		*buf = M34_CONV_RAW(m34Hdl->ma34);
+
+		/* all configured ch read? */
+		if (++m34Hdl->nbrReadCh == m34Hdl->nbrCfgCh) {
+			IDBGWRT_3((DBH, " all configured ch read\n"));
+			/*
+			* let MBUF_Read():
+			* 1. copy data
+			* 2. wait for more data if requested
+			*/
+			latFrame( m34Hdl );
+			sinkReady( m34Hdl );
+			M34_TRACE( m34Hdl, M34_TEV_BUF_READY, M34_TRC_NOCH, m34Hdl->nbrCfgCh, 0 );
+			m34Hdl->nbrReadCh = 0;
+			m34Hdl->isrCurrCh = 0;
+			m34Hdl->blkReadGotWords += m34Hdl->nbrCfgCh;
+
+			/* buffer irq mode with auto irq enable/disable? */
+			if (autoIrq) {
+				/* request and read-ahead complete? */
+				if (m34Hdl->blkReadGotWords >= m34Hdl->blkReadReqWords)
+					irqDisable( m34Hdl );
+			}
+			/* frame end: adaptive switch */
+			else if (m34Hdl->adaptReq != m34Hdl->adaptCur)
+				adaptApply( m34Hdl );
+		}
+	}
+	/* no more buffer space (all requested date read) */
+	else
+	{
+		IDBGWRT_2((DBH, " no buffer space\n"));
+		M34_TRACE( m34Hdl, M34_TEV_BUF_NOSPACE, M34_TRC_NOCH, m34Hdl->irqMode, 0 );
+		/* reset irq cause */
+		dummy = MREAD_D16(m34Hdl->ma34, M34_DATA_START_RD); /* dummy conversion */
+
+		/* nobody reads: stop, the next block read resumes the frame */
+		if (autoIrq)
+			irqDisable( m34Hdl );
+		/* a frame lost per nbrCfgCh lost channel samples */
+		else if (++m34Hdl->rdLostCh >= m34Hdl->nbrCfgCh) {
+			m34Hdl->rdLostCh = 0;
+			M34_RD_LOST( m34Hdl );
+		}
+	}
+
+	return( LL_IRQ_UNKNOWN );
+}/*irqChIrq*/
+
+/* specialized isr for each one ch per irq mode */
+static int32 irqChIrqMan( M34_HANDLE *m34Hdl )
+{
+	return( irqChIrq( m34Hdl, 0 ) );
+}
+
+static int32 irqChIrqAuto( M34_HANDLE *m34Hdl )
+{
+	return( irqChIrq( m34Hdl, 1 ) );
+}
+
+/****************************** irqLegacy ***********************************
+ *
+ *  Description:  Isr for M34_IMODE_LEGACY. Reads all block read channels
+ *                (scanList) per irq.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl   m34 handle
+ *
+ *  Output.....:  return   LL_IRQ_UNKNOWN
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static int32 irqLegacy( M34_HANDLE *m34Hdl )
+{
+	u_int16		dummy;
+
+	IDBGWRT_1((DBH, "LL - M34_Irq: M34_IMODE_LEGACY\n"));
+
+	/* at least one channel must be configured for block read */
+	if (m34Hdl->nbrCfgCh == 0) {
+		IDBGWRT_ERR((DBH,
+			"*** LL - M34_Irq: no ch configured: disable irq\n"));
+		M34_TRACE( m34Hdl, M34_TEV_ERR_NOCH, M34_TRC_NOCH, m34Hdl->irqMode, 0 );
+		irqDisable( m34Hdl );
+		/* reset irq cause */
+		dummy = MREAD_D16(m34Hdl->ma34, M34_DATA_START_RD); /* dummy conversion */
+		return( LL_IRQ_UNKNOWN );
+	}
+
+	trigEdge( m34Hdl );
+
+	if( !scanFrame( m34Hdl ) )
+	{
+		/* reset irq cause */
+		dummy = MREAD_D16(m34Hdl->ma34, M34_DATA_START_RD); /* dummy conversion */
+	}/*if*/
+
+	/* frame end: adaptive switch */
+	if( m34Hdl->adaptReq != m34Hdl->adaptCur )
+		adaptApply( m34Hdl );
+
+	return( LL_IRQ_UNKNOWN );
+}/*irqLegacy*/
+
+/****************************** scanFrame ***********************************
+ *
+ *  Description:  Converts all block read channels (scanList) into the
+ *                read buffer (M34_IMODE_LEGACY isr and frame timer) or,
+ *                with M34_DEFER_PUBLISH, into the staging ring.
+ *                Called from isr or with irqs masked.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl   m34 handle
+ *
+ *  Output.....:  return   1=frame stored, 0=no buffer space
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static int32 scanFrame( M34_HANDLE *m34Hdl )
+{
+	u_int16		*buf;
+	u_int32		idx, ch, t, next = 0;
+	int32		nbrOfBlocks;
+	int32		gotsize;
+	const int	stage = m34Hdl->deferMask & M34_DEFER_PUBLISH;
+
+	/*-------------------------------------+
+	|  deferred: raw frame to staging ring |
+	+-------------------------------------*/
+	if (stage)
+	{
+		next = m34Hdl->stageWr + 1 == m34Hdl->stageNbr ? 0 : m34Hdl->stageWr + 1;
+		if (next == m34Hdl->stageRd) {
+			m34Hdl->tele.stageLost++;
+			M34_TRACE( m34Hdl, M34_TEV_BUF_NOSPACE, M34_TRC_NOCH, m34Hdl->irqMode, 0 );
+			return( 0 );
+		}
+		buf = m34Hdl->stageMem + m34Hdl->stageWr * m34Hdl->stageStride;
+		*buf++  = (u_int16)m34Hdl->nbrCfgCh;
+		gotsize = m34Hdl->nbrCfgCh;
+	}
+	/*-------------------------------------+
+	|  input values (configured channels)  |
+	+-------------------------------------*/
+	else if ((buf = sinkGetBuf(m34Hdl, m34Hdl->nbrCfgCh, &gotsize)) == 0)
+	{
+		IDBGWRT_2((DBH, " no buffer space\n"));
+		M34_RD_LOST( m34Hdl );
+		M34_TRACE( m34Hdl, M34_TEV_BUF_NOSPACE, M34_TRC_NOCH, m34Hdl->irqMode, 0 );
+		return( 0 );
+	}
+
+	IDBGWRT_2((DBH, " buffer space available\n"));
+
+	for (idx = 0; idx < m34Hdl->nbrCfgCh; idx++)
+	{
+		ch = m34Hdl->scanList[idx];
+
+		/*-------------------------------------+
+		|  set current ch, settle & conversion |
+		+-------------------------------------*/
+		M34_SCAN_SETTLE(m34Hdl->ma34, m34Hdl->chCtrl[ch], m34Hdl->chDummyRd[ch]);
+		*buf++ = M34_CONV_RAW(m34Hdl->ma34);
+		M34_TRACE( m34Hdl, M34_TEV_IRQ_LEGACY, ch, idx + 1, m34Hdl->irqCount );
+
+		if (((idx + 1) < m34Hdl->nbrCfgCh)		/* read another channel ? */
+			&& ((int32)(idx + 1) == gotsize))	/* got space full ? */
+		{
+			/* calculate missing buffer space */
+			nbrOfBlocks = m34Hdl->nbrCfgCh - (idx + 1);
+			/* not enough bytes gotten - wrap around buffer
+			   (never with M34_FRAME_ALIGN) */
+			if ((buf = sinkGetBuf(m34Hdl, nbrOfBlocks, &gotsize)) == 0)
+			{
+				/* wrap around failed */
+				IDBGWRT_ERR((DBH, "*** LL - M34_Irq: wrap around failed\n"));
+				M34_TRACE( m34Hdl, M34_TEV_ERR_WRAP, ch, nbrOfBlocks, 0 );
+				break;
+			}/*if*/
+			gotsize += idx + 1;
+		}/*if*/
+	}/*for*/
+
+	latFrame( m34Hdl );
+
+	/* publish the staged frame (deferred stage) */
+	if (stage) {
+		M34_WMB();		/* frame stored before stageWr */
+		m34Hdl->stageWr = next;
+		t = (next + m34Hdl->stageNbr - m34Hdl->stageRd) % m34Hdl->stageNbr;
+		if (t > m34Hdl->tele.stageMax)
+			m34Hdl->tele.stageMax = t;
+		return( 1 );
+	}
+
+	sinkReady( m34Hdl );  /* blockread ready */
+	M34_TRACE( m34Hdl, M34_TEV_BUF_READY, M34_TRC_NOCH, idx, 0 );
+	return( 1 );
+}/*scanFrame*/
+
+/****************************** timerPeriodMs *******************************
+ *
+ *  Description:  Calculates the frame timer period for a frame rate.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  rate     frame rate [Hz] 1..M34_SAMPLE_RATE_MAX
+ *
+ *  Output.....:  return   period [ms] (min 1)
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static u_int32 timerPeriodMs( u_int32 rate )
+{
+	u_int32 ms = (1000 + rate/2) / rate;
+
+	return( ms ? ms : 1 );
+}/*timerPeriodMs*/
+
+/****************************** timerFrame **********************************
+ *
+ *  Description:  Frame timer callback (M34_IMODE_TIMER).
+ *                Converts one frame into the read buffer and updates the
+ *                period statistics. The period statistics stay 0 with a
+ *                timestamp coarser than M34_TMR_TSFREQ_MIN, ms periods
+ *                would only show the tick quantisation.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  arg      m34 handle
+ *
+ *  Output.....:  -
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static void timerFrame( void *arg )
+{
+	M34_HANDLE		*m34Hdl = (M34_HANDLE*) arg;
+	M34_TELEMETRY	*teleP  = &m34Hdl->tele;
+	OSS_IRQ_STATE	irqState;
+	u_int32			ts, period, dev;
+
+	/* serialize with setstats changing the channel config */
+	irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+
+	if( !m34Hdl->tmrRun || m34Hdl->nbrCfgCh == 0 )
+		goto CLEANUP;
+
+	/*--------------------+
+	|  period statistics  |
+	+--------------------*/
+	ts = M34_TSTAMP( m34Hdl );
+	m34Hdl->latIsrTs = ts;
+	if( m34Hdl->tmrTiming && teleP->tmrFrames + teleP->tmrMissed )
+	{
+		period = ts - m34Hdl->tmrLastTs;
+		dev = period > teleP->tmrPeriod ? period - teleP->tmrPeriod :
+										  teleP->tmrPeriod - period;
+
+		if( period < teleP->tmrPeriodMin || teleP->tmrPeriodMin == 0 )
+			teleP->tmrPeriodMin = period;
+		if( period > teleP->tmrPeriodMax )
+			teleP->tmrPeriodMax = period;
+		if( dev > teleP->tmrJitterMax )
+			teleP->tmrJitterMax = dev;
+	}
+	else
+		period = 0;
+	m34Hdl->tmrLastTs = ts;
+
+	M34_TRACE( m34Hdl, M34_TEV_TMR_FRAME, M34_TRC_NOCH, period, teleP->tmrMissed );
+
+	if( scanFrame( m34Hdl ) )
+		teleP->tmrFrames++;
+	else
+		teleP->tmrMissed++;
+
+CLEANUP:
+	OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+}/*timerFrame*/
+
+/****************************** timerStart **********************************
+ *
+ *  Description:  Resets the timer statistics and starts the frame timer.
+ *                Called with the hw lock taken.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl   m34 handle
+ *
+ *  Output.....:  return   0 | error code
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static int32 timerStart( M34_HANDLE *m34Hdl )
+{
+	OSS_IRQ_STATE	irqState;
+	int32			error;
+	u_int32			freq = traceTsFreq( m34Hdl );
+
+	if( m34Hdl->tmrRun )
+		return( 0 );
+
+	/* at least one channel must be configured for block read */
+	if( m34Hdl->nbrCfgCh == 0 )
+		return( ERR_LL_ILL_PARAM );
+
+	m34Hdl->tmrPeriodMs = timerPeriodMs( m34Hdl->sampleRate );
+
+	irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+	m34Hdl->tele.tmrFrames    = 0;
+	m34Hdl->tele.tmrMissed    = 0;
+	m34Hdl->tele.tmrPeriod    = freq >= 1000 ? m34Hdl->tmrPeriodMs * (freq / 1000) :
+												 m34Hdl->tmrPeriodMs * freq / 1000;
+	m34Hdl->tele.tmrPeriodMin = 0;
+	m34Hdl->tele.tmrPeriodMax = 0;
+	m34Hdl->tele.tmrJitterMax = 0;
+	m34Hdl->tmrTiming = (freq >= M34_TMR_TSFREQ_MIN);
+	m34Hdl->tmrRun = 1;
+	OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+
+	DBGWRT_2((DBH, " start frame timer %d ms\n", m34Hdl->tmrPeriodMs));
+
+	error = OSS_TimerStart( m34Hdl->osHdl, m34Hdl->timer,
+							m34Hdl->tmrPeriodMs, 1 );
+	if( error )
+		m34Hdl->tmrRun = 0;
+
+	return( error );
+}/*timerStart*/
+
+/****************************** timerStop ***********************************
+ *
+ *  Description:  Stops the frame timer.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl   m34 handle
+ *
+ *  Output.....:  -
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static void timerStop( M34_HANDLE *m34Hdl )
+{
+	if( !m34Hdl->tmrRun )
+		return;
+
+	DBGWRT_2((DBH, " stop frame timer\n"));
+	m34Hdl->tmrRun = 0;
+	OSS_TimerStop( m34Hdl->osHdl, m34Hdl->timer );
+}/*timerStop*/
+
+/****************************** trigEdge ************************************
+ *
+ *  Description:  Updates the trigger period and jitter estimate with an
+ *                external trigger edge (irq mode 0/1 isr):
+ *                  period += (d - period) / 8
+ *                  jitter += (|d - period| - jitter) / 16
+ *                d is the time since the previous edge, the estimates
+ *                have M34_TRIG_FRAC fraction bits. The gap before an edge
+ *                ending a trigger loss isn't counted.
+ *                Periods below M34_TRIG_EST_TS timestamp units would only
+ *                show the timestamp quantisation, the telemetry reports
+ *                0 (unknown) then.
+ *                Called from isr.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl   m34 handle
+ *
+ *  Output.....:  -
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static void trigEdge( M34_HANDLE *m34Hdl )
+{
+	M34_TELEMETRY	*teleP = &m34Hdl->tele;
+	u_int32			ts = M34_TSTAMP( m34Hdl );
+	u_int32			d, dev, per = m34Hdl->trigPer, jit = m34Hdl->trigJit;
+
+	if( m34Hdl->trigLost )
+		m34Hdl->trigLost = 0;
+	else if( teleP->trigEdges )
+	{
+		d = ts - m34Hdl->trigLastTs;
+		if( d > M34_TRIG_D_MAX )
+			d = M34_TRIG_D_MAX;
+		d <<= M34_TRIG_FRAC;
+
+		/* first period: start value */
+		if( teleP->trigEdges == 1 )
+			per = d;
+		else {
+			dev = d > per ? d - per : per - d;
+			per = d > per ? per + (d - per) / 8 : per - (per - d) / 8;
+			jit = dev > jit ? jit + (dev - jit) / 16 : jit - (jit - dev) / 16;
+		}
+
+		m34Hdl->trigPer   = per;
+		m34Hdl->trigJit   = jit;
+		if( (per >> M34_TRIG_FRAC) >= M34_TRIG_EST_TS ) {
+			teleP->trigPeriod = per >> M34_TRIG_FRAC;
+			teleP->trigJitter = jit >> M34_TRIG_FRAC;
+		}
+		else
+			teleP->trigPeriod = teleP->trigJitter = 0;
+	}
+
+	teleP->trigEdges++;
+	m34Hdl->trigLastTs = ts;
+}/*trigEdge*/
+
+/****************************** trigReset ***********************************
+ *
+ *  Description:  Resets the trigger estimate and statistics at the start
+ *                of an acquisition.
+ *                Called with irqs masked.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl   m34 handle
+ *
+ *  Output.....:  -
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static void trigReset( M34_HANDLE *m34Hdl )
+{
+	m34Hdl->trigPer          = 0;
+	m34Hdl->trigJit          = 0;
+	m34Hdl->trigLost         = 0;
+	m34Hdl->tele.trigEdges   = 0;
+	m34Hdl->tele.trigPeriod  = 0;
+	m34Hdl->tele.trigJitter  = 0;
+	m34Hdl->tele.trigLost    = 0;
+}/*trigReset*/
+
+/****************************** trigUs **************************************
+ *
+ *  Description:  Converts a trigger estimate to microseconds.
+ *                Unknown while the period is below M34_TRIG_EST_TS
+ *                timestamp units (see trigEdge).
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl   m34 handle
+ *                val      estimate [M34_TSTAMP, M34_TRIG_FRAC fraction bits]
+ *
+ *  Output.....:  return   estimate [us] (0=unknown)
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static u_int32 trigUs( M34_HANDLE *m34Hdl, u_int32 val )
+{
+	u_int32	freq = traceTsFreq( m34Hdl );
+	u_int32	mul  = 1000000 >> M34_TRIG_FRAC;
+
+	/* keep val * mul within 32 bit */
+	while( freq > 1 && val > 0xffffffff / mul ) {
+		freq >>= 1;
+		val  >>= 1;
+	}
+
+	if( freq == 0 || (m34Hdl->trigPer >> M34_TRIG_FRAC) < M34_TRIG_EST_TS )
+		return( 0 );
+
+	return( val * mul / freq );
+}/*trigUs*/
+
+/****************************** trigWdFkt ***********************************
+ *
+ *  Description:  Trigger loss watchdog (timer callback, every
+ *                M34_TRIG_WD_PERIOD ms while enabled).
+ *                The trigger is lost when no edge arrived within
+ *                M34_TRIG_LOST_K estimated periods (at least
+ *                M34_TRIG_MIN_TS timestamp units).
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  arg      m34 handle
+ *
+ *  Output.....:  -
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static void trigWdFkt( void *arg )
+{
+	M34_HANDLE		*m34Hdl = (M34_HANDLE*) arg;
+	OSS_IRQ_STATE	irqState;
+	u_int32			per, limit, elapsed, k = m34Hdl->trigLostK;
+
+	irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+
+	/* no estimate yet or already lost */
+	if( !m34Hdl->irqIsEnabled || m34Hdl->trigLost || k == 0 ||
+		m34Hdl->tele.trigEdges < 2 )
+		goto CLEANUP;
+
+	per     = m34Hdl->trigPer >> M34_TRIG_FRAC;
+	limit   = per > 0xffffffff / k ? 0xffffffff : per * k;
+	if( limit < M34_TRIG_MIN_TS )
+		limit = M34_TRIG_MIN_TS;
+	elapsed = M34_TSTAMP( m34Hdl ) - m34Hdl->trigLastTs;
+
+	if( elapsed > limit )
+	{
+		m34Hdl->trigLost = 1;
+		m34Hdl->tele.trigLost++;
+		M34_TRACE( m34Hdl, M34_TEV_ERR_TRIG_LOST, M34_TRC_NOCH, per, elapsed );
+
+		if( m34Hdl->sigTrig )
+			OSS_SigSend( m34Hdl->osHdl, m34Hdl->sigTrig );
+
+		/* end a batch wait */
+		if( m34Hdl->batchSleep ) {
+			m34Hdl->batchSleep = 0;
+			notify( m34Hdl, M34_NTF_BATCH );
+		}
+	}
+
+CLEANUP:
+	OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+}/*trigWdFkt*/
+
+/****************************** trigWdSet ***********************************
+ *
+ *  Description:  Starts/stops the trigger loss watchdog. It runs while
+ *                M34_TRIG_LOST_K is set and an irq mode 0/1 acquisition
+ *                is enabled.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl   m34 handle
+ *
+ *  Output.....:  -
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static void trigWdSet( M34_HANDLE *m34Hdl )
+{
+	u_int32	run = m34Hdl->trigLostK && m34Hdl->irqIsEnabled &&
+				  (m34Hdl->irqMode == M34_IMODE_LEGACY ||
+				   m34Hdl->irqMode == M34_IMODE_CHIRQ);
+
+	if( run && !m34Hdl->trigWdRun ) {
+		if( OSS_TimerStart( m34Hdl->osHdl, m34Hdl->trigTimer,
+							M34_TRIG_WD_PERIOD, 1 ) == 0 )
+			m34Hdl->trigWdRun = 1;
+	}
+	else if( !run && m34Hdl->trigWdRun ) {
+		OSS_TimerStop( m34Hdl->osHdl, m34Hdl->trigTimer );
+		m34Hdl->trigWdRun = 0;
+	}
+}/*trigWdSet*/
+
+/****************************** trigLostCheck *******************************
+ *
+ *  Description:  Checks if a buffered block read would wait for frames
+ *                of a lost trigger.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl   m34 handle
+ *                size     byte size to read
+ *
+ *  Output.....:  return   0 | M34_ERR_TRIG_LOST
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static int32 trigLostCheck( M34_HANDLE *m34Hdl, int32 size )
+{
+	OSS_IRQ_STATE	irqState;
+	int32			lost;
+
+	irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+	lost = m34Hdl->trigLost && m34Hdl->rdAvailWords < (u_int32)size/2;
+	OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+
+	return( lost ? M34_ERR_TRIG_LOST : 0 );
+}/*trigLostCheck*/
+
+/****************************** adaptApply **********************************
+ *
+ *  Description:  Switches the isr to the requested strategy (adaptive irq
+ *                mode). Called from the irq mode 0/1 isr at the end of a
+ *                frame, so the next irq starts a new frame.
+ *                The trigger estimate restarts (edges per frame change).
+ *                The block read returns the frames ready before the first
+ *                unreported switch, then fails once with
+ *                M34_ERR_IRQ_ADAPT (see blkRdBuf).
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl   m34 handle
+ *
+ *  Output.....:  -
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static void adaptApply( M34_HANDLE *m34Hdl )
+{
+	u_int32	mode = m34Hdl->adaptReq;
+
+	m34Hdl->adaptCur  = mode;
+	m34Hdl->irqFkt    = mode == M34_IMODE_CHIRQ ? irqChIrqMan : irqLegacy;
+	m34Hdl->isrCurrCh = 0;
+	m34Hdl->nbrReadCh = 0;
+
+	m34Hdl->trigPer        = 0;
+	m34Hdl->trigJit        = 0;
+	m34Hdl->tele.trigEdges = 0;
+
+	if( !m34Hdl->adaptMark ) {
+		m34Hdl->adaptMark      = 1;
+		m34Hdl->adaptMarkWords = m34Hdl->rdAvailWords;
+	}
+
+	m34Hdl->tele.adaptMode = mode;
+	m34Hdl->tele.adaptSwitches++;
+	M34_TRACE( m34Hdl, M34_TEV_IRQ_ADAPT, M34_TRC_NOCH, mode,
+			   m34Hdl->tele.adaptIrqRate );
+}/*adaptApply*/
+
+/****************************** adaptFkt ************************************
+ *
+ *  Description:  Adaptive irq mode policy (timer callback, every
+ *                M34_ADAPT_PERIOD ms while enabled).
+ *                Evaluates irq rate, isr load and read buffer level of
+ *                the last window and requests a strategy switch (see
+ *                M34_IRQ_ADAPT in SetStat). The isr load is the sum of
+ *                the isr durations measured with the fine M34_TSTAMP.
+ *                Each irq is one trigger edge in both modes: a switch
+ *                keeps the irq rate and changes the isr time per irq
+ *                (mode 1: about 1/nbrCfgCh of mode 0).
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  arg      m34 handle
+ *
+ *  Output.....:  -
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static void adaptFkt( void *arg )
+{
+	M34_HANDLE		*m34Hdl = (M34_HANDLE*) arg;
+	M34_TELEMETRY	*teleP  = &m34Hdl->tele;
+	OSS_IRQ_STATE	irqState;
+	u_int32			now, win, isr, rate, load, level;
+
+	irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+
+	if( !m34Hdl->adaptOn || !m34Hdl->irqIsEnabled )
+		goto CLEANUP;
+
+	/* close the window */
+	now  = M34_TSTAMP( m34Hdl );
+	win  = now - m34Hdl->adaptWinTs;
+	isr  = m34Hdl->adaptIsrTs;
+	rate = (m34Hdl->irqCount - m34Hdl->adaptIrqCnt) * (1000 / M34_ADAPT_PERIOD);
+	m34Hdl->adaptWinTs  = now;
+	m34Hdl->adaptIrqCnt = m34Hdl->irqCount;
+	m34Hdl->adaptIsrTs  = 0;
+
+	if( win == 0 )
+		goto CLEANUP;
+	load  = isr >= win ? 100 :
+			isr > 0xffffffff / 100 ? isr / (win / 100) : isr * 100 / win;
+	level = m34Hdl->inBufSize ?
+			m34Hdl->rdAvailWords * 2 * 100 / m34Hdl->inBufSize : 0;
+
+	teleP->adaptIrqRate = rate;
+	teleP->adaptIsrLoad = load;
+
+	/* switch pending */
+	if( m34Hdl->adaptReq != m34Hdl->adaptCur )
+		goto CLEANUP;
+
+	if( m34Hdl->adaptCur == M34_IMODE_LEGACY ) {
+		/* long isrs: split them, if the irq rate allows it */
+		if( load >= m34Hdl->adaptLoadHi &&
+			rate < m34Hdl->adaptRateHi / 4 * 3 &&
+			level < M34_ADAPT_LEVEL / 2 )
+			m34Hdl->adaptReq = M34_IMODE_CHIRQ;
+	}
+	else {
+		/* irq overhead, or mode 0 would stay below half the load */
+		if( rate >= m34Hdl->adaptRateHi ||
+			load * m34Hdl->nbrCfgCh < m34Hdl->adaptLoadHi / 2 )
+			m34Hdl->adaptReq = M34_IMODE_LEGACY;
+	}
+
+CLEANUP:
+	OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+}/*adaptFkt*/
+
+/****************************** adaptSet ************************************
+ *
+ *  Description:  Starts/stops the adaptive irq mode policy timer. It runs
+ *                while M34_IRQ_ADAPT is set and an irq mode 0/1
+ *                acquisition is enabled. When switched off the isr
+ *                returns to the set irq mode at the next frame end.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl   m34 handle
+ *
+ *  Output.....:  -
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static void adaptSet( M34_HANDLE *m34Hdl )
+{
+	OSS_IRQ_STATE	irqState;
+	u_int32			run = m34Hdl->adaptOn && m34Hdl->irqIsEnabled &&
+						  (m34Hdl->irqMode == M34_IMODE_LEGACY ||
+						   m34Hdl->irqMode == M34_IMODE_CHIRQ);
+
+	irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+	if( run && !m34Hdl->adaptRun ) {
+		m34Hdl->adaptWinTs  = M34_TSTAMP( m34Hdl );
+		m34Hdl->adaptIrqCnt = m34Hdl->irqCount;
+		m34Hdl->adaptIsrTs  = 0;
+	}
+	/* back to the set mode (isr idle: at once) */
+	if( !m34Hdl->adaptOn && m34Hdl->adaptCur != m34Hdl->irqMode ) {
+		if( m34Hdl->irqIsEnabled )
+			m34Hdl->adaptReq = m34Hdl->irqMode;
+		else
+			selectModeFkt( m34Hdl );
+	}
+	OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+
+	if( run && !m34Hdl->adaptRun ) {
+		if( OSS_TimerStart( m34Hdl->osHdl, m34Hdl->adaptTimer,
+							M34_ADAPT_PERIOD, 1 ) == 0 )
+			m34Hdl->adaptRun = 1;
+	}
+	else if( !run && m34Hdl->adaptRun ) {
+		OSS_TimerStop( m34Hdl->osHdl, m34Hdl->adaptTimer );
+		m34Hdl->adaptRun = 0;
+	}
+}/*adaptSet*/
+
+/****************************** latFrame ************************************
+ *
+ *  Description:  Latency tracer: a frame is converted (before it is
+ *                published). Every M34_LAT_SAMPLE-th frame is sampled if
+ *                no sample is in flight (read buffer sink only).
+ *                Called from isr or with irqs masked.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl   m34 handle
+ *
+ *  Output.....:  -
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static void latFrame( M34_HANDLE *m34Hdl )
+{
+	M34_LAT_REC	*recP = &m34Hdl->latRec;
+
+	if( !m34Hdl->latSample )
+		return;
+
+	if( ++m34Hdl->latFrames % m34Hdl->latSample ||
+		m34Hdl->latState != M34_LAT_ST_IDLE ||
+		m34Hdl->asyncOn || m34Hdl->captOn )
+		return;
+
+	recP->frame  = m34Hdl->latFrames;
+	recP->tIsr   = m34Hdl->latIsrTs;
+	recP->tFrame = M34_TSTAMP( m34Hdl );
+
+	/* staged: published when the drain reaches the slot */
+	m34Hdl->latSlot  = (m34Hdl->deferMask & M34_DEFER_PUBLISH) ?
+					   m34Hdl->stageWr : M34_LAT_NOSLOT;
+	m34Hdl->latState = M34_LAT_ST_FRAME;
+}/*latFrame*/
+
+/****************************** latReady ************************************
+ *
+ *  Description:  Latency tracer: a frame was made ready in the read buffer
+ *                (MBUF_ReadyBuf). Stamps the sampled frame and remembers
+ *                the words a reader gets before it.
+ *                Called from isr or with irqs masked, before frameReady.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl   m34 handle
+ *
+ *  Output.....:  -
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static void latReady( M34_HANDLE *m34Hdl )
+{
+	/* an older staged frame */
+	if( m34Hdl->latSlot != M34_LAT_NOSLOT &&
+		m34Hdl->latSlot != m34Hdl->stageRd )
+		return;
+
+	m34Hdl->latRec.tReady = M34_TSTAMP( m34Hdl );
+	m34Hdl->latAhead      = m34Hdl->rdAvailWords;
+	m34Hdl->latState      = M34_LAT_ST_READY;
+}/*latReady*/
+
+/****************************** latRead *************************************
+ *
+ *  Description:  Latency tracer: a block read got data from the read
+ *                buffer. Stamps the sampled frame if it was copied.
+ *                Called with the read lock taken.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl       m34 handle
+ *                nbrRdBytes   bytes copied by MBUF_Read
+ *                ts           MBUF_Read return [M34_TSTAMP]
+ *
+ *  Output.....:  -
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static void latRead( M34_HANDLE *m34Hdl, int32 nbrRdBytes, u_int32 ts )
+{
+	OSS_IRQ_STATE	irqState;
+	u_int32			words = nbrRdBytes > 0 ? (u_int32)nbrRdBytes / 2 : 0;
+
+	irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+	if( m34Hdl->latState == M34_LAT_ST_READY ) {
+		if( words > m34Hdl->latAhead ) {
+			m34Hdl->latRec.tWake = ts;
+			m34Hdl->latState     = M34_LAT_ST_WAKE;
+		}
+		else
+			m34Hdl->latAhead -= words;
+	}
+	OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+}/*latRead*/
+
+/****************************** latDone *************************************
+ *
+ *  Description:  Latency tracer: the block read which returned the sampled
+ *                frame ends. Completes the record and starts the next
+ *                sample.
+ *                Called with the read lock taken.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl   m34 handle
+ *
+ *  Output.....:  -
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static void latDone( M34_HANDLE *m34Hdl )
+{
+	OSS_IRQ_STATE	irqState;
+	M34_LAT_REC		*recP = &m34Hdl->latRec;
+
+	recP->tRet  = M34_TSTAMP( m34Hdl );
+	recP->rdSeq = m34Hdl->latRdSeq;
+
+	irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+	m34Hdl->latRing[m34Hdl->latIdx++ % M34_LAT_RECS] = *recP;
+	m34Hdl->latState = M34_LAT_ST_IDLE;
+	OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+}/*latDone*/
+
+/****************************** latReset ************************************
+ *
+ *  Description:  Latency tracer: sets the sample rate, restarts the frame
+ *                and block read count and discards all records.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl   m34 handle
+ *                sample   sample every n-th frame (0=off)
+ *
+ *  Output.....:  -
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static void latReset( M34_HANDLE *m34Hdl, u_int32 sample )
+{
+	OSS_IRQ_STATE	irqState;
+
+	irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+	m34Hdl->latSample = sample;
+	m34Hdl->latFrames = 0;
+	m34Hdl->latState  = M34_LAT_ST_IDLE;
+	m34Hdl->latRdSeq  = 0;
+	m34Hdl->latIdx    = 0;
+	m34Hdl->latRd     = 0;
+	OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+}/*latReset*/
+
+/****************************** selectModeFkt *******************************
+ *
+ *  Description:  Installs the isr and block read implementation for the
+ *                current irq mode and buffer mode.
+ *                Must be called with irqs masked (or before irq install)
+ *                whenever irqMode or bufMode changes.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl   m34 handle
+ *
+ *  Output.....:  m34Hdl->irqFkt, m34Hdl->blkRdFkt
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static void selectModeFkt( M34_HANDLE *m34Hdl )
+{
+	/* adaptive irq mode starts from the set mode */
+	m34Hdl->adaptCur = m34Hdl->irqMode;
+	m34Hdl->adaptReq = m34Hdl->irqMode;
+
+	switch( m34Hdl->irqMode )
+	{
+		case M34_IMODE_FIX:
+			m34Hdl->irqFkt   = irqFix;
+			m34Hdl->blkRdFkt = blkRdFix;
+			return;
+
+		case M34_IMODE_BURST:
+			m34Hdl->irqFkt   = irqBurst;
+			m34Hdl->blkRdFkt = m34Hdl->bufMode == M_BUF_USRCTRL ?
+							   blkRdBurstPoll : blkRdBurst;
+			return;
+
+		case M34_IMODE_CHIRQ:
+			m34Hdl->irqFkt   = irqChIrqMan;
+			m34Hdl->blkRdFkt = blkRdChIrq;
+			break;
+
+		case M34_IMODE_CHIRQ_AUTO:
+			m34Hdl->irqFkt   = irqChIrqAuto;
+			m34Hdl->blkRdFkt = blkRdChIrqAuto;
+			break;
+
+		case M34_IMODE_LEGACY:
+		case M34_IMODE_TIMER:		/* module irq stays disabled */
+		default:
+			m34Hdl->irqFkt   = irqLegacy;
+			m34Hdl->blkRdFkt = blkRdLegacy;
+	}/*switch*/
+
+	/* no buffer: direct hw read in all buffered irq modes */
+	if( m34Hdl->bufMode == M_BUF_USRCTRL )
+		m34Hdl->blkRdFkt = blkRdUsrCtrl;
+
+	/* frames go to the async slots or capture history */
+	if( m34Hdl->asyncOn )
+		m34Hdl->blkRdFkt = blkRdAsync;
+	if( m34Hdl->captOn )
+		m34Hdl->blkRdFkt = blkRdCapt;
+}/*selectModeFkt*/
+
+/****************************** updScanList *********************************
+ *
+ *  Description:  Rebuilds the list of block read channels (chBlkRd) used
+ *                by the isr and block read.
+ *                Must be called with irqs masked (or before irq install).
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl   m34 handle
+ *
+ *  Output.....:  m34Hdl->scanList, m34Hdl->nbrCfgCh
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static void updScanList( M34_HANDLE *m34Hdl )
+{
+	u_int32 ch, n = 0;
+
+	for( ch = 0; ch < m34Hdl->nbrOfChannels; ch++ )
+		if( m34Hdl->chBlkRd[ch] )
+			m34Hdl->scanList[n++] = (u_int8)ch;
+
+	m34Hdl->nbrCfgCh = n;
+
+	/* restart a partly read frame */
+	if( m34Hdl->nbrReadCh >= n )
+		m34Hdl->nbrReadCh = 0;
+}/*updScanList*/
+
+/****************************** readAheadStop *******************************
+ *
+ *  Description:  Stops a running M34_IMODE_CHIRQ_AUTO acquisition and
+ *                discards the read-ahead accounting, e.g. when the read
+ *                buffer or the irq mode is reconfigured.
+ *                Must be called with irqs masked.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl   m34 handle
+ *
+ *  Output.....:  -
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static void readAheadStop( M34_HANDLE *m34Hdl )
+{
+	if( m34Hdl->irqIsEnabled )
+		irqDisable( m34Hdl );
+
+	m34Hdl->blkReadGotWords  = 0;
+	m34Hdl->blkReadReqWords  = 0;
+	m34Hdl->isrCurrCh = 0;
+	m34Hdl->nbrReadCh = 0;
+}/*readAheadStop*/
+
+/****************************** frameReady **********************************
+ *
+ *  Description:  Accounts a frame stored into the read buffer.
+ *                Sends the data ready signal if armed and wakes a
+ *                waiting block read if the batch is complete or the
+ *                latency timing must start (first ready frame).
+ *                Called from isr or with irqs masked.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl   m34 handle
+ *
+ *  Output.....:  -
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static void frameReady( M34_HANDLE *m34Hdl )
+{
+	u_int32	prevLevel = m34Hdl->rdAvailWords * 2;
+	u_int32	level;
+
+	/* buffer level (ring may be overwritten) */
+	m34Hdl->rdAvailWords += m34Hdl->nbrCfgCh;
+	if( m34Hdl->rdAvailWords > m34Hdl->inBufSize/2 ) {
+		m34Hdl->rdAvailWords = m34Hdl->inBufSize/2;
+		m34Hdl->tele.rdLost++;
+		/* oldest frame overwritten */
+		if( m34Hdl->adaptMark )
+			m34Hdl->adaptMarkWords = m34Hdl->adaptMarkWords > m34Hdl->nbrCfgCh ?
+									 m34Hdl->adaptMarkWords - m34Hdl->nbrCfgCh : 0;
+	}
+
+	/* high-water mark, warn when the buffer gets nearly full */
+	level = m34Hdl->rdAvailWords * 2;
+	if( level > m34Hdl->tele.rdLevelMax )
+		m34Hdl->tele.rdLevelMax = level;
+	if( prevLevel < M34_RD_WARN_LEVEL(m34Hdl->inBufSize) &&
+		level >= M34_RD_WARN_LEVEL(m34Hdl->inBufSize) ) {
+		m34Hdl->tele.rdLevelWarn++;
+		M34_TRACE( m34Hdl, M34_TEV_BUF_HIGH, M34_TRC_NOCH, level, m34Hdl->inBufSize );
+	}
+
+	/* buffer became non-empty */
+	if( m34Hdl->sigDataArmed ) {
+		m34Hdl->sigDataArmed = 0;
+		notify( m34Hdl, M34_NTF_SIGDATA );
+	}
+
+	if( m34Hdl->batchFrames < 2 )
+		return;
+
+	if( m34Hdl->batchReady++ == 0 )
+		m34Hdl->batchFirstTs = OSS_TickGet( m34Hdl->osHdl );
+
+	if( m34Hdl->batchSleep &&
+		(m34Hdl->batchReady >= m34Hdl->batchFrames || m34Hdl->batchReady == 1) )
+	{
+		m34Hdl->batchSleep = 0;
+		notify( m34Hdl, M34_NTF_BATCH );
+	}
+}/*frameReady*/
+
+/****************************** rdSleep *************************************
+ *
+ *  Description:  Waits for a block read wakeup semaphore with the read
+ *                lock released. Counts the reader in rdActive while it
+ *                sleeps and always takes the read lock again.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl   m34 handle
+ *                sem      wakeup semaphore
+ *                ms       timeout [ms] | OSS_SEM_WAITINFINITE
+ *
+ *  Output.....:  return   0 | error code of OSS_SemWait
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static int32 rdSleep( M34_HANDLE *m34Hdl, OSS_SEM_HANDLE *sem, int32 ms )
+{
+	int32	error;
+
+	m34Hdl->rdActive++;
+	M34_UNLOCK( m34Hdl, rdSem );
+	error = OSS_SemWait( m34Hdl->osHdl, sem, ms );
+
+	/* the caller expects the read lock back */
+	while( M34_LOCK( m34Hdl, rdSem ) == ERR_OSS_SIG_OCCURED )
+		;
+	m34Hdl->rdActive--;
+
+	return( error );
+}/*rdSleep*/
+
+/****************************** batchWait ***********************************
+ *
+ *  Description:  Sleeps until M34_BATCH_FRAMES frames are ready, the
+ *                oldest ready frame is older than M34_BATCH_LATENCY, the
+ *                acquisition stopped, the trigger is lost or RD_BUF/TIMEOUT
+ *                expired.
+ *                Called with the read lock taken, which is released while
+ *                sleeping (like MBUF_Read does).
+ *                A timeout without any ready frame returns ERR_OSS_TIMEOUT,
+ *                MBUF_Read would wait another RD_BUF/TIMEOUT.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl   m34 handle
+ *
+ *  Output.....:  return   0 | error code
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static int32 batchWait( M34_HANDLE *m34Hdl )
+{
+	OSS_IRQ_STATE	irqState;
+	u_int32			rate, frames, maxFrames, latTicks, age, tout;
+	int32			waitMs, bufTout, error = 0;
+
+	rate = (u_int32)OSS_TickRateGet( m34Hdl->osHdl );
+	if( rate == 0 )
+		rate = 1;
+
+	/* latency [us] -> ticks (rounded up) */
+	latTicks = ((m34Hdl->batchLatency + 999) / 1000 * rate + 999) / 1000;
+
+	if( MBUF_GetStat( m34Hdl->inbuf, NULL, M_BUF_RD_TIMEOUT, &bufTout ) ||
+		bufTout <= 0 )
+		bufTout = OSS_SEM_WAITINFINITE;
+
+	for(;;)
+	{
+		irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+
+		/* not more frames than the buffer can hold */
+		frames    = m34Hdl->batchFrames;
+		maxFrames = m34Hdl->nbrCfgCh ? m34Hdl->inBufSize / (2 * m34Hdl->nbrCfgCh) : 1;
+		if( frames > maxFrames )
+			frames = maxFrames;
+
+		age = m34Hdl->batchReady ?
+			  OSS_TickGet( m34Hdl->osHdl ) - m34Hdl->batchFirstTs : 0;
+
+		if( m34Hdl->batchReady >= frames || !M34_ACQ_RUNNING(m34Hdl) ||
+			m34Hdl->trigLost ||
+			(latTicks && m34Hdl->batchReady && age >= latTicks) )
+		{
+			m34Hdl->batchSleep = 0;
+			OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+			break;
+		}
+
+		/* latency running: sleep for the rest of it */
+		if( latTicks && m34Hdl->batchReady ) {
+			tout   = ((latTicks - age) * 1000 + rate - 1) / rate;
+			waitMs = tout ? (int32)tout : 1;
+		}
+		else
+			waitMs = bufTout;
+
+		m34Hdl->batchSleep = 1;
+		OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+
+		error = rdSleep( m34Hdl, m34Hdl->batchSem, waitMs );
+
+		/* buffer timeout: let MBUF_Read return what it has, if anything */
+		if( error == ERR_OSS_TIMEOUT && waitMs == bufTout ) {
+			irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+			if( m34Hdl->batchReady )
+				error = 0;
+			OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+			break;
+		}
+		if( error && error != ERR_OSS_TIMEOUT )
+			break;
+		error = 0;
+	}/*for*/
+
+	/* drop a wakeup not consumed above */
+	irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+	m34Hdl->batchSleep = 0;
+	OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+	OSS_SemWait( m34Hdl->osHdl, m34Hdl->batchSem, OSS_SEM_NOWAIT );
+
+	return( error );
+}/*batchWait*/
+
+/****************************** frameConsumed *******************************
+ *
+ *  Description:  Removes the data copied by a block read from the buffer
+ *                level and the ready frame count. Re-arms the data ready
+ *                signal when no complete frame is left.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl       m34 handle
+ *                nbrRdBytes   bytes copied by MBUF_Read
+ *
+ *  Output.....:  -
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static void frameConsumed( M34_HANDLE *m34Hdl, int32 nbrRdBytes )
+{
+	OSS_IRQ_STATE	irqState;
+	u_int32			words, frames;
+
+	words  = nbrRdBytes > 0 ? (u_int32)nbrRdBytes / 2 : 0;
+	frames = m34Hdl->nbrCfgCh ? words / m34Hdl->nbrCfgCh : 0;
+
+	irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+	m34Hdl->rdAvailWords = m34Hdl->rdAvailWords > words ?
+						   m34Hdl->rdAvailWords - words : 0;
+	if( m34Hdl->adaptMark )
+		m34Hdl->adaptMarkWords = m34Hdl->adaptMarkWords > words ?
+								 m34Hdl->adaptMarkWords - words : 0;
+
+	/* no complete frame left */
+	if( m34Hdl->rdAvailWords < m34Hdl->nbrCfgCh && m34Hdl->sigData )
+		m34Hdl->sigDataArmed = 1;
+
+	/* the oldest remaining frame is at most as old as batchFirstTs */
+	m34Hdl->batchReady = m34Hdl->batchReady > frames ?
+						 m34Hdl->batchReady - frames : 0;
+	OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+}/*frameConsumed*/
+
+/****************************** sinkGetBuf **********************************
+ *
+ *  Description:  Gets space for the next converted words from the read
+ *                buffer or, in async mode, from the slot being filled or,
+ *                in capture mode, from the history frame being filled.
+ *                Called from isr or with irqs masked.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl     m34 handle
+ *                words      number of words
+ *
+ *  Output.....:  gotsizeP   words available at return pointer
+ *                return     pointer | NULL (no space)
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static u_int16* sinkGetBuf( M34_HANDLE *m34Hdl, int32 words, int32 *gotsizeP )
+{
+	u_int8	*recP;
+
+	/* capture history (frames dropped while a record is pending) */
+	if( m34Hdl->captOn ) {
+		if( m34Hdl->captState == M34_CAPT_ST_DONE ||
+			m34Hdl->captFill + (u_int32)words > m34Hdl->captStride ) {
+			m34Hdl->captLost++;
+			return( NULL );
+		}
+		*gotsizeP = words;
+		m34Hdl->captFill += words;
+		return( m34Hdl->captMem + m34Hdl->captWr * m34Hdl->captStride +
+				m34Hdl->captFill - words );
+	}
+
+	if( !m34Hdl->asyncOn )
+		return( (u_int16*)MBUF_GetNextBuf( m34Hdl->inbuf, words, gotsizeP ) );
+
+	/* no submitted slot or frame doesn't fit */
+	if( m34Hdl->asyncPosted == 0 ||
+		m34Hdl->asyncFill + (u_int32)words > m34Hdl->asyncSlotWords )
+	{
+		m34Hdl->asyncLost++;
+		return( NULL );
+	}
+
+	recP = m34Hdl->asyncMem + m34Hdl->asyncHead * m34Hdl->asyncRecSize;
+	if( m34Hdl->asyncFill == 0 )
+		((M34_ASYNC_HDR*)recP)->tstamp = M34_TSTAMP( m34Hdl );
+
+	*gotsizeP = words;
+	m34Hdl->asyncFill += words;
+	return( (u_int16*)(recP + sizeof(M34_ASYNC_HDR)) +
+			m34Hdl->asyncFill - words );
+}/*sinkGetBuf*/
+
+/****************************** sinkReady ***********************************
+ *
+ *  Description:  Marks a complete frame as ready in the read buffer or, in
+ *                async mode, completes the slot if no further frame fits
+ *                or, in capture mode, checks the trigger (captFrame).
+ *                Called from isr or with irqs masked.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl     m34 handle
+ *
+ *  Output.....:  -
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static void sinkReady( M34_HANDLE *m34Hdl )
+{
+	M34_ASYNC_HDR	*hdrP;
+
+	if( m34Hdl->captOn ) {
+		captFrame( m34Hdl );
+		return;
+	}
+
+	if( !m34Hdl->asyncOn ) {
+		MBUF_ReadyBuf( m34Hdl->inbuf );
+		if( m34Hdl->latState == M34_LAT_ST_FRAME )
+			latReady( m34Hdl );
+		frameReady( m34Hdl );
+		return;
+	}
+
+	if( m34Hdl->asyncFill + m34Hdl->nbrCfgCh <= m34Hdl->asyncSlotWords )
+		return;
+
+	/* complete slot */
+	hdrP = (M34_ASYNC_HDR*)(m34Hdl->asyncMem +
+							m34Hdl->asyncHead * m34Hdl->asyncRecSize);
+	hdrP->seq   = m34Hdl->asyncSeq++;
+	hdrP->bytes = m34Hdl->asyncFill * M34_CH_WIDTH;
+	hdrP->lost  = m34Hdl->asyncLost;
+
+	m34Hdl->asyncLost = 0;
+	m34Hdl->asyncFill = 0;
+	m34Hdl->asyncPosted--;
+	m34Hdl->asyncDone++;
+	if( ++m34Hdl->asyncHead == m34Hdl->asyncNbrSlots )
+		m34Hdl->asyncHead = 0;
+
+	if( m34Hdl->asyncSleep ) {
+		m34Hdl->asyncSleep = 0;
+		notify( m34Hdl, M34_NTF_ASYNC );
+	}
+	notify( m34Hdl, M34_NTF_SIGDATA );
+}/*sinkReady*/
+
+/****************************** asyncReset **********************************
+ *
+ *  Description:  Marks all async slots free and wakes a waiting reader.
+ *                Must be called with irqs masked.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl     m34 handle
+ *
+ *  Output.....:  -
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static void asyncReset( M34_HANDLE *m34Hdl )
+{
+	m34Hdl->asyncHead   = 0;
+	m34Hdl->asyncTail   = 0;
+	m34Hdl->asyncFill   = 0;
+	m34Hdl->asyncPosted = 0;
+	m34Hdl->asyncDone   = 0;
+	m34Hdl->asyncLost   = 0;
+
+	if( m34Hdl->asyncSleep ) {
+		m34Hdl->asyncSleep = 0;
+		OSS_SemSignal( m34Hdl->osHdl, m34Hdl->asyncSem );
+	}
+}/*asyncReset*/
+
+/****************************** blkRdAsync **********************************
+ *
+ *  Description:  Block read in async mode: copies completed slots as
+ *                M34_ASYNC_HDR records (see M34_BlockRead).
+ *                Called with the read lock taken, which is released while
+ *                waiting.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl       m34 handle
+ *                buf          buffer to store the records
+ *                size         byte size of buf
+ *
+ *  Output.....:  nbrRdBytesP  number of read bytes
+ *                return       0 | error code
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static int32 blkRdAsync( M34_HANDLE *m34Hdl, void *buf, int32 size, int32 *nbrRdBytesP )
+{
+	OSS_IRQ_STATE	irqState;
+	u_int32			nbr, n, idx;
+	int32			tout, error;
+	char			*recP;
+
+	if( size < (int32)m34Hdl->asyncRecSize )
+		return( ERR_LL_ILL_PARAM );
+
+	if( MBUF_GetStat( m34Hdl->inbuf, NULL, M_BUF_RD_TIMEOUT, &tout ) || tout <= 0 )
+		tout = OSS_SEM_WAITINFINITE;
+
+	/* wait for a completed slot */
+	for(;;)
+	{
+		irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+		nbr = m34Hdl->asyncDone;
+
+		if( nbr || m34Hdl->rdNonBlock || !m34Hdl->asyncOn ) {
+			OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+			break;
+		}
+		/* nothing to wait for */
+		if( m34Hdl->asyncPosted == 0 ) {
+			OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+			return( ERR_LL_READ );
+		}
+		m34Hdl->asyncSleep = 1;
+		OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+
+		error = rdSleep( m34Hdl, m34Hdl->asyncSem, tout );
+
+		if( error ) {
+			irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+			m34Hdl->asyncSleep = 0;
+			OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+			return( error );
+		}
+	}/*for*/
+
+	/* completed slots are not touched by the isr */
+	if( nbr > (u_int32)size / m34Hdl->asyncRecSize )
+		nbr = (u_int32)size / m34Hdl->asyncRecSize;
+
+	for( n = 0, idx = m34Hdl->asyncTail; n < nbr; n++ ) {
+		recP = (char*)buf + n * m34Hdl->asyncRecSize;
+		OSS_MemCopy( m34Hdl->osHdl, m34Hdl->asyncRecSize,
+					 (char*)m34Hdl->asyncMem + idx * m34Hdl->asyncRecSize, recP );
+		rdSwap( m34Hdl, recP + sizeof(M34_ASYNC_HDR),
+				((M34_ASYNC_HDR*)recP)->bytes );
+		if( ++idx == m34Hdl->asyncNbrSlots )
+			idx = 0;
+	}
+
+	irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+	m34Hdl->asyncTail  = idx;
+	m34Hdl->asyncDone -= nbr;
+	OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+
+	*nbrRdBytesP = (int32)(nbr * m34Hdl->asyncRecSize);
+	return( 0 );
+}/*blkRdAsync*/
+
+/****************************** captFrame ***********************************
+ *
+ *  Description:  Handles a frame stored into the capture history:
+ *                checks the trigger condition (armed) or counts the
+ *                post-trigger frames and finishes the record.
+ *                Called from isr or with irqs masked.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl     m34 handle
+ *
+ *  Output.....:  -
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static void captFrame( M34_HANDLE *m34Hdl )
+{
+	M34_CAPT_CFG	*cfgP = &m34Hdl->captCfg;
+	u_int16			*frmP, raw;
+	u_int32			ext, hit = 0;
+	int32			val;
+
+	/* incomplete frame (no space) */
+	if( m34Hdl->captFill != m34Hdl->captStride ) {
+		m34Hdl->captFill = 0;
+		return;
+	}
+	m34Hdl->captFill = 0;
+	frmP = m34Hdl->captMem + m34Hdl->captWr * m34Hdl->captStride;
+
+	if( m34Hdl->captState == M34_CAPT_ST_ARMED )
+	{
+		switch( cfgP->source )
+		{
+			case M34_CAPT_EXT_RISE:
+			case M34_CAPT_EXT_FALL:
+				ext = (M34_RAW2NATIVE(frmP[0]) >> 1) & 1;
+				if( cfgP->source == M34_CAPT_EXT_RISE )
+					hit = (m34Hdl->captPrev == 0 && ext == 1);
+				else
+					hit = (m34Hdl->captPrev == 1 && ext == 0);
+				m34Hdl->captPrev = ext;
+				break;
+
+			default:
+				raw = M34_RAW2NATIVE( frmP[m34Hdl->captChIdx] );
+				val = m34Hdl->captChBip ? (int32)(int16)raw : (int32)raw;
+
+				/* armed again after leaving the level by hyst */
+				if( cfgP->source == M34_CAPT_LVL_RISE ) {
+					if( val <= cfgP->level - (int32)cfgP->hyst )
+						m34Hdl->captPrev = 1;
+					else if( m34Hdl->captPrev && val >= cfgP->level )
+						hit = 1;
+				}
+				else {
+					if( val >= cfgP->level + (int32)cfgP->hyst )
+						m34Hdl->captPrev = 1;
+					else if( m34Hdl->captPrev && val <= cfgP->level )
+						hit = 1;
+				}
+		}/*switch*/
+
+		if( hit ) {
+			m34Hdl->captTrigIdx  = m34Hdl->captWr;
+			m34Hdl->captTrigTs   = M34_TSTAMP( m34Hdl );
+			m34Hdl->captPostLeft = cfgP->post;
+			m34Hdl->captState    = M34_CAPT_ST_POST;
+		}
+		else if( m34Hdl->captValid < cfgP->pre )
+			m34Hdl->captValid++;
+	}
+	else if( m34Hdl->captPostLeft )
+		m34Hdl->captPostLeft--;
+
+	/* record complete: keep history until read */
+	if( m34Hdl->captState == M34_CAPT_ST_POST && m34Hdl->captPostLeft == 0 )
+	{
+		m34Hdl->captState = M34_CAPT_ST_DONE;
+		if( m34Hdl->captSleep ) {
+			m34Hdl->captSleep = 0;
+			notify( m34Hdl, M34_NTF_CAPT );
+		}
+		notify( m34Hdl, M34_NTF_SIGDATA );
+		return;
+	}
+
+	if( ++m34Hdl->captWr == m34Hdl->captNbrFrames )
+		m34Hdl->captWr = 0;
+}/*captFrame*/
+
+/****************************** captArm *************************************
+ *
+ *  Description:  Discards the capture history and arms the trigger.
+ *                Must be called with irqs masked.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl     m34 handle
+ *
+ *  Output.....:  -
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static void captArm( M34_HANDLE *m34Hdl )
+{
+	m34Hdl->captWr    = 0;
+	m34Hdl->captFill  = 0;
+	m34Hdl->captValid = 0;
+	m34Hdl->captLost  = 0;
+	/* EXT: previous level unknown, level: not armed */
+	m34Hdl->captPrev  = m34Hdl->captCfg.source <= M34_CAPT_EXT_FALL ? 2 : 0;
+	m34Hdl->captState = M34_CAPT_ST_ARMED;
+}/*captArm*/
+
+/****************************** captEnable **********************************
+ *
+ *  Description:  Checks the capture config against the current channel
+ *                config and enables the capture mode.
+ *                Called with the read and hw lock taken.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl     m34 handle
+ *
+ *  Output.....:  return     0 | error code
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static int32 captEnable( M34_HANDLE *m34Hdl )
+{
+	M34_CAPT_CFG	*cfgP = &m34Hdl->captCfg;
+	OSS_IRQ_STATE	irqState;
+	u_int32			idx;
+
+	if( m34Hdl->captOn )
+		return( 0 );
+	if( m34Hdl->asyncOn )
+		return( ERR_LL_DEV_BUSY );
+
+	/* history required, irq/timer must pace the acquisition */
+	if( m34Hdl->captMem == NULL || m34Hdl->nbrCfgCh == 0 ||
+		m34Hdl->irqMode == M34_IMODE_CHIRQ_AUTO ||
+		m34Hdl->irqMode == M34_IMODE_FIX ||
+		m34Hdl->irqMode == M34_IMODE_BURST )
+		return( ERR_LL_ILL_PARAM );
+
+	/* complete record must fit into the history */
+	if( cfgP->pre + 1 + cfgP->post > m34Hdl->captMemWords / m34Hdl->nbrCfgCh )
+		return( ERR_LL_ILL_PARAM );
+
+	/* level channel must be part of the frame */
+	if( cfgP->source >= M34_CAPT_LVL_RISE ) {
+		for( idx = 0; idx < m34Hdl->nbrCfgCh; idx++ )
+			if( m34Hdl->scanList[idx] == cfgP->ch )
+				break;
+		if( idx == m34Hdl->nbrCfgCh )
+			return( ERR_LL_ILL_PARAM );
+		m34Hdl->captChIdx = idx;
+		m34Hdl->captChBip = getBipolar( m34Hdl->chCtrl[cfgP->ch] );
+	}
+
+	irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+	m34Hdl->captStride    = m34Hdl->nbrCfgCh;
+	m34Hdl->captNbrFrames = m34Hdl->captMemWords / m34Hdl->nbrCfgCh;
+	captArm( m34Hdl );
+	m34Hdl->captOn = 1;
+	selectModeFkt( m34Hdl );
+	OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+
+	return( 0 );
+}/*captEnable*/
+
+/****************************** blkRdCapt ***********************************
+ *
+ *  Description:  Block read in capture mode: copies the finished capture
+ *                record and re-arms the trigger (see M34_BlockRead).
+ *                Called with the read lock taken, which is released while
+ *                waiting.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl       m34 handle
+ *                buf          buffer to store the record
+ *                size         byte size of buf
+ *
+ *  Output.....:  nbrRdBytesP  number of read bytes
+ *                return       0 | error code
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static int32 blkRdCapt( M34_HANDLE *m34Hdl, void *buf, int32 size, int32 *nbrRdBytesP )
+{
+	OSS_IRQ_STATE	irqState;
+	M34_CAPT_HDR	hdr;
+	u_int32			start, nbr, frameBytes;
+	int32			tout, error;
+	char			*dstP;
+
+	frameBytes = m34Hdl->captStride * M34_CH_WIDTH;
+	if( size < (int32)(sizeof(M34_CAPT_HDR) + frameBytes *
+				(m34Hdl->captCfg.pre + 1 + m34Hdl->captCfg.post)) )
+		return( ERR_LL_ILL_PARAM );
+
+	if( MBUF_GetStat( m34Hdl->inbuf, NULL, M_BUF_RD_TIMEOUT, &tout ) || tout <= 0 )
+		tout = OSS_SEM_WAITINFINITE;
+
+	/* wait for a finished record */
+	for(;;)
+	{
+		irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+		if( !m34Hdl->captOn ) {
+			OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+			return( 0 );
+		}
+		if( m34Hdl->captState == M34_CAPT_ST_DONE )
+			break;		/* irqs stay masked for the header */
+		if( m34Hdl->rdNonBlock ) {
+			OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+			return( 0 );
+		}
+		m34Hdl->captSleep = 1;
+		OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+
+		error = rdSleep( m34Hdl, m34Hdl->captSem, tout );
+
+		if( error ) {
+			irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+			m34Hdl->captSleep = 0;
+			OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+			return( error );
+		}
+	}/*for*/
+
+	hdr.seq        = m34Hdl->captSeq++;
+	hdr.tstamp     = m34Hdl->captTrigTs;
+	hdr.trigPos    = m34Hdl->captValid;
+	hdr.frames     = m34Hdl->captValid + 1 + m34Hdl->captCfg.post;
+	hdr.frameWords = m34Hdl->captStride;
+	hdr.lost       = m34Hdl->captLost;
+	OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+
+	/* the isr doesn't touch the history until re-armed */
+	OSS_MemCopy( m34Hdl->osHdl, sizeof(hdr), (char*)&hdr, (char*)buf );
+	dstP  = (char*)buf + sizeof(hdr);
+	start = (m34Hdl->captTrigIdx + m34Hdl->captNbrFrames - hdr.trigPos) %
+			m34Hdl->captNbrFrames;
+
+	/* history may wrap */
+	nbr = m34Hdl->captNbrFrames - start;
+	if( nbr > hdr.frames )
+		nbr = hdr.frames;
+	OSS_MemCopy( m34Hdl->osHdl, nbr * frameBytes,
+				 (char*)(m34Hdl->captMem + start * m34Hdl->captStride), dstP );
+	if( nbr < hdr.frames )
+		OSS_MemCopy( m34Hdl->osHdl, (hdr.frames - nbr) * frameBytes,
+					 (char*)m34Hdl->captMem, dstP + nbr * frameBytes );
+	rdSwap( m34Hdl, dstP, hdr.frames * frameBytes );
+
+	irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+	captArm( m34Hdl );
+	OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+
+	*nbrRdBytesP = (int32)(sizeof(hdr) + hdr.frames * frameBytes);
+	return( 0 );
+}/*blkRdCapt*/
+
+/****************************** notify **************************************
+ *
+ *  Description:  Wakes a reader / sends the data ready signal, or leaves
+ *                it to the deferred stage (M34_DEFER_WAKEUP).
+ *                Called from isr or with irqs masked.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl     m34 handle
+ *                what       M34_NTF_XXX
+ *
+ *  Output.....:  -
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static void notify( M34_HANDLE *m34Hdl, u_int32 what )
+{
+	if( m34Hdl->deferMask & M34_DEFER_WAKEUP )
+		m34Hdl->ntfPending |= what;
+	else
+		notifySend( m34Hdl, what );
+}/*notify*/
+
+static void notifySend( M34_HANDLE *m34Hdl, u_int32 what )
+{
+	if( (what & M34_NTF_SIGDATA) && m34Hdl->sigData )
+		OSS_SigSend( m34Hdl->osHdl, m34Hdl->sigData );
+	if( what & M34_NTF_BATCH )
+		OSS_SemSignal( m34Hdl->osHdl, m34Hdl->batchSem );
+	if( what & M34_NTF_ASYNC )
+		OSS_SemSignal( m34Hdl->osHdl, m34Hdl->asyncSem );
+	if( what & M34_NTF_CAPT )
+		OSS_SemSignal( m34Hdl->osHdl, m34Hdl->captSem );
+}/*notifySend*/
+
+/****************************** stageDrain **********************************
+ *
+ *  Description:  Deferred stage: publishes the staged frames into the
+ *                read buffer/slots/capture history (with the frame
+ *                bookkeeping) and sends the deferred wakeups.
+ *                The isr only advances stageWr, the drain only stageRd,
+ *                ordered with the frame data by M34_WMB/M34_RMB/M34_MB;
+ *                irqs are masked per frame while the sink is updated.
+ *                Called from the drain timer or a block read, a second
+ *                caller returns at once.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl     m34 handle
+ *
+ *  Output.....:  -
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static void stageDrain( M34_HANDLE *m34Hdl )
+{
+	OSS_IRQ_STATE	irqState;
+	u_int16			*srcP, *dstP;
+	int32			frmWords, words, gotsize;
+
+	irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+	if( m34Hdl->stageBusy ) {
+		OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+		return;
+	}
+	m34Hdl->stageBusy = 1;
+	OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+
+	while( m34Hdl->stageRd != m34Hdl->stageWr )
+	{
+		M34_RMB();		/* frame read after stageWr */
+		srcP  = m34Hdl->stageMem + m34Hdl->stageRd * m34Hdl->stageStride;
+		frmWords = words = *srcP++;
+
+		irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+		if( (dstP = sinkGetBuf( m34Hdl, words, &gotsize )) != NULL )
+		{
+			/* buffer may wrap within the frame */
+			if( gotsize < words ) {
+				OSS_MemCopy( m34Hdl->osHdl, gotsize * M34_CH_WIDTH,
+							 (char*)srcP, (char*)dstP );
+				srcP  += gotsize;
+				words -= gotsize;
+				dstP = sinkGetBuf( m34Hdl, words, &gotsize );
+			}
+			if( dstP )
+				OSS_MemCopy( m34Hdl->osHdl, words * M34_CH_WIDTH,
+							 (char*)srcP, (char*)dstP );
+			else
+				M34_TRACE( m34Hdl, M34_TEV_ERR_WRAP, M34_TRC_NOCH, words, 0 );
+			sinkReady( m34Hdl );
+			M34_TRACE( m34Hdl, M34_TEV_BUF_READY, M34_TRC_NOCH, frmWords, 0 );
+		}
+		else {
+			M34_RD_LOST( m34Hdl );
+			M34_TRACE( m34Hdl, M34_TEV_BUF_NOSPACE, M34_TRC_NOCH, m34Hdl->irqMode, 0 );
+		}
+		OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+
+		M34_MB();		/* frame copied before the isr may reuse it */
+		m34Hdl->stageRd = m34Hdl->stageRd + 1 == m34Hdl->stageNbr ?
+						  0 : m34Hdl->stageRd + 1;
+	}/*while*/
+
+	/* deferred wakeups */
+	irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+	if( m34Hdl->ntfPending ) {
+		notifySend( m34Hdl, m34Hdl->ntfPending );
+		m34Hdl->ntfPending = 0;
+	}
+	m34Hdl->stageBusy = 0;
+	OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+}/*stageDrain*/
+
+static void deferTimerFkt( void *arg )
+{
+	stageDrain( (M34_HANDLE*)arg );
+}/*deferTimerFkt*/
+
+/****************************** deferSet ************************************
+ *
+ *  Description:  Sets the deferred stage work mask and starts/stops the
+ *                drain timer (see deferTimerSet). Staged frames and pending wakeups are
+ *                flushed when work moves back to the isr.
+ *                Called with the read and hw lock taken (or from Init).
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl     m34 handle
+ *                mask       M34_DEFER_XXX
+ *
+ *  Output.....:  return     0 | error code
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static int32 deferSet( M34_HANDLE *m34Hdl, u_int32 mask )
+{
+	OSS_IRQ_STATE	irqState;
+
+	irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+	if( !(mask & M34_DEFER_PUBLISH) && m34Hdl->stageRd == m34Hdl->stageWr ) {
+		m34Hdl->stageRd = 0;
+		m34Hdl->stageWr = 0;
+	}
+	m34Hdl->deferMask = mask;
+	OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+
+	/* flush what was deferred so far */
+	stageDrain( m34Hdl );
+
+	return( deferTimerSet( m34Hdl ) );
+}/*deferSet*/
+
+/****************************** deferTimerSet *******************************
+ *
+ *  Description:  Starts/stops the drain timer. It runs while deferred
+ *                work is set and an acquisition is running. Stopping
+ *                flushes the staged frames and pending wakeups.
+ *                Called with the hw lock taken (or from Init).
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl     m34 handle
+ *
+ *  Output.....:  return     0 | error code
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static int32 deferTimerSet( M34_HANDLE *m34Hdl )
+{
+	int32	error = 0;
+	u_int32	run = m34Hdl->deferMask && M34_ACQ_RUNNING( m34Hdl );
+
+	if( run && !m34Hdl->deferRun ) {
+		error = OSS_TimerStart( m34Hdl->osHdl, m34Hdl->deferTimer,
+								M34_DEFER_PERIOD, 1 );
+		if( !error )
+			m34Hdl->deferRun = 1;
+	}
+	else if( !run && m34Hdl->deferRun ) {
+		OSS_TimerStop( m34Hdl->osHdl, m34Hdl->deferTimer );
+		m34Hdl->deferRun = 0;
+		stageDrain( m34Hdl );
+	}
+
+	return( error );
+}/*deferTimerSet*/
+
+/****************************** settleCalCh *********************************
+ *
+ *  Description:  Measures the settle count of one channel after a switch
+ *                from its scan predecessor.
+ *                The predecessor is converted until settled, then the
+ *                channel is converted M34_CAL_SETTLED+M34_CAL_REF times.
+ *                The mean of the last M34_CAL_REF conversions is the
+ *                reference; the channel is settled from the first
+ *                conversion after which all values stay within tol.
+ *                Repeated M34_CAL_ROUNDS times, the max is taken.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl     m34 handle
+ *                ch         channel to calibrate
+ *                prev       scan predecessor
+ *                tol        tolerance [raw 16-bit units]
+ *
+ *  Output.....:  return     settle count 0..M34_SETTLE_MAX
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static u_int32 settleCalCh
+(
+	M34_HANDLE	*m34Hdl,
+	u_int32		ch,
+	u_int32		prev,
+	u_int32		tol
+)
+{
+	int32	val[M34_CAL_SETTLED + M34_CAL_REF];
+	int32	ref, diff;
+	u_int32	round, n, first, settle = 0;
+	int32	bipolar = getBipolar( m34Hdl->chCtrl[ch] );
+	u_int16	dummy;
+
+	for( round=0; round<M34_CAL_ROUNDS; round++ )
+	{
+		/* settle on the predecessor */
+		MWRITE_D16( m34Hdl->ma34, M34_CTRL_WR, m34Hdl->chCtrl[prev] );
+		for( n=0; n<M34_CAL_SETTLED; n++ )
+			dummy = MREAD_D16( m34Hdl->ma34, M34_DATA_START_RD );
+
+		/* switch and convert */
+		MWRITE_D16( m34Hdl->ma34, M34_CTRL_WR, m34Hdl->chCtrl[ch] );
+		for( n=0; n<M34_CAL_SETTLED + M34_CAL_REF; n++ ) {
+			dummy  = MREAD_D16( m34Hdl->ma34, M34_DATA_START_RD );
+			val[n] = bipolar ? (int32)(int16)dummy : (int32)dummy;
+		}
+		m34Hdl->calConv += 2*M34_CAL_SETTLED + M34_CAL_REF;
+
+		for( ref=0, n=M34_CAL_SETTLED; n<M34_CAL_SETTLED + M34_CAL_REF; n++ )
+			ref += val[n];
+		ref /= M34_CAL_REF;
+
+		/* first conversion of the converged tail */
+		for( first=M34_CAL_SETTLED; first>0; first-- ) {
+			diff = val[first-1] - ref;
+			if( diff > (int32)tol || -diff > (int32)tol )
+				break;
+		}
+
+		/* value is taken at conversion nbrDummyRd + settle + 1 */
+		if( first > m34Hdl->nbrDummyRd + 1 &&
+			first - m34Hdl->nbrDummyRd - 1 > settle )
+			settle = first - m34Hdl->nbrDummyRd - 1;
+	}/*for*/
+
+	return( settle > M34_SETTLE_MAX ? M34_SETTLE_MAX : settle );
+}/*settleCalCh*/
+
+/****************************** settleCal ***********************************
+ *
+ *  Description:  Calibrates the settle count (M34_SETTLE) of the channels
+ *                selected for block read/irq for the switch from their
+ *                scan predecessor (all channels in order if none is
+ *                selected) and measures the conversion time.
+ *                Called with the read and hw lock taken.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl     m34 handle
+ *                tol        tolerance [raw 16-bit units]
+ *
+ *  Output.....:  return     0 | error code
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static int32 settleCal( M34_HANDLE *m34Hdl, u_int32 tol )
+{
+	u_int8			settle[M34_SINGLE_ENDED_MAX_CH];
+	u_int32			idx, nbr, ch, prev, tStart;
+	OSS_IRQ_STATE	irqState;
 
-		for (ch = 0; ch<m34Hdl->nbrOfChannels; ch++)
-		{
-			/* ch scheduling */
-			if (m34Hdl->chBlkRd[ch])
-			{
-				/*--------------------+
-				|  set current ch     |
-				+--------------------*/
-				MWRITE_D16(m34Hdl->ma34, M34_CTRL_WR, m34Hdl->chCtrl[ch]);
-
-				/*----------------------------------+
-				|  start conversion & rd with delay |
-				+----------------------------------*/
-				for (t = 0; t <= m34Hdl->nbrDummyRd; t++)						/* dummy reads min 1 */
-					dummy = MREAD_D16(m34Hdl->ma34, M34_DATA_START_RD); /* dummy conversion */
-
-				*buf++ = MREAD_D16(m34Hdl->ma34, M34_DATA_START_RD);		/* conversion */
-				nbrRdCh++;
-
-				if ((nbrRdCh < m34Hdl->nbrCfgCh)		/* read another channel ? */
-					&& ((int32)nbrRdCh == gotsize))	/* got space full ? */
-				{
-					/* calculate missing buffer space */
-					nbrOfBlocks = m34Hdl->nbrCfgCh - nbrRdCh;
-					/* not enough bytes gotten - wrap around buffer */
-					if ((buf = (u_int16*)MBUF_GetNextBuf
-						(m34Hdl->inbuf,
-							nbrOfBlocks,
-							&gotsize)) == 0)
-					{
-						/* wrap around failed */
-						IDBGWRT_ERR((DBH, "*** LL - M34_Irq: wrap around failed\n"));
-						break;
-					}/*if*/
-				}/*if*/
-			}/*if*/
-		}/*for*/
+	if( M34_ACQ_RUNNING( m34Hdl ) )
+		return( ERR_LL_DEV_BUSY );
 
-		MBUF_ReadyBuf(m34Hdl->inbuf);  /* blockread ready */
-	}
-	else
+	nbr = m34Hdl->nbrCfgCh ? m34Hdl->nbrCfgCh : m34Hdl->nbrOfChannels;
+
+	m34Hdl->calConv = 0;
+	tStart = M34_TSTAMP( m34Hdl );
+	for( idx=0; idx<nbr; idx++ )
 	{
-		IDBGWRT_2((DBH, " no buffer space\n"));
-		/* reset irq cause */
-		dummy = MREAD_D16(m34Hdl->ma34, M34_DATA_START_RD); /* dummy conversion */
-	}/*if*/
+		if( m34Hdl->nbrCfgCh ) {
+			ch   = m34Hdl->scanList[idx];
+			prev = m34Hdl->scanList[idx ? idx-1 : nbr-1];
+		}
+		else {
+			ch   = idx;
+			prev = idx ? idx-1 : nbr-1;
+		}
+		settle[idx] = (u_int8)settleCalCh( m34Hdl, ch, prev, tol );
+		DBGWRT_2((DBH, " settleCal: ch %d after ch %d: settle %d\n",
+				  ch, prev, settle[idx]));
+	}/*for*/
+	m34Hdl->calTicks = M34_TSTAMP( m34Hdl ) - tStart;
+
+	irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+	for( idx=0; idx<nbr; idx++ )
+		m34Hdl->chSettle[m34Hdl->nbrCfgCh ? m34Hdl->scanList[idx] : idx] = settle[idx];
+	updDummyRd( m34Hdl );
+	MWRITE_D16( m34Hdl->ma34, M34_CTRL_WR, m34Hdl->chCtrl[0] );
+	OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+
+	return( 0 );
+}/*settleCal*/
+
+/****************************** settleCalRate *******************************
+ *
+ *  Description:  Calculates the achievable frame rate of the configured
+ *                channels from the conversion time measured by the last
+ *                settle calibration (isr/timer overhead not included).
+ *                A calibration shorter than M34_RATE_TS_MIN timestamp
+ *                units gives no usable rate (unknown).
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl     m34 handle
+ *
+ *  Output.....:  return     frame rate [Hz] (0=not calibrated/unknown)
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static u_int32 settleCalRate( M34_HANDLE *m34Hdl )
+{
+	u_int32	idx, conv = 0, freq = traceTsFreq( m34Hdl );
 
-	goto CLEANUP;
+	if( m34Hdl->calTicks < M34_RATE_TS_MIN || freq == 0 ||
+		m34Hdl->nbrCfgCh == 0 )
+		return( 0 );
 
-/* -------------------- disable irq and cleanup -------------------- */
-DISABLE_CLEANUP:
-	/* disable irq */
-	IDBGWRT_2((DBH, " disable irq\n"));
-	setIrqEnable(0, m34Hdl);
-	MWRITE_D16(m34Hdl->ma34, M34_CTRL_WR, m34Hdl->chCtrl[m34Hdl->isrCurrCh]);
+	/* conversions per frame: dummy reads (min 1) + value */
+	for( idx=0; idx<m34Hdl->nbrCfgCh; idx++ )
+		conv += m34Hdl->chDummyRd[m34Hdl->scanList[idx]] + 2;
 
-/* -------------------- cleanup -------------------- */
-CLEANUP:
-    m34Hdl->irqCount++;
+	return( (u_int32)M34_DIV64( (u_int64)m34Hdl->calConv * freq,
+								(u_int64)m34Hdl->calTicks * conv ) );
+}/*settleCalRate*/
 
-#ifdef WINNT
-	t2 = KeQueryPerformanceCounter(NULL);
-	m34Hdl->isrTicks.QuadPart += t2.QuadPart - t1.QuadPart;
-#endif
+/****************************** rdBufBusy ***********************************
+ *
+ *  Description:  Checks if the frame aligned read buffer can't be
+ *                recreated now (acquisition running or reader waiting).
+ *                Called with the read lock taken.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl     m34 handle
+ *
+ *  Output.....:  return     1=busy, 0=buffer not aligned or not in use
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static int32 rdBufBusy( M34_HANDLE *m34Hdl )
+{
+	return( m34Hdl->frameAlign &&
+			(m34Hdl->rdActive || M34_ACQ_RUNNING( m34Hdl )) );
+}/*rdBufBusy*/
 
-    return( LL_IRQ_UNKNOWN );
-}/*M34_Irq*/
+/****************************** rdBufAlign **********************************
+ *
+ *  Description:  Recreates the read buffer with RD_BUF/SIZE rounded down
+ *                to whole frames of the configured channels if frame
+ *                alignment is enabled and the size doesn't match.
+ *                The buffer mode, timeout and debug level are kept, the
+ *                buffer data and an installed highwater signal are lost.
+ *                Called with the read and hw lock taken.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl     m34 handle
+ *
+ *  Output.....:  return     0 | error code
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static int32 rdBufAlign( M34_HANDLE *m34Hdl )
+{
+	MBUF_HANDLE		*newBuf, *oldBuf;
+	OSS_IRQ_STATE	irqState;
+	u_int32			size, frameBytes, highWater;
+	int32			tout, error;
+
+	if( !m34Hdl->frameAlign || m34Hdl->nbrCfgCh == 0 )
+		return( 0 );
+
+	frameBytes = m34Hdl->nbrCfgCh * M34_CH_WIDTH;
+	size = m34Hdl->inBufDescSize - m34Hdl->inBufDescSize % frameBytes;
+	if( size == 0 ) {
+		DBGWRT_ERR((DBH, "*** LL - rdBufAlign: RD_BUF/SIZE < frame\n"));
+		return( ERR_LL_ILL_PARAM );
+	}
+	if( size == m34Hdl->inBufSize )
+		return( 0 );
+
+	if( rdBufBusy( m34Hdl ) )
+		return( ERR_LL_DEV_BUSY );
+
+	if( MBUF_GetStat( m34Hdl->inbuf, NULL, M_BUF_RD_TIMEOUT, &tout ) )
+		tout = M34_DEFAULT_BUF_TIMEOUT;
+	highWater = m34Hdl->inBufHighWater < size ? m34Hdl->inBufHighWater : size;
+
+	error = MBUF_Create( m34Hdl->osHdl, m34Hdl->rdSem, m34Hdl, size,
+						 M34_CH_WIDTH, m34Hdl->bufMode,
+						 MBUF_RD, highWater, tout,
+						 m34Hdl->irqHdl, &newBuf );
+	if( error )
+		return( error );
+	MBUF_SetStat( newBuf, NULL, M_BUF_RD_DEBUG_LEVEL, m34Hdl->dbgLevelMbuf );
+
+	/* swap buffers, frame accounting starts from scratch */
+	irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+	oldBuf = m34Hdl->inbuf;
+	m34Hdl->inbuf     = newBuf;
+	m34Hdl->inBufSize = size;
+	m34Hdl->tele.rdBufSize   = size;
+	m34Hdl->tele.rdLevelMax  = 0;
+	m34Hdl->tele.rdLevelWarn = 0;
+	m34Hdl->tele.rdLost      = 0;
+	m34Hdl->rdLostCh         = 0;
+	if( m34Hdl->irqMode == M34_IMODE_CHIRQ_AUTO )
+		readAheadStop( m34Hdl );
+	m34Hdl->batchReady   = 0;
+	m34Hdl->rdAvailWords = 0;
+	m34Hdl->adaptMarkWords = 0;
+	m34Hdl->sigDataArmed = m34Hdl->sigData ? 1 : 0;
+	OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+
+	MBUF_Remove( &oldBuf );
+	return( 0 );
+}/*rdBufAlign*/
 
 /****************************** M34_Info ************************************
  *
@@ -1861,7 +6548,21 @@ CLEANUP:
  *     arg2  u_int32 *useIrqP          1              module use interrupts
  *
  *  LL_INFO_LOCKMODE
- *     arg2  u_int32 *lockModeP        LL_LOCK_CALL   process lock mode
+ *     arg2  u_int32 *lockModeP        LL_LOCK_NONE   process lock mode
+ *
+ *                The driver does its own locking: a block read and the
+ *                setstats changing the acquisition setup are serialized
+ *                by the read lock, all other hw sequences by the hw lock.
+ *                Getstats run unlocked (M_LL_BLK_ID_DATA/M34_RESOLUTION
+ *                take the hw lock to read the ID-PROM on first use).
+ *                A block read releases the read lock while it waits for
+ *                data (read buffer, batch, async and capture waits): a
+ *                second block read may then run and wait too, and the
+ *                setstats changing the setup the reader relies on fail
+ *                with ERR_LL_DEV_BUSY (see setStatNeedsRdLock); enabling/
+ *                disabling async or capture mode stays possible to end
+ *                such a wait. The M34_IMODE_FIX block read keeps the read
+ *                lock during its conversion wait (max 100 ms).
  *
  *--------------------------------------------------------------------------
  *  Input......:  infoType          desired information
@@ -1915,7 +6616,7 @@ static int32 M34_Info
               case 0:
                 *addrModeP = MDIS_MA08;
                 *dataModeP = MDIS_MD16;
-                *addrSizeP = 0x100;
+                *addrSizeP = M34_ADDRSPACE_SIZE;
                 break;
 
               default:
@@ -1931,7 +6632,7 @@ static int32 M34_Info
 		case LL_INFO_LOCKMODE:
 		{
 			u_int32 *lockModeP = va_arg(argptr, u_int32*);
-			*lockModeP = LL_LOCK_CALL;
+			*lockModeP = LL_LOCK_NONE;
 			break;
 		}
 
@@ -1950,10 +6651,56 @@ static int32 M34_Info
  *
  *    supported codes      values        meaning
  *
- *    M_LL_BLK_ID_DATA                   read the M-Module ID from SROM
- *      blockStruct->size  0..0xff       number of bytes to read
+ *    M_LL_BLK_ID_DATA                   read the M-Module ID from the
+ *                                       ID-PROM cache (read at init with
+ *                                       ID_CHECK=1, else at first use)
+ *      blockStruct->size  0..0x80       number of bytes to read
+ *                                       (returns number of bytes read)
  *      blockStruct->data  pointer       user buffer where ID data stored
  *
+ *    M34_BLK_TRACE                      read the newest trace records
+ *      blockStruct->size  0..max        size of user buffer in bytes
+ *                                       (returns size of read records)
+ *      blockStruct->data  pointer       user buffer for M34_TRACE_REC
+ *                                       array (oldest record first)
+ *
+ *    M34_BLK_CH_CFG                     read channel config table
+ *      blockStruct->size  0..max        size of user buffer in bytes
+ *                                       (returns size of read entries)
+ *      blockStruct->data  pointer       user buffer for M34_CH_CFG
+ *                                       array (entry n = channel n)
+ *
+ *    M34_BLK_MULTI_READ                 read list of channels
+ *      blockStruct->size  n*sizeof(M34_MULTI_READ)
+ *      blockStruct->data  pointer       M34_MULTI_READ array, the value
+ *                                       of each entry is filled in
+ *
+ *                Not possible while the module irq is enabled
+ *                (ERR_LL_READ). The channel list is converted in one
+ *                sequence; the control register and the dummy reads are
+ *                skipped if an entry uses the same control word as the
+ *                previous one. The channel configuration (M34_CH_GAIN,
+ *                M34_CH_BIPOLAR, M34_CH_RDBLK_IRQ) is not changed.
+ *
+ *    M34_BLK_CAPT_CFG                   get capture trigger config
+ *      blockStruct->size  sizeof(M34_CAPT_CFG)
+ *      blockStruct->data  pointer       user buffer for M34_CAPT_CFG
+ *
+ *    M34_BLK_TELEMETRY                  get timer mode and read buffer
+ *                                       statistics
+ *      blockStruct->size  0..max        size of user buffer in bytes
+ *                                       (returns size of copied data)
+ *      blockStruct->data  pointer       user buffer for M34_TELEMETRY
+ *
+ *    M34_BLK_LAT                        get completed latency records
+ *      blockStruct->size  0..max        size of user buffer in bytes
+ *                                       (returns size of read records)
+ *      blockStruct->data  pointer       user buffer for M34_LAT_REC
+ *                                       array, oldest first
+ *
+ *                The returned records are removed. The driver keeps the
+ *                last M34_LAT_RECS records.
+ *
  *---------------------------------------------------------------------------
  *  Input......:  m34Hdl         m34 handle
  *                code           getstat code
@@ -1976,18 +6723,149 @@ static int32 getStatBlock /* nodoc */
    u_int8  i;
    u_int32 maxWords;
    u_int16 *dataP;
+   u_int32 n, first, nbrRecs;
+   M34_TRACE_REC *recP;
+   M34_LAT_REC *latP;
+   M34_CH_CFG *cfgP;
+   M34_MULTI_READ *mrdP;
+   OSS_IRQ_STATE irqState;
 
    error = 0;
    switch( code )
    {
        case M_LL_BLK_ID_DATA:
+          /* served from the ID-PROM cache (see M34_ID_REFRESH) */
+          if( (error = idPromGet( m34Hdl )) )
+              break;
           maxWords = blockStruct->size / 2;
+          if( maxWords > M34_ID_WORDS )
+              maxWords = M34_ID_WORDS;
           dataP = (u_int16*)(blockStruct->data);
           for( i=0; i<maxWords; i++ )
+              *dataP++ = m34Hdl->idData[i];
+          blockStruct->size = maxWords * 2;
+          break;
+
+       case M34_BLK_TRACE:
+          recP = (M34_TRACE_REC*)blockStruct->data;
+          nbrRecs = blockStruct->size / sizeof(M34_TRACE_REC);
+
+          /* the isr writes trace records too */
+          irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+
+          if( nbrRecs > m34Hdl->trcIdx )
+              nbrRecs = m34Hdl->trcIdx;
+          if( nbrRecs > M34_TRACE_RECS )
+              nbrRecs = M34_TRACE_RECS;
+          first = m34Hdl->trcIdx - nbrRecs;
+
+          for( n=0; n<nbrRecs; n++ )
+              recP[n] = m34Hdl->trcRing[(first + n) & (M34_TRACE_RECS-1)];
+
+          OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+
+          blockStruct->size = nbrRecs * sizeof(M34_TRACE_REC);
+          break;
+
+       case M34_BLK_CH_CFG:
+          cfgP = (M34_CH_CFG*)blockStruct->data;
+          nbrRecs = blockStruct->size / sizeof(M34_CH_CFG);
+          if( nbrRecs > m34Hdl->nbrOfChannels )
+              nbrRecs = m34Hdl->nbrOfChannels;
+
+          for( n=0; n<nbrRecs; n++ )
+          {
+              cfgP[n].gain     = (u_int8)getGain( m34Hdl->chCtrl[n] );
+              cfgP[n].bipolar  = (u_int8)getBipolar( m34Hdl->chCtrl[n] );
+              cfgP[n].rdBlkIrq = (u_int8)m34Hdl->chBlkRd[n];
+              cfgP[n].settle   = m34Hdl->chSettle[n];
+          }/*for*/
+
+          blockStruct->size = nbrRecs * sizeof(M34_CH_CFG);
+          break;
+
+       case M34_BLK_CAPT_CFG:
+          if( blockStruct->size < (int32)sizeof(M34_CAPT_CFG) )
+          {
+              error = ERR_LL_ILL_PARAM;
+              break;
+          }
+          blockStruct->size = sizeof(M34_CAPT_CFG);
+          *(M34_CAPT_CFG*)blockStruct->data = m34Hdl->captCfg;
+          break;
+
+       case M34_BLK_TELEMETRY:
+          if( blockStruct->size > (int32)sizeof(M34_TELEMETRY) )
+              blockStruct->size = sizeof(M34_TELEMETRY);
+
+          irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+          m34Hdl->tele.tsFreq = traceTsFreq( m34Hdl );
+          OSS_MemCopy( m34Hdl->osHdl, blockStruct->size,
+                       (char*)&m34Hdl->tele, (char*)blockStruct->data );
+          OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+          break;
+
+       case M34_BLK_LAT:
+          latP = (M34_LAT_REC*)blockStruct->data;
+          nbrRecs = blockStruct->size / sizeof(M34_LAT_REC);
+
+          /* a block read may complete a record meanwhile */
+          irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+
+          if( m34Hdl->latIdx - m34Hdl->latRd > M34_LAT_RECS )
+              m34Hdl->latRd = m34Hdl->latIdx - M34_LAT_RECS;
+          if( nbrRecs > m34Hdl->latIdx - m34Hdl->latRd )
+              nbrRecs = m34Hdl->latIdx - m34Hdl->latRd;
+
+          for( n=0; n<nbrRecs; n++ )
+              latP[n] = m34Hdl->latRing[(m34Hdl->latRd + n) % M34_LAT_RECS];
+          m34Hdl->latRd += nbrRecs;
+
+          OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+
+          blockStruct->size = nbrRecs * sizeof(M34_LAT_REC);
+          break;
+
+       case M34_BLK_MULTI_READ:
+          mrdP    = (M34_MULTI_READ*)blockStruct->data;
+          nbrRecs = blockStruct->size / sizeof(M34_MULTI_READ);
+
+          if( blockStruct->size % sizeof(M34_MULTI_READ) )
+          {
+              error = ERR_LL_ILL_PARAM;
+              break;
+          }
+
+          /* check complete list first */
+          for( n=0; n<nbrRecs; n++ )
           {
-              *dataP = (u_int16) m_read((U_INT32_OR_64)m34Hdl->ma34, i);
-              dataP++;
+              if( mrdP[n].ch >= m34Hdl->nbrOfChannels ||
+                  ((mrdP[n].flags & M34_MRD_GAIN) &&
+                   mrdP[n].gain > M34_GAIN_8) ||
+                  ((mrdP[n].flags & M34_MRD_BIPOLAR) &&
+                   mrdP[n].bipolar != M34_BIPOLAR &&
+                   mrdP[n].bipolar != M34_UNIPOLAR) )
+              {
+                  DBGWRT_ERR((DBH,"*** LL - getStatBlock: M34_BLK_MULTI_READ "
+                              "entry %d invalid\n", n));
+                  error = ERR_LL_ILL_PARAM;
+                  break;
+              }
           }/*for*/
+          if( error )
+              break;
+
+          if( (error = M34_LOCK( m34Hdl, hwSem )) )
+              break;
+
+          if( M34_ACQ_RUNNING( m34Hdl ) )
+              error = ERR_LL_READ;        /* can't read ! */
+          else if( m34Hdl->pollOwner )
+              error = ERR_LL_DEV_BUSY;    /* registers owned by user space */
+          else
+              multiRead( m34Hdl, mrdP, nbrRecs );
+
+          M34_UNLOCK( m34Hdl, hwSem );
           break;
 
        default:
@@ -1997,6 +6875,420 @@ static int32 getStatBlock /* nodoc */
    return( error );
 }/*getStatBlock*/
 
+/****************************** multiRead ***********************************
+ *
+ *  Description:  Converts a checked channel list (M34_BLK_MULTI_READ).
+ *                Called with the hw lock taken and the module irq disabled.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl   m34 handle
+ *                mrdP     channel list
+ *                nbrRecs  number of list entries
+ *
+ *  Output.....:  mrdP[].value  read values
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static void multiRead
+(
+	M34_HANDLE		*m34Hdl,
+	M34_MULTI_READ	*mrdP,
+	u_int32			nbrRecs
+)
+{
+	u_int32	n;
+	u_int16	ctrl, lastCtrl = 0;
+
+	for( n=0; n<nbrRecs; n++, mrdP++ )
+	{
+		ctrl = m34Hdl->chCtrl[mrdP->ch];
+		if( mrdP->flags & M34_MRD_GAIN )
+			setGain( mrdP->gain, &ctrl );
+		if( mrdP->flags & M34_MRD_BIPOLAR )
+			setBipolar( mrdP->bipolar, &ctrl );
+
+		/* new channel/gain: set control data and let the input settle */
+		if( n == 0 || ctrl != lastCtrl )
+		{
+			M34_SCAN_SETTLE( m34Hdl->ma34, ctrl, m34Hdl->chDummyRd[mrdP->ch] );
+			lastCtrl = ctrl;
+		}
+
+		mrdP->value = M34_SCAN_CONV( m34Hdl->ma34 );
+	}/*for*/
+}/*multiRead*/
+
+/************************** setStatBlock *************************************
+ *
+ *  Description:  Decodes the M_SETGETSTAT_BLOCK code and executes them.
+ *                Called with the read and hw lock taken.
+ *
+ *    supported codes      values        meaning
+ *
+ *    M34_BLK_CH_CFG                     set channel config table
+ *      blockStruct->size  n*sizeof(M34_CH_CFG)
+ *                                       n=1..number of channels
+ *      blockStruct->data  pointer       M34_CH_CFG array, entry n
+ *                                       configures channel n
+ *
+ *                All entries are checked before anything is changed.
+ *                The table is applied with irqs masked and the control
+ *                register of channel 0 is written once at the end.
+ *                Not possible while capture mode is enabled (frame layout).
+ *                With M34_FRAME_ALIGN a changed channel selection
+ *                recreates the read buffer (acquisition must be stopped).
+ *
+ *    M34_BLK_CAPT_CFG                   set capture trigger config
+ *      blockStruct->size  sizeof(M34_CAPT_CFG)
+ *      blockStruct->data  pointer       M34_CAPT_CFG
+ *
+ *                Not possible while capture mode is enabled. The config
+ *                is checked against the channel config by M34_CAPT_ENABLE.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl         m34 handle
+ *                code           setstat code
+ *                blockStruct    the struct with code size and data buffer
+ *
+ *  Output.....:  return - 0 | error code
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static int32 setStatBlock /* nodoc */
+(
+    M34_HANDLE         *m34Hdl,
+    int32              code,
+    M_SETGETSTAT_BLOCK *blockStruct
+)
+{
+   int32   error;
+   u_int32 n, nbrCfg;
+   M34_CH_CFG *cfgP;
+   M34_CAPT_CFG *captP;
+   OSS_IRQ_STATE irqState;
+
+   error = 0;
+   switch( code )
+   {
+       case M34_BLK_CH_CFG:
+          cfgP   = (M34_CH_CFG*)blockStruct->data;
+          nbrCfg = blockStruct->size / sizeof(M34_CH_CFG);
+
+          if( blockStruct->size % sizeof(M34_CH_CFG) ||
+              nbrCfg == 0 || nbrCfg > m34Hdl->nbrOfChannels )
+          {
+              error = ERR_LL_ILL_PARAM;
+              break;
+          }
+          if( m34Hdl->captOn )
+          {
+              error = ERR_LL_DEV_BUSY;
+              break;
+          }
+
+          /* check complete table first */
+          for( n=0; n<nbrCfg; n++ )
+          {
+              if( cfgP[n].gain > M34_GAIN_8 ||
+                  (cfgP[n].bipolar != M34_BIPOLAR &&
+                   cfgP[n].bipolar != M34_UNIPOLAR) ||
+                  cfgP[n].rdBlkIrq > 1 ||
+                  cfgP[n].settle > M34_SETTLE_MAX )
+              {
+                  DBGWRT_ERR((DBH,"*** LL - setStatBlock: M34_BLK_CH_CFG "
+                              "entry %d invalid\n", n));
+                  error = ERR_LL_ILL_PARAM;
+                  break;
+              }
+          }/*for*/
+          if( error )
+              break;
+
+          /* aligned buffer depends on the channel selection */
+          for( n=0; n<nbrCfg; n++ )
+              if( m34Hdl->chBlkRd[n] != cfgP[n].rdBlkIrq )
+                  break;
+          if( n < nbrCfg && rdBufBusy( m34Hdl ) )
+          {
+              error = ERR_LL_DEV_BUSY;
+              break;
+          }
+
+          irqState = OSS_IrqMaskR( m34Hdl->osHdl, m34Hdl->irqHdl );
+          for( n=0; n<nbrCfg; n++ )
+          {
+              setGain( cfgP[n].gain, &m34Hdl->chCtrl[n] );
+              setBipolar( cfgP[n].bipolar, &m34Hdl->chCtrl[n] );
+
+              m34Hdl->chBlkRd[n]  = cfgP[n].rdBlkIrq;
+              m34Hdl->chSettle[n] = cfgP[n].settle;
+          }/*for*/
+          updScanList( m34Hdl );
+          updDummyRd( m34Hdl );
+
+          MWRITE_D16( m34Hdl->ma34, M34_CTRL_WR, m34Hdl->chCtrl[0] );
+          OSS_IrqRestore( m34Hdl->osHdl, m34Hdl->irqHdl, irqState );
+          error = rdBufAlign( m34Hdl );
+          break;
+
+       case M34_BLK_CAPT_CFG:
+          captP = (M34_CAPT_CFG*)blockStruct->data;
+
+          if( blockStruct->size != sizeof(M34_CAPT_CFG) ||
+              captP->source > M34_CAPT_LVL_FALL ||
+              captP->ch >= m34Hdl->nbrOfChannels ||
+              captP->pre >= M34_CAPT_FRAMES_MAX ||
+              captP->post >= M34_CAPT_FRAMES_MAX )
+          {
+              error = ERR_LL_ILL_PARAM;
+              break;
+          }
+          if( m34Hdl->captOn )
+          {
+              error = ERR_LL_DEV_BUSY;
+              break;
+          }
+          m34Hdl->captCfg = *captP;
+          break;
+
+       default:
+          error = ERR_LL_UNK_CODE;
+   }/*switch*/
+
+   return( error );
+}/*setStatBlock*/
+
+/************************** setStatNeedsRdLock ******************************
+ *
+ *  Description:  Checks if a setstat code changes the acquisition setup
+ *                of a running block read and must therefore wait for it.
+ *                Setups a reader waiting with the read lock released
+ *                relies on can't be changed until it returns.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  code     setstat code
+ *
+ *  Output.....:  return   M34_RDLOCK_IDLE=take read lock, fail while a
+ *                         reader waits
+ *                         M34_RDLOCK=take read lock (also wakes or ends
+ *                         a waiting reader)
+ *                         0=hw lock is sufficient
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static int32 setStatNeedsRdLock( int32 code )
+{
+	switch( code )
+	{
+		case M34_IRQ_MODE:
+		case M34_CH_RDBLK_IRQ:
+		case M34_BLK_CH_CFG:
+		case M34_READ_AHEAD:
+		case M34_FRAME_ALIGN:
+		case M34_SETTLE_CAL:
+		case M34_DEFER_MASK:
+		case M34_POLL_OWNER:
+		case M34_RD_RAW:
+		case M34_BLK_CAPT_CFG:
+			return( M34_RDLOCK_IDLE );
+
+		/* re-checked by the waiting reader */
+		case M34_BATCH_FRAMES:
+		case M34_ASYNC_ENABLE:
+		case M34_CAPT_ENABLE:
+			return( M34_RDLOCK );
+
+		default:
+			/* MBUF reconfiguration */
+			if(    ( M_RDBUF_OF <= code && code <= (M_WRBUF_OF+0x0f) )
+				|| ( M_RDBUF_BLK_OF <= code && code <= (M_RDBUF_BLK_OF+0x0f) ) )
+				return( M34_RDLOCK_IDLE );
+	}/*switch*/
+
+	return( 0 );
+}/*setStatNeedsRdLock*/
+
+/******************************* traceRec ***********************************
+ *
+ *  Description:  Writes one record into the trace ring.
+ *                Called via M34_TRACE() only if the event class is enabled.
+ *                The ring is written without locking (isr and caller may
+ *                occasionally overwrite the same record).
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl   m34 handle
+ *                event    event id M34_TEV_XXX
+ *                ch       channel or M34_TRC_NOCH
+ *                arg1     event specific argument
+ *                arg2     event specific argument
+ *
+ *  Output.....:  -
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static void traceRec
+(
+	M34_HANDLE	*m34Hdl,
+	u_int16		event,
+	u_int32		ch,
+	u_int32		arg1,
+	u_int32		arg2
+)
+{
+	M34_TRACE_REC *recP;
+
+	recP = &m34Hdl->trcRing[m34Hdl->trcIdx++ & (M34_TRACE_RECS-1)];
+	recP->tstamp = M34_TSTAMP(m34Hdl);
+	recP->event  = event;
+	recP->ch     = (u_int16)ch;
+	recP->arg1   = arg1;
+	recP->arg2   = arg2;
+}/*traceRec*/
+
+/******************************* traceTsFreq ********************************
+ *
+ *  Description:  Gets the frequency of the trace timestamps.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl   m34 handle
+ *
+ *  Output.....:  return   frequency [Hz] | 0 if unknown
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static u_int32 traceTsFreq( M34_HANDLE *m34Hdl )
+{
+#if defined(M34_TSTAMP_FREQ)
+	return( M34_TSTAMP_FREQ(m34Hdl) );
+#elif defined(WINNT)
+	LARGE_INTEGER	freq;
+
+	KeQueryPerformanceCounter(&freq);
+	return( (u_int32)freq.LowPart );
+#else
+	return( 0 );
+#endif
+}/*traceTsFreq*/
+
+/******************************* readIdProm *********************************
+ *
+ *  Description:  Reads the complete ID-PROM into the driver cache and
+ *                checks the magic word.
+ *                The serial PROM access uses the module id register, the
+ *                caller must restore the bus error bit (setBusErrBit).
+ *                Called with the hw lock taken (or from M34_Init).
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl   m34 handle
+ *
+ *  Output.....:  m34Hdl->idData/idValid/modId
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static void readIdProm( M34_HANDLE *m34Hdl )
+{
+	u_int32 i;
+
+	for( i = 0; i < M34_ID_WORDS; i++ )
+		m34Hdl->idData[i] = (u_int16)m_read( (U_INT32_OR_64)m34Hdl->ma34, (u_int8)i );
+
+	m34Hdl->idRead  = 1;
+	m34Hdl->idValid = (m34Hdl->idData[0] == MOD_ID_MAGIC_WORD);
+	m34Hdl->modId   = m34Hdl->idData[1];
+
+	DBGWRT_2((DBH, " ID-PROM: magic=0x%04x modId=%d\n",
+			  m34Hdl->idData[0], m34Hdl->idData[1]));
+}/*readIdProm*/
+
+/******************************* idPromGet **********************************
+ *
+ *  Description:  Fills the ID-PROM cache on first use. Without ID_CHECK
+ *                the PROM isn't accessed at init: modules or carriers
+ *                without PROM may trap on the access.
+ *                Called unlocked (takes the hw lock).
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl   m34 handle
+ *
+ *  Output.....:  return   0 | error code
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static int32 idPromGet( M34_HANDLE *m34Hdl )
+{
+	int32	error;
+
+	if( m34Hdl->idRead )
+		return( 0 );
+
+	if( (error = M34_LOCK( m34Hdl, hwSem )) )
+		return( error );
+
+	if( m34Hdl->pollOwner )
+		error = ERR_LL_DEV_BUSY;		/* registers owned by user space */
+	else if( !m34Hdl->idRead ) {
+		readIdProm( m34Hdl );
+		setBusErrBit( m34Hdl );
+	}
+
+	M34_UNLOCK( m34Hdl, hwSem );
+	return( error );
+}/*idPromGet*/
+
+/****************************** setBusErrBit ********************************
+ *
+ *  Description:  Sets or clears the bit that prevents the bus error
+ *                (descriptor key M34_PREVENT_BUSERR).
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl   m34 handle
+ *
+ *  Output.....:  -
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static void setBusErrBit( M34_HANDLE *m34Hdl )
+{
+    if (m34Hdl->preventBusErr) { 
+		/* set the bit that prevent the bus error */
+		MSETMASK_D16( m34Hdl->ma34, M34_MODID, M34_MODID_BUSERBIT );
+	}
+	else {
+		/* clear the bit that prevent the bus error */
+		MCLRMASK_D16( m34Hdl->ma34, M34_MODID, M34_MODID_BUSERBIT );
+	}
+}/*setBusErrBit*/
+
+/******************************* updDummyRd *********************************
+ *
+ *  Description:  Recalculates the dummy reads per channel from
+ *                M34_DUMMY_READS and the channel settle count.
+ *                Must be called with irqs masked (or before irq install).
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  m34Hdl   m34 handle
+ *
+ *  Output.....:  -
+ *
+ *  Globals....:  ---
+ *
+ ****************************************************************************/
+static void updDummyRd( M34_HANDLE *m34Hdl )
+{
+u_int32 ch;
+
+	for( ch = 0; ch < M34_SINGLE_ENDED_MAX_CH; ch++ )
+		m34Hdl->chDummyRd[ch] = m34Hdl->nbrDummyRd + m34Hdl->chSettle[ch];
+}/*updDummyRd*/
+
 static void setGain( u_int16 gain, u_int16 *chCtrlP )
 {
     *chCtrlP &= ~( M34_GAIN_8 << CTRL_GAIN);
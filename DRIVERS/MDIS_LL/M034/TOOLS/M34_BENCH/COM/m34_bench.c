@@ -0,0 +1,784 @@
+/****************************************************************************
+ ************                                                    ************
+ ************                M 3 4 _ B E N C H                   ************
+ ************                                                    ************
+ ****************************************************************************
+ *
+ *       Author: ds
+ *
+ *  Description: Throughput and latency benchmark of the M34/M35 driver
+ *
+ *               The tool sweeps irq mode, buffer mode, channel count,
+ *               dummy reads and block size. Each point reads blocks for
+ *               the measuring time and reports
+ *
+ *                 - sustained samples/s
+ *                 - M_getblock latency percentiles [us]
+ *                 - irqs per frame (M_LL_IRQ_COUNT)
+ *                 - cpu time per sample [us], all cpus (/proc/stat,
+ *                   includes the isr) and this process
+ *                 - dropped frames (M34_BLK_TELEMETRY rdLost)
+ *                 - isr time per irq and max isr time [us]
+ *                   (M34_BLK_TELEMETRY isrXXX, -r only: enables
+ *                   M34_ISR_STATS, which needs a fine driver timestamp
+ *                   and adds two timestamps per irq, else empty/null)
+ *
+ *               as CSV (default) or JSON, one line/object per point.
+ *               The label (-l=) is written into each point to compare
+ *               driver versions and carriers, e.g. the isr time per
+ *               irq of two driver builds.
+ *
+ *               A point that can't be configured is written with the
+ *               failed step (failed column/member), the sweep continues.
+ *
+ *               Irq mode 3 ignores channel selection, block size and
+ *               buffer mode, it runs once per dummy read count. Irq mode
+ *               2 with M_BUF_CURRBUF is skipped. Without trigger signal a
+ *               point ends with the first block read timeout.
+ *               The channel, mode, dummy read and timeout settings are
+ *               restored at the end.
+ *
+ *     Required: Libraries: mdis_api, usr_oss, usr_utl
+ *     Switches: LINUX
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 2026, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef LINUX
+# include <time.h>
+# include <unistd.h>
+#endif
+#include <MEN/men_typs.h>
+#include <MEN/usr_oss.h>
+#include <MEN/usr_utl.h>
+#include <MEN/mdis_api.h>
+#include <MEN/mdis_err.h>
+#include <MEN/m34_drv.h>
+
+static const char IdentString[]=MENT_XSTR(MAK_REVISION);
+
+/*--------------------------------------+
+|   DEFINES                             |
++--------------------------------------*/
+#define MAX_CH		M34_SINGLE_ENDED_MAX_CH
+#define MAX_LIST	16			/* entries per sweep list */
+#define MAX_LAT		100000		/* latencies kept per point */
+#define MAX_FRAMES	1024		/* max block size [frames] */
+
+/*--------------------------------------+
+|   TYPDEFS                             |
++--------------------------------------*/
+/* sweep point */
+typedef struct {
+	int32	irqMode;
+	int32	bufMode;
+	int32	nbrCh;		/* first n channels */
+	int32	dummy;		/* M34_DUMMY_READS */
+	int32	frames;		/* block size [frames] */
+} BENCH_POINT;
+
+/* measured values of a point */
+typedef struct {
+	int32	blkSize;	/* block size [byte] */
+	int32	reads;		/* block reads */
+	int32	errors;		/* failed block reads */
+	double	samples;	/* samples/s */
+	double	lat[4];		/* latency p50, p90, p99, max [us] */
+	double	irqs;		/* irqs per frame */
+	double	cpuUs;		/* cpu time per sample, all cpus [us] */
+	double	procUs;		/* cpu time per sample, this process [us] */
+	u_int32	dropped;	/* dropped frames */
+	double	isrUs;		/* isr time per irq [us] (<0: unknown) */
+	double	isrUsMax;	/* max isr time [us] (<0: unknown) */
+	char	fail[80];	/* failed configuration step ("": none) */
+} BENCH_RESULT;
+
+/*--------------------------------------+
+|   GLOBALS                             |
++--------------------------------------*/
+static double	*G_Lat;		/* block read latencies of a point [us] */
+
+/*--------------------------------------+
+|   PROTOTYPES                          |
++--------------------------------------*/
+static void usage(void);
+static void PrintMdisError(char *info);
+static void PointError(BENCH_RESULT *res, char *info);
+static int32 ParseList(char *str, int32 *list, int32 min, int32 max);
+static int32 RunPoint(MDIS_PATH path, BENCH_POINT *pt, int32 chNbr,
+					  M34_CH_CFG *chCfg, int32 msec, BENCH_RESULT *res);
+static void PrintPoint(FILE *fp, int32 json, int32 first, char *label,
+					   BENCH_POINT *pt, BENCH_RESULT *res);
+static char *FmtUs(char *buf, double us, char *unknown);
+static int CmpDouble(const void *a, const void *b);
+static double TimeUs(void);
+static double ProcUs(void);
+static double BusyUs(void);
+
+/********************************* usage ************************************
+ *
+ *  Description: Print program usage
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void usage(void)
+{
+	printf("Usage: m34_bench [<opts>] <device> [<opts>]\n");
+	printf("Function: Throughput and latency benchmark of the M34/M35\n");
+	printf("          driver across irq and buffer modes\n");
+	printf("Options: (<list> = comma separated values)\n");
+	printf("    device       device name                      [none]\n");
+	printf("    -i=<list>    irq modes 0..4                   [0,1,2,3]\n");
+	printf("    -b=<list>    buffer modes                     [2]\n");
+	printf("                   0 = M_BUF_USRCTRL\n");
+	printf("                   1 = M_BUF_CURRBUF\n");
+	printf("                   2 = M_BUF_RINGBUF\n");
+	printf("                   3 = M_BUF_RINGBUF_OVERWR\n");
+	printf("    -c=<list>    number of channels (first n)     [1,all]\n");
+	printf("    -d=<list>    dummy reads 0..10                [0]\n");
+	printf("    -s=<list>    block size [frames] 1..%d      [1,16]\n",
+		   MAX_FRAMES);
+	printf("    -t=<msec>    measuring time per point         [1000]\n");
+	printf("    -o=<msec>    block read timeout               [1000]\n");
+	printf("    -r           isr time statistics              [no]\n");
+	printf("                 (M34_ISR_STATS, 2 timestamps/irq)\n");
+	printf("    -j           JSON output (default CSV)        [no]\n");
+	printf("    -l=<label>   label of each point (driver,\n");
+	printf("                 carrier, ..)                     [none]\n");
+	printf("    -w=<file>    write results to file            [stdout]\n");
+	printf("\n");
+	printf("Copyright 2026, MEN Mikro Elektronik GmbH\n%s\n", IdentString);
+}
+
+/********************************* main *************************************
+ *
+ *  Description: Program main function
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: argc,argv	argument counter, data ..
+ *  Output.....: return	    success (0) or error (1)
+ *  Globals....: -
+ ****************************************************************************/
+int main(int argc, char *argv[])
+{
+	MDIS_PATH			path=0;
+	int32				n, chNbr, msec, tout, json, first=1, ret = 1;
+	int32				nbrIrq, nbrBuf, nbrCh, nbrDummy, nbrSize;
+	int32				iIrq, iBuf, iCh, iDummy, iSize;
+	int32				irqList[MAX_LIST], bufList[MAX_LIST], chList[MAX_LIST];
+	int32				dummyList[MAX_LIST], sizeList[MAX_LIST];
+	int32				oldIrqMode, oldBufMode, oldDummy, oldTout, saved=0;
+	int32				isrStats;
+	char				*device, *str, *errstr, *label, *file, buf[40];
+	FILE				*fp = stdout;
+	M_SETGETSTAT_BLOCK	blk;
+	M34_CH_CFG			chCfg[MAX_CH];
+	BENCH_POINT			pt;
+	BENCH_RESULT		res;
+
+	/*--------------------+
+    |  check arguments    |
+    +--------------------*/
+	if ((errstr = UTL_ILLIOPT("i=b=c=d=s=t=o=l=w=jr?", buf))) {	/* check args */
+		printf("*** %s\n", errstr);
+		return(1);
+	}
+
+	if (UTL_TSTOPT("?")) {						/* help requested ? */
+		usage();
+		return(1);
+	}
+
+	/*--------------------+
+    |  get arguments      |
+    +--------------------*/
+	for (device=NULL, n=1; n<argc; n++)
+		if (*argv[n] != '-') {
+			device = argv[n];
+			break;
+		}
+
+	if (!device) {
+		usage();
+		return(1);
+	}
+
+	msec  = ((str = UTL_TSTOPT("t=")) ? atoi(str) : 1000);
+	tout  = ((str = UTL_TSTOPT("o=")) ? atoi(str) : 1000);
+	json  = (UTL_TSTOPT("j") ? 1 : 0);
+	isrStats = (UTL_TSTOPT("r") ? 1 : 0);
+	label = ((str = UTL_TSTOPT("l=")) ? str : "");
+	file  = UTL_TSTOPT("w=");
+
+	nbrIrq   = ParseList(UTL_TSTOPT("i="), irqList, 0, M34_IMODE_TIMER);
+	nbrBuf   = ParseList(UTL_TSTOPT("b="), bufList, 0, 3);
+	nbrDummy = ParseList(UTL_TSTOPT("d="), dummyList, 0, 10);
+	nbrSize  = ParseList(UTL_TSTOPT("s="), sizeList, 1, MAX_FRAMES);
+	if (nbrIrq < 0 || nbrBuf < 0 || nbrDummy < 0 || nbrSize < 0 ||
+		msec <= 0 || tout < 0) {
+		usage();
+		return(1);
+	}
+
+	/* defaults */
+	if (nbrIrq == 0) {
+		for (n=0; n<=M34_IMODE_FIX; n++)
+			irqList[n] = n;
+		nbrIrq = M34_IMODE_FIX + 1;
+	}
+	if (nbrBuf == 0) {
+		bufList[0] = M_BUF_RINGBUF;
+		nbrBuf = 1;
+	}
+	if (nbrDummy == 0) {
+		dummyList[0] = 0;
+		nbrDummy = 1;
+	}
+	if (nbrSize == 0) {
+		sizeList[0] = 1;
+		sizeList[1] = 16;
+		nbrSize = 2;
+	}
+
+	if ((G_Lat = (double*)malloc(MAX_LAT * sizeof(double))) == NULL) {
+		printf("*** can't alloc memory\n");
+		return(1);
+	}
+
+	/*--------------------+
+    |  open path          |
+    +--------------------*/
+	if ((path = M_open(device)) < 0) {
+		PrintMdisError("open");
+		goto abort;
+	}
+
+	if ((M_getstat(path, M_LL_CH_NUMBER, &chNbr)) < 0) {
+		PrintMdisError("getstat M_LL_CH_NUMBER");
+		goto abort;
+	}
+
+	nbrCh = ParseList(UTL_TSTOPT("c="), chList, 1, chNbr);
+	if (nbrCh < 0) {
+		usage();
+		goto abort;
+	}
+	if (nbrCh == 0) {
+		chList[0] = 1;
+		chList[1] = chNbr;
+		nbrCh = 2;
+	}
+
+	/*--------------------+
+    |  save settings      |
+    +--------------------*/
+	blk.size = chNbr * sizeof(M34_CH_CFG);
+	blk.data = (void*)chCfg;
+	if ((M_getstat(path, M34_BLK_CH_CFG, (int32*)&blk)) < 0 ||
+		(M_getstat(path, M34_IRQ_MODE, &oldIrqMode)) < 0 ||
+		(M_getstat(path, M_BUF_RD_MODE, &oldBufMode)) < 0 ||
+		(M_getstat(path, M_BUF_RD_TIMEOUT, &oldTout)) < 0 ||
+		(M_getstat(path, M34_DUMMY_READS, &oldDummy)) < 0) {
+		PrintMdisError("getstat settings");
+		goto abort;
+	}
+	saved = 1;
+
+	if (file && (fp = fopen(file, "w")) == NULL) {
+		printf("*** can't open %s\n", file);
+		fp = stdout;
+		goto abort;
+	}
+
+	if ((M_setstat(path, M_BUF_RD_TIMEOUT, tout)) < 0) {
+		PrintMdisError("setstat M_BUF_RD_TIMEOUT");
+		goto abort;
+	}
+
+	/* isr time columns stay unknown if the driver can't time the isr */
+	if (isrStats && (M_setstat(path, M34_ISR_STATS, 1)) < 0) {
+		PrintMdisError("setstat M34_ISR_STATS");
+		isrStats = 0;
+	}
+
+	/*--------------------+
+    |  sweep              |
+    +--------------------*/
+	if (json)
+		fprintf(fp, "[\n");
+	else
+		fprintf(fp, "label,irqmode,bufmode,channels,dummy,block_bytes,reads,"
+				"errors,samples_per_s,lat_p50_us,lat_p90_us,lat_p99_us,"
+				"lat_max_us,irqs_per_frame,cpu_us_per_sample,"
+				"proc_us_per_sample,dropped,isr_us_per_irq,isr_us_max,failed\n");
+
+	for (iIrq=0; iIrq<nbrIrq; iIrq++)
+	for (iBuf=0; iBuf<nbrBuf; iBuf++)
+	for (iCh=0; iCh<nbrCh; iCh++)
+	for (iDummy=0; iDummy<nbrDummy; iDummy++)
+	for (iSize=0; iSize<nbrSize; iSize++) {
+		pt.irqMode = irqList[iIrq];
+		pt.bufMode = bufList[iBuf];
+		pt.nbrCh   = chList[iCh];
+		pt.dummy   = dummyList[iDummy];
+		pt.frames  = sizeList[iSize];
+
+		/* fix mode: all channels, one frame, no buffer */
+		if (pt.irqMode == M34_IMODE_FIX) {
+			if (iBuf || iCh || iSize)
+				continue;
+			pt.nbrCh  = chNbr;
+			pt.frames = 1;
+		}
+		if (pt.irqMode == M34_IMODE_CHIRQ_AUTO && pt.bufMode == M_BUF_CURRBUF)
+			continue;
+
+		/* a failed point is written with the error, the sweep goes on */
+		RunPoint(path, &pt, chNbr, chCfg, msec, &res);
+
+		PrintPoint(fp, json, first, label, &pt, &res);
+		first = 0;
+		fflush(fp);
+	}
+
+	if (json)
+		fprintf(fp, "\n]\n");
+
+	ret = 0;
+
+	/*--------------------+
+    |  cleanup            |
+    +--------------------*/
+	abort:
+	if (fp != stdout)
+		fclose(fp);
+
+	if (saved) {
+		M_setstat(path, M_MK_IRQ_ENABLE, 0);
+		if (isrStats)
+			M_setstat(path, M34_ISR_STATS, 0);
+		blk.size = chNbr * sizeof(M34_CH_CFG);
+		blk.data = (void*)chCfg;
+		if ((M_setstat(path, M34_BLK_CH_CFG, (INT32_OR_64)&blk)) < 0 ||
+			(M_setstat(path, M34_IRQ_MODE, oldIrqMode)) < 0 ||
+			(M_setstat(path, M_BUF_RD_MODE, oldBufMode)) < 0 ||
+			(M_setstat(path, M_BUF_RD_TIMEOUT, oldTout)) < 0 ||
+			(M_setstat(path, M34_DUMMY_READS, oldDummy)) < 0)
+			PrintMdisError("restore settings");
+	}
+
+	if (path > 0 && M_close(path) < 0)
+		PrintMdisError("close");
+
+	free(G_Lat);
+	return(ret);
+}
+
+/********************************* ParseList ********************************
+ *
+ *  Description: Parse a comma separated list of values
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: str		list (NULL: empty)
+ *               list		values (MAX_LIST)
+ *               min, max	valid range
+ *  Output.....: return		number of values | -1 (invalid)
+ *  Globals....: -
+ ****************************************************************************/
+static int32 ParseList(char *str, int32 *list, int32 min, int32 max)
+{
+	int32	n = 0;
+	char	*end;
+
+	if (str == NULL)
+		return( 0 );
+
+	while (*str) {
+		if (n == MAX_LIST)
+			return( -1 );
+		list[n] = (int32)strtol(str, &end, 0);
+		if (end == str || list[n] < min || list[n] > max ||
+			(*end && *end != ','))
+			return( -1 );
+		n++;
+		str = *end ? end + 1 : end;
+	}
+
+	return( n );
+}
+
+/********************************* RunPoint *********************************
+ *
+ *  Description: Configure and measure one sweep point
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: path		device path
+ *               pt			sweep point
+ *               chNbr		number of channels of the module
+ *               chCfg		saved channel config (gain, polarity)
+ *               msec		measuring time
+ *  Output.....: res		measured values, failed step
+ *               return		0 | -1 (configuration failed)
+ *  Globals....: G_Lat
+ ****************************************************************************/
+static int32 RunPoint(MDIS_PATH path, BENCH_POINT *pt, int32 chNbr,
+					  M34_CH_CFG *chCfg, int32 msec, BENCH_RESULT *res)
+{
+	M_SETGETSTAT_BLOCK	blk;
+	M34_CH_CFG			cfg[MAX_CH];
+	M34_TELEMETRY		tele;
+	int32				ch, got, nbrLat=0, irqCount=0, irqOn, ret = -1;
+	u_int8				*data;
+	double				t0, t, tEnd, busy0, proc0, words=0.0, frames;
+
+	memset(res, 0, sizeof(*res));
+	res->isrUs   = res->isrUsMax = -1.0;
+	res->blkSize = pt->frames * pt->nbrCh * 2;
+
+	if ((data = (u_int8*)malloc(res->blkSize)) == NULL) {
+		printf("*** can't alloc memory\n");
+		strcpy(res->fail, "alloc memory");
+		return( -1 );
+	}
+
+	/*--------------------+
+    |  configure          |
+    +--------------------*/
+	if ((M_setstat(path, M_MK_IRQ_ENABLE, 0)) < 0) {
+		PointError(res, "setstat M_MK_IRQ_ENABLE");
+		goto abort;
+	}
+	if ((M_setstat(path, M34_IRQ_MODE, pt->irqMode)) < 0) {
+		PointError(res, "setstat M34_IRQ_MODE");
+		goto abort;
+	}
+	if ((M_setstat(path, M_BUF_RD_MODE, pt->bufMode)) < 0) {
+		PointError(res, "setstat M_BUF_RD_MODE");
+		goto abort;
+	}
+	if ((M_setstat(path, M34_DUMMY_READS, pt->dummy)) < 0) {
+		PointError(res, "setstat M34_DUMMY_READS");
+		goto abort;
+	}
+
+	for (ch=0; ch<chNbr; ch++) {
+		cfg[ch] = chCfg[ch];
+		cfg[ch].rdBlkIrq = ch < pt->nbrCh ? 1 : 0;
+	}
+	blk.size = chNbr * sizeof(M34_CH_CFG);
+	blk.data = (void*)cfg;
+	if ((M_setstat(path, M34_BLK_CH_CFG, (INT32_OR_64)&blk)) < 0) {
+		PointError(res, "setstat M34_BLK_CH_CFG");
+		goto abort;
+	}
+
+	/* statistics */
+	if ((M_setstat(path, M_LL_IRQ_COUNT, 0)) < 0 ||
+		(M_setstat(path, M34_RD_LEVEL_MAX, 0)) < 0) {
+		PointError(res, "setstat M_LL_IRQ_COUNT/M34_RD_LEVEL_MAX");
+		goto abort;
+	}
+
+	/* irq modes with buffer and fix mode (see m34_blkread) */
+	irqOn = pt->bufMode != M_BUF_USRCTRL || pt->irqMode == M34_IMODE_FIX;
+
+	/*--------------------+
+    |  measure            |
+    +--------------------*/
+	busy0 = BusyUs();
+	proc0 = ProcUs();
+	t0    = TimeUs();
+	tEnd  = t0 + msec * 1000.0;
+
+	if (irqOn && (M_setstat(path, M_MK_IRQ_ENABLE, 1)) < 0) {
+		PointError(res, "setstat M_MK_IRQ_ENABLE");
+		goto abort;
+	}
+
+	do {
+		t   = TimeUs();
+		got = M_getblock(path, data, res->blkSize);
+		if (nbrLat < MAX_LAT)
+			G_Lat[nbrLat++] = TimeUs() - t;
+		res->reads++;
+
+		/* adaptive irq mode switched (M34_IRQ_ADAPT): no data, go on */
+		if (got < 0 && UOS_ErrnoGet() == M34_ERR_IRQ_ADAPT)
+			continue;
+
+		/* no trigger (timeout) or not supported: end of point */
+		if (got < 0) {
+			res->errors++;
+			break;
+		}
+		words += got / 2;
+	} while (TimeUs() < tEnd);
+
+	if (irqOn)
+		M_setstat(path, M_MK_IRQ_ENABLE, 0);
+
+	t = TimeUs() - t0;
+	res->cpuUs  = BusyUs() - busy0;
+	res->procUs = ProcUs() - proc0;
+
+	/*--------------------+
+    |  evaluate           |
+    +--------------------*/
+	if ((M_getstat(path, M_LL_IRQ_COUNT, &irqCount)) < 0)
+		PrintMdisError("getstat M_LL_IRQ_COUNT");
+
+	blk.size = sizeof(tele);
+	blk.data = (void*)&tele;
+	memset(&tele, 0, sizeof(tele));
+	if ((M_getstat(path, M34_BLK_TELEMETRY, (int32*)&blk)) < 0)
+		PrintMdisError("getstat M34_BLK_TELEMETRY");
+
+	frames = words / pt->nbrCh;
+	res->samples = t > 0.0 ? words * 1000000.0 / t : 0.0;
+	res->irqs    = frames > 0.0 ? irqCount / frames : 0.0;
+	res->cpuUs   = words > 0.0 ? res->cpuUs / words : 0.0;
+	res->procUs  = words > 0.0 ? res->procUs / words : 0.0;
+	res->dropped = tele.rdLost;
+
+	/* isr time statistics, reset with M_LL_IRQ_COUNT */
+	if (tele.tsFreq && tele.isrCount) {
+		res->isrUs    = tele.isrTime * 1000000.0 / tele.tsFreq / tele.isrCount;
+		res->isrUsMax = tele.isrTimeMax * 1000000.0 / tele.tsFreq;
+	}
+
+	if (nbrLat) {
+		qsort(G_Lat, nbrLat, sizeof(double), CmpDouble);
+		res->lat[0] = G_Lat[(nbrLat - 1) / 2];
+		res->lat[1] = G_Lat[(nbrLat - 1) * 90 / 100];
+		res->lat[2] = G_Lat[(nbrLat - 1) * 99 / 100];
+		res->lat[3] = G_Lat[nbrLat - 1];
+	}
+
+	ret = 0;
+
+	abort:
+	free(data);
+	return( ret );
+}
+
+/********************************* PrintPoint *******************************
+ *
+ *  Description: Print the results of a point as CSV line or JSON object
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: fp			output
+ *               json		JSON instead of CSV
+ *               first		first point (JSON separator)
+ *               label		label
+ *               pt			sweep point
+ *               res		measured values
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void PrintPoint(FILE *fp, int32 json, int32 first, char *label,
+					   BENCH_POINT *pt, BENCH_RESULT *res)
+{
+	char	isr[2][32], fail[84];
+
+	if (!json) {
+		fprintf(fp, "%s,%d,%d,%d,%d,%d,%d,%d,%.0f,%.1f,%.1f,%.1f,%.1f,"
+				"%.3f,%.3f,%.3f,%u,%s,%s,%s\n",
+				label, (int)pt->irqMode, (int)pt->bufMode, (int)pt->nbrCh,
+				(int)pt->dummy, (int)res->blkSize, (int)res->reads,
+				(int)res->errors, res->samples, res->lat[0], res->lat[1],
+				res->lat[2], res->lat[3], res->irqs, res->cpuUs,
+				res->procUs, (unsigned)res->dropped,
+				FmtUs(isr[0], res->isrUs, ""), FmtUs(isr[1], res->isrUsMax, ""),
+				res->fail);
+		return;
+	}
+
+	if (*res->fail)
+		sprintf(fail, "\"%s\"", res->fail);
+	else
+		strcpy(fail, "null");
+
+	fprintf(fp, "%s  {\"label\": \"%s\", \"irqmode\": %d, \"bufmode\": %d, "
+			"\"channels\": %d, \"dummy\": %d, \"block_bytes\": %d, "
+			"\"reads\": %d, \"errors\": %d, \"samples_per_s\": %.0f, "
+			"\"lat_us\": {\"p50\": %.1f, \"p90\": %.1f, \"p99\": %.1f, "
+			"\"max\": %.1f}, \"irqs_per_frame\": %.3f, "
+			"\"cpu_us_per_sample\": %.3f, \"proc_us_per_sample\": %.3f, "
+			"\"dropped\": %u, \"isr_us_per_irq\": %s, \"isr_us_max\": %s, "
+			"\"failed\": %s}",
+			first ? "" : ",\n", label, (int)pt->irqMode, (int)pt->bufMode,
+			(int)pt->nbrCh, (int)pt->dummy, (int)res->blkSize,
+			(int)res->reads, (int)res->errors, res->samples, res->lat[0],
+			res->lat[1], res->lat[2], res->lat[3], res->irqs, res->cpuUs,
+			res->procUs, (unsigned)res->dropped,
+			FmtUs(isr[0], res->isrUs, "null"),
+			FmtUs(isr[1], res->isrUsMax, "null"), fail);
+}
+
+/********************************* FmtUs ************************************
+ *
+ *  Description: Format an optional time
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: buf		output buffer (32 chars)
+ *               us			time [us] (<0: unknown)
+ *               unknown	text for unknown
+ *  Output.....: return		buf | unknown
+ *  Globals....: -
+ ****************************************************************************/
+static char *FmtUs(char *buf, double us, char *unknown)
+{
+	if (us < 0.0)
+		return( unknown );
+
+	sprintf(buf, "%.3f", us);
+	return( buf );
+}
+
+/********************************* CmpDouble ********************************
+ *
+ *  Description: qsort compare function
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: a, b		values
+ *  Output.....: return		<0, 0, >0
+ *  Globals....: -
+ ****************************************************************************/
+static int CmpDouble(const void *a, const void *b)
+{
+	double	da = *(const double*)a, db = *(const double*)b;
+
+	return( da < db ? -1 : da > db ? 1 : 0 );
+}
+
+/********************************* TimeUs ***********************************
+ *
+ *  Description: Monotonic time
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: return		time [us]
+ *  Globals....: -
+ ****************************************************************************/
+static double TimeUs(void)
+{
+#ifdef LINUX
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return( ts.tv_sec * 1000000.0 + ts.tv_nsec / 1000.0 );
+#else
+	return( UOS_MsecTimerGet() * 1000.0 );
+#endif
+}
+
+/********************************* ProcUs ***********************************
+ *
+ *  Description: Cpu time of this process (user and kernel)
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: return		time [us] (0 if unknown)
+ *  Globals....: -
+ ****************************************************************************/
+static double ProcUs(void)
+{
+#ifdef LINUX
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return( ts.tv_sec * 1000000.0 + ts.tv_nsec / 1000.0 );
+#else
+	return( 0.0 );
+#endif
+}
+
+/********************************* BusyUs ***********************************
+ *
+ *  Description: Busy time of all cpus (not idle/iowait), includes irq
+ *               and softirq time
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: return		time [us] (0 if unknown)
+ *  Globals....: -
+ ****************************************************************************/
+static double BusyUs(void)
+{
+#ifdef LINUX
+	FILE			*fp;
+	unsigned long	v[8];
+	double			busy = 0.0;
+	int				n;
+
+	if ((fp = fopen("/proc/stat", "r")) == NULL)
+		return( 0.0 );
+
+	memset(v, 0, sizeof(v));
+	/* cpu user nice system idle iowait irq softirq steal */
+	if (fscanf(fp, "cpu %lu %lu %lu %lu %lu %lu %lu %lu",
+			   &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7]) >= 4)
+		for (n=0; n<8; n++)
+			if (n != 3 && n != 4)
+				busy += v[n];
+	fclose(fp);
+
+	return( busy * 1000000.0 / sysconf(_SC_CLK_TCK) );
+#else
+	return( 0.0 );
+#endif
+}
+
+/********************************* PrintMdisError ***************************
+ *
+ *  Description: Print MDIS error message
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: info	info string
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+
+static void PrintMdisError(char *info)
+{
+	/* stderr: keeps the results on stdout parsable */
+	fprintf(stderr, "*** can't %s: %s\n", info, M_errstring(UOS_ErrnoGet()));
+}
+
+/********************************* PointError *******************************
+ *
+ *  Description: Print MDIS error message and record it as failed step
+ *               of the point
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: res	measured values of the point
+ *               info	info string
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void PointError(BENCH_RESULT *res, char *info)
+{
+	PrintMdisError(info);
+	strncpy(res->fail, info, sizeof(res->fail) - 1);
+}
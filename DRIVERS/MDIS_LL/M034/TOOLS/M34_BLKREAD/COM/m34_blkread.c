@@ -36,6 +36,7 @@
 #include <MEN/usr_oss.h>
 #include <MEN/usr_utl.h>
 #include <MEN/mdis_api.h>
+#include <MEN/mdis_err.h>
 #include <MEN/m34_drv.h>
 
 static const char IdentString[]=MENT_XSTR(MAK_REVISION);
@@ -44,6 +45,7 @@ static const char IdentString[]=MENT_XSTR(MAK_REVISION);
 |   GLOBALS                             |
 +--------------------------------------*/
 static u_int32 G_SigCountBufHigh;	/* count of buffer highwater signals */
+static u_int32 G_SigCountData;		/* count of data ready signals */
 static u_int32 G_SigCountOthers;	/* count of other signals */
 
 /*--------------------------------------+
@@ -52,6 +54,7 @@ static u_int32 G_SigCountOthers;	/* count of other signals */
 static void usage(void);
 static void PrintMdisError(char *info);
 static void PrintUosError(char *info);
+static void SwapRaw(u_int8 *data, int32 size);
 static void __MAPILIB SigHandler(u_int32 sigCode);
 
 /********************************* usage ************************************
@@ -69,7 +72,7 @@ static void usage(void)
 	printf("Function: Configure and read M34/M35 channels (blockwise)       \n");
 	printf("Options:                                                        \n");
 	printf("    device       device name                          [none]    \n");
-	printf("    -r=<res>     resolution                           [none]    \n");
+	printf("    -r=<res>     resolution                           [from ID] \n");
 	printf("                   12 = 12-bit (for M34)                        \n");
 	printf("                   14 = 14-bit (for M35)                        \n");
 	printf("    _____________channel selection______________________________\n");
@@ -107,11 +110,33 @@ static void usage(void)
 	printf("                       enables/disables the module interrupt    \n");
 	printf("                   3 = Fix mode: read always all ch per irq     \n");
 	printf("                       (ignores ch selection and buffer config) \n");
+	printf("                   4 = Timer mode: same as mode 0 but frames    \n");
+	printf("                       are started by a driver timer            \n");
+	printf("                   5 = Burst mode: back-to-back conversions of  \n");
+	printf("                       the first selected ch (-b=0: polled)     \n");
+	printf("    -f=<hz>      frame rate for -i=4 (1..1000)        [desc]    \n");
+	printf("    -k=<n>       read-ahead blocks for -i=2 (0..64)   [desc]    \n");
+	printf("    -n=<n>       min frames per wakeup (0,1=off)      [desc]    \n");
+	printf("    -u=<usec>    max wakeup latency [usec] (0=none)   [desc]    \n");
+	printf("    -e=<k>       trigger lost after k periods for     [desc]    \n");
+	printf("                 -i=0/1 (0=off)                                 \n");
+	printf("    -j           adaptive switching between -i=0/1    [desc]    \n");
 	printf("    -s=<size>    block size to read in bytes          [128]     \n");
 	printf("                   -i=1/2: must be multiple of ch to read x2    \n");
 	printf("                   -i=3  : automatically set (-s= ignored)      \n");
 	printf("    -o=<msec>    block read timeout [msec] (0=none)   [0]       \n");
 	printf("    -h           install buffer highwater signal      [no]      \n");
+	printf("    -p           non-blocking read, wait for data     [no]      \n");
+	printf("                 ready signal while buffer is empty             \n");
+	printf("    -q           async slot mode (-i=0/1/4), reads    [no]      \n");
+	printf("                 one slot record per block read (-s= ignored)   \n");
+	printf("    -c=<src>,<ch>,<lvl>,<hyst>,<pre>,<post>                     \n");
+	printf("                 triggered capture (-i=0/1/4), reads  [no]      \n");
+	printf("                 one capture record per block read              \n");
+	printf("                   src 0/1 = EXT pin rising/falling edge        \n");
+	printf("                   src 2/3 = ch value rising/falling to lvl     \n");
+	printf("    -w           raw block read, byte swap done here  [no]      \n");
+	printf("                 (swapped driver variant only)                  \n");
 	printf("    _____________miscellaneous settings_________________________\n");
 	printf("    -l           loop mode                            [no]      \n");
 	printf("                                                                \n");
@@ -131,13 +156,21 @@ int main( int argc, char *argv[])
 {
 	MDIS_PATH	path=0;
 	int32       firstCh, lastCh, blkmode, blksize, tout, gainfac, irqCount;
-	int32   	res, gain, mode, disp, signal, loopmode, n, ch, chNbr, gotsize, irqMode, nosel;
+	int32   	res, gain, mode, disp, signal, loopmode, n, ch, chNbr, gotsize, irqMode, nosel, rate, rdAhead, batchFrames, batchLat, nonblk, async, nbrFree, capt, levelMax = 0, burstRate, rawRd, rawSwap = 0, trigK, trigPer, trigJit, adapt;
+	u_int32		sigCode;
 	u_int8	    *blkbuf = NULL;
 	u_int8	    *bp = NULL;
 	u_int8	    *bp0 = NULL;
 	u_int8	    *bmax = NULL;
+	u_int8	    *datap = NULL;
+	M34_ASYNC_HDR *hdrP;
+	M34_CAPT_HDR *captHdrP;
+	M34_CAPT_CFG captCfg;
+	int			captSrc, captCh, captLvl, captHyst, captPre, captPost;
 	char	    *device,*str,*errstr,buf[40];
 	double	    volt, curr;
+	M34_CH_CFG	chCfg[M34_SINGLE_ENDED_MAX_CH];
+	M_SETGETSTAT_BLOCK cfgBlk;
 #ifdef WINNT
 	int32       isrTime;
 #endif	
@@ -145,7 +178,7 @@ int main( int argc, char *argv[])
 	/*--------------------+
     |  check arguments    |
     +--------------------*/
-	if ((errstr = UTL_ILLIOPT("a=-r=z=b=i=s=o=g=m=t=d=hlx?", buf))) {	/* check args */
+	if ((errstr = UTL_ILLIOPT("a=-c=r=z=b=i=s=o=g=m=t=d=f=k=n=u=e=hjlpqwx?", buf))) {	/* check args */
 		printf("*** %s\n", errstr);
 		return(1);
 	}
@@ -179,12 +212,32 @@ int main( int argc, char *argv[])
 	gain     = ((str = UTL_TSTOPT("g=")) ? atoi(str) : 0);
 	mode     = ((str = UTL_TSTOPT("m=")) ? atoi(str) : 0);
 	disp     = ((str = UTL_TSTOPT("d=")) ? atoi(str) : 0);
+	rate     = ((str = UTL_TSTOPT("f=")) ? atoi(str) : 0);
+	rdAhead  = ((str = UTL_TSTOPT("k=")) ? atoi(str) : -1);
+	batchFrames = ((str = UTL_TSTOPT("n=")) ? atoi(str) : -1);
+	batchLat    = ((str = UTL_TSTOPT("u=")) ? atoi(str) : -1);
+	trigK       = ((str = UTL_TSTOPT("e=")) ? atoi(str) : -1);
+	adapt       = (UTL_TSTOPT("j") ? 1 : 0);
 	signal   = (UTL_TSTOPT("h") ? 1 : 0);
 	loopmode = (UTL_TSTOPT("l") ? 1 : 0);
+	nonblk   = (UTL_TSTOPT("p") ? 1 : 0);
+	async    = (UTL_TSTOPT("q") ? 1 : 0);
+	rawRd    = (UTL_TSTOPT("w") ? 1 : 0);
 	nosel    = (UTL_TSTOPT("x") ? 1 : 0);
+	capt     = 0;
+	if ((str = UTL_TSTOPT("c="))) {
+		if (sscanf(str, "%d,%d,%d,%d,%d,%d", &captSrc, &captCh, &captLvl,
+				   &captHyst, &captPre, &captPost) != 6 ||
+			captSrc < M34_CAPT_EXT_RISE || captSrc > M34_CAPT_LVL_FALL ||
+			captCh < 0 || captHyst < 0 || captPre < 0 || captPost < 0) {
+			printf("*** option -c= invalid\n");
+			return(1);
+		}
+		capt = 1;
+	}
 
 	/* check for option conflict */
-	if ( (res != 12) && (res != 14) ) {
+	if ( (res != 0) && (res != 12) && (res != 14) ) {
 		printf("\n*** option -r= must be 12 (for M34) or 14 (for M35)\n\n");
 		usage();
 		return(1);
@@ -202,8 +255,34 @@ int main( int argc, char *argv[])
 	}
 
 	/* check for valid irq mode */
-	if ((irqMode<0) || (irqMode>3)) {
-		printf("*** option -i=%d out of range (-d=0..3)\n", irqMode);
+	if ((irqMode<0) || (irqMode>M34_IMODE_BURST)) {
+		printf("*** option -i=%d out of range (-i=0..5)\n", irqMode);
+		return(1);
+	}
+
+	if (async && ((irqMode == M34_IMODE_CHIRQ_AUTO) || (irqMode == M34_IMODE_FIX) ||
+				  (irqMode == M34_IMODE_BURST))) {
+		printf("*** option -q not available with -i=%d\n", irqMode);
+		return(1);
+	}
+
+	if (capt && (async || (irqMode == M34_IMODE_CHIRQ_AUTO) ||
+				 (irqMode == M34_IMODE_FIX) || (irqMode == M34_IMODE_BURST))) {
+		printf("*** option -c= not available with -q or -i=%d\n", irqMode);
+		return(1);
+	}
+
+	/* check for valid frame rate */
+	if ((rate<0) || (rate>M34_SAMPLE_RATE_MAX)) {
+		printf("*** option -f=%d out of range (-f=1..%d)\n", rate,
+			   M34_SAMPLE_RATE_MAX);
+		return(1);
+	}
+
+	/* check for valid read-ahead */
+	if (rdAhead > M34_READ_AHEAD_MAX) {
+		printf("*** option -k=%d out of range (-k=0..%d)\n", rdAhead,
+			   M34_READ_AHEAD_MAX);
 		return(1);
 	}
 
@@ -226,8 +305,17 @@ int main( int argc, char *argv[])
 		}
 	}
 
+	if (nonblk) {
+		/* install data ready signal */
+		if (UOS_SigInstall(UOS_SIG_USR2)) {
+			PrintUosError("SigInstall");
+			goto abort;
+		}
+	}
+
 	/* clear signal counters */
 	G_SigCountBufHigh = 0;
+	G_SigCountData = 0;
 	G_SigCountOthers = 0;
 
 	/*--------------------+
@@ -238,6 +326,14 @@ int main( int argc, char *argv[])
 		return(1);
 	}
 
+	/* resolution from the module ID-PROM */
+	if (res == 0) {
+		if ((M_getstat(path, M34_RESOLUTION, &res)) < 0) {
+			PrintMdisError("getstat M34_RESOLUTION (use option -r=)");
+			goto abort;
+		}
+	}
+
 	/* get number of channels */
 	if ((M_getstat(path, M_LL_CH_NUMBER, &chNbr)) < 0) {
 		PrintMdisError("getstat M_LL_CH_NUMBER");
@@ -248,6 +344,22 @@ int main( int argc, char *argv[])
 	if (irqMode == M34_IMODE_FIX)
 		blksize = 2 * chNbr;
 
+	/* async slot mode: block size is one slot record */
+	if (async) {
+		if ((M_getstat(path, M34_ASYNC_RECSIZE, &blksize)) < 0) {
+			PrintMdisError("getstat M34_ASYNC_RECSIZE");
+			goto abort;
+		}
+		if (blksize == 0) {
+			printf("*** no async slots (descriptor key M34_ASYNC_SLOTS)\n");
+			goto abort;
+		}
+	}
+
+	/* capture mode: block size is one capture record (all channels max) */
+	if (capt)
+		blksize = sizeof(M34_CAPT_HDR) + 2 * chNbr * (captPre + 1 + captPost);
+
 	/*--------------------+
 	|  create buffer      |
 	+--------------------*/
@@ -276,47 +388,33 @@ int main( int argc, char *argv[])
 	if (lastCh == -1)
 		lastCh = chNbr - 1;
 
+	/* get current channel config table */
+	cfgBlk.size = chNbr * sizeof(M34_CH_CFG);
+	cfgBlk.data = (void*)chCfg;
+	if ((M_getstat(path, M34_BLK_CH_CFG, (int32*)&cfgBlk)) < 0) {
+		PrintMdisError("getstat M34_BLK_CH_CFG");
+		goto abort;
+	}
+
 	/* channel specific settings */
 	for (ch=0; ch<chNbr; ch++) { 
 
-		/* set current channel */
-		if ((M_setstat(path, M_MK_CH_CURRENT, ch)) < 0) {
-			PrintMdisError("setstat M_MK_CH_CURRENT");
-			goto abort;
-		}
-
 		/* set measuring mode */
-		if ((M_setstat(path, M34_CH_BIPOLAR, mode)) < 0) {
-			PrintMdisError("setstat M34_CH_BIPOLAR");
-			goto abort;
-		}
+		chCfg[ch].bipolar = (u_int8)mode;
 
 		/* check for SW gain */
-		if (gain != 4) {
-			/* set gain */
-			if ((M_setstat(path, M34_CH_GAIN, gain)) < 0) {
-				PrintMdisError("setstat M34_CH_GAIN");
-				goto abort;
-			}
-		}
+		if (gain != 4)
+			chCfg[ch].gain = (u_int8)gain;
 
 		/* channel selection */
-		if (!nosel) {
-			if ( (ch < firstCh) || (ch > lastCh) ) {
-				/* disable channel */
-				if ((M_setstat(path, M34_CH_RDBLK_IRQ, 0)) < 0) {
-					PrintMdisError("setstat M34_CH_RDBLK_IRQ");
-					goto abort;
-				}
-			}
-			else {
-				/* enable channel */
-				if ((M_setstat(path, M34_CH_RDBLK_IRQ, 1)) < 0) {
-					PrintMdisError("setstat M34_CH_RDBLK_IRQ");
-					goto abort;
-				}
-			}
-		}
+		if (!nosel)
+			chCfg[ch].rdBlkIrq = ((ch < firstCh) || (ch > lastCh)) ? 0 : 1;
+	}
+
+	/* apply complete table with one call */
+	if ((M_setstat(path, M34_BLK_CH_CFG, (INT32_OR_64)&cfgBlk)) < 0) {
+		PrintMdisError("setstat M34_BLK_CH_CFG");
+		goto abort;
 	}
 
 	if (signal) {
@@ -327,6 +425,30 @@ int main( int argc, char *argv[])
 		}
 	}
 
+	if (nonblk) {
+		/* non-blocking read with data ready signal */
+		if ((M_setstat(path, M34_RD_NONBLOCK, 1)) < 0) {
+			PrintMdisError("setstat M34_RD_NONBLOCK");
+			goto abort;
+		}
+		if ((M_setstat(path, M34_SIG_DATA_SET, UOS_SIG_USR2)) < 0) {
+			PrintMdisError("setstat M34_SIG_DATA_SET");
+			goto abort;
+		}
+	}
+
+	if (rawRd) {
+		/* raw bus words, swap them here if the driver variant is swapped */
+		if ((M_setstat(path, M34_RD_RAW, 1)) < 0) {
+			PrintMdisError("setstat M34_RD_RAW");
+			goto abort;
+		}
+		if ((M_getstat(path, M34_RAW_SWAPPED, &rawSwap)) < 0) {
+			PrintMdisError("getstat M34_RAW_SWAPPED");
+			goto abort;
+		}
+	}
+
     /*--------------------+
     |  print info         |
     +--------------------*/
@@ -360,7 +482,8 @@ int main( int argc, char *argv[])
     /*-------------------------------------+
     |  block mode with IRQ or fix irq mode |
     +-------------------------------------*/
-	if (blkmode || (irqMode == M34_IMODE_FIX)){
+	if (blkmode || (irqMode == M34_IMODE_FIX) || (irqMode == M34_IMODE_BURST) ||
+		async || capt){
 		if ((M_setstat(path, M_LL_IRQ_COUNT, 0)) < 0) {
 			PrintMdisError("setstat M_LL_IRQ_COUNT");
 			goto abort;
@@ -372,6 +495,95 @@ int main( int argc, char *argv[])
 			goto abort;
 		}
 
+		/* set frame rate of timer mode */
+		if (rate && (irqMode == M34_IMODE_TIMER)) {
+			if ((M_setstat(path, M34_SAMPLE_RATE, rate)) < 0) {
+				PrintMdisError("setstat M34_SAMPLE_RATE");
+				goto abort;
+			}
+			if ((M_getstat(path, M34_SAMPLE_RATE, &rate)) < 0) {
+				PrintMdisError("getstat M34_SAMPLE_RATE");
+				goto abort;
+			}
+			printf("timer mode frame rate: %d Hz\n", rate);
+		}
+
+		/* set read-ahead of one ch per irq mode with irq en/disable */
+		if ((rdAhead >= 0) && (irqMode == M34_IMODE_CHIRQ_AUTO)) {
+			if ((M_setstat(path, M34_READ_AHEAD, rdAhead)) < 0) {
+				PrintMdisError("setstat M34_READ_AHEAD");
+				goto abort;
+			}
+		}
+
+		/* async slot mode: enable and submit all slots */
+		if (async) {
+			if ((M_setstat(path, M34_ASYNC_ENABLE, 1)) < 0) {
+				PrintMdisError("setstat M34_ASYNC_ENABLE");
+				goto abort;
+			}
+			if ((M_getstat(path, M34_ASYNC_SUBMIT, &nbrFree)) < 0) {
+				PrintMdisError("getstat M34_ASYNC_SUBMIT");
+				goto abort;
+			}
+			if ((M_setstat(path, M34_ASYNC_SUBMIT, nbrFree)) < 0) {
+				PrintMdisError("setstat M34_ASYNC_SUBMIT");
+				goto abort;
+			}
+		}
+
+		/* capture mode: set trigger and arm */
+		if (capt) {
+			captCfg.source = (u_int8)captSrc;
+			captCfg.ch     = (u_int8)captCh;
+			captCfg.hyst   = (u_int16)captHyst;
+			captCfg.level  = captLvl;
+			captCfg.pre    = captPre;
+			captCfg.post   = captPost;
+			cfgBlk.size = sizeof(captCfg);
+			cfgBlk.data = (void*)&captCfg;
+			if ((M_setstat(path, M34_BLK_CAPT_CFG, (INT32_OR_64)&cfgBlk)) < 0) {
+				PrintMdisError("setstat M34_BLK_CAPT_CFG");
+				goto abort;
+			}
+			if ((M_setstat(path, M34_CAPT_ENABLE, 1)) < 0) {
+				PrintMdisError("setstat M34_CAPT_ENABLE");
+				goto abort;
+			}
+		}
+
+		/* set trigger loss detection */
+		if ((trigK >= 0) && ((irqMode == M34_IMODE_LEGACY) ||
+							 (irqMode == M34_IMODE_CHIRQ))) {
+			if ((M_setstat(path, M34_TRIG_LOST_K, trigK)) < 0) {
+				PrintMdisError("setstat M34_TRIG_LOST_K");
+				goto abort;
+			}
+		}
+
+		/* set adaptive irq mode */
+		if (adapt && ((irqMode == M34_IMODE_LEGACY) ||
+					  (irqMode == M34_IMODE_CHIRQ))) {
+			if ((M_setstat(path, M34_IRQ_ADAPT, 1)) < 0) {
+				PrintMdisError("setstat M34_IRQ_ADAPT");
+				goto abort;
+			}
+		}
+
+		/* set wakeup batching */
+		if (batchFrames >= 0) {
+			if ((M_setstat(path, M34_BATCH_FRAMES, batchFrames)) < 0) {
+				PrintMdisError("setstat M34_BATCH_FRAMES");
+				goto abort;
+			}
+		}
+		if (batchLat >= 0) {
+			if ((M_setstat(path, M34_BATCH_LATENCY, batchLat)) < 0) {
+				PrintMdisError("setstat M34_BATCH_LATENCY");
+				goto abort;
+			}
+		}
+
 		/*
 		 * irq mode M34_IMODE_LEGACY / M34_IMODE_CHIRQ:
 		 *  - Enable interrupt at carrier and M-Module (measurement starts here)
@@ -394,29 +606,88 @@ int main( int argc, char *argv[])
 		* irq mode M34_IMODE_CHIRQ_AUTO / M34_IMODE_FIX:
 		*  - Enable/disable interrupt at M-Module (measurement starts here)
 		*/
-		if ((gotsize = M_getblock(path,(u_int8*)blkbuf,blksize)) < 0) {
-			PrintMdisError("getblock");
+		if (nonblk) {
+			/* buffer empty: wait for the data ready signal */
+			while ((gotsize = M_getblock(path,(u_int8*)blkbuf,blksize)) == 0 &&
+				   UOS_KeyPressed() == -1)
+				UOS_SigWait(1000, &sigCode);
+		}
+		else
+			gotsize = M_getblock(path,(u_int8*)blkbuf,blksize);
+
+		if (gotsize < 0) {
+			/* adaptive irq mode switched: frame time base changed */
+			if (UOS_ErrnoGet() == M34_ERR_IRQ_ADAPT) {
+				printf("irq mode switched\n");
+				continue;
+			}
+			if (UOS_ErrnoGet() == M34_ERR_TRIG_LOST)
+				printf("*** trigger lost\n");
+			else
+				PrintMdisError("getblock");
 			break;
 		}
 
+		/* burst mode: achieved sample rate */
+		if (irqMode == M34_IMODE_BURST) {
+			if ((M_getstat(path, M34_BURST_RATE, &burstRate)) < 0) {
+				PrintMdisError("getstat M34_BURST_RATE");
+				break;
+			}
+			printf("burst sample rate: %d Hz\n", burstRate);
+		}
+
+		datap = blkbuf;
+
+		/* async slot record: header + data, resubmit the slot */
+		if (async && gotsize) {
+			hdrP = (M34_ASYNC_HDR*)blkbuf;
+			printf("slot seq=%d tstamp=0x%08x bytes=%d lost=%d\n",
+				   (int)hdrP->seq, (unsigned)hdrP->tstamp,
+				   (int)hdrP->bytes, (int)hdrP->lost);
+			datap   = blkbuf + sizeof(M34_ASYNC_HDR);
+			gotsize = hdrP->bytes;
+
+			if ((M_setstat(path, M34_ASYNC_SUBMIT, 1)) < 0) {
+				PrintMdisError("setstat M34_ASYNC_SUBMIT");
+				break;
+			}
+		}
+
+		/* capture record: header + frames */
+		if (capt && gotsize) {
+			captHdrP = (M34_CAPT_HDR*)blkbuf;
+			printf("capture seq=%d tstamp=0x%08x frames=%d trigpos=%d "
+				   "framewords=%d lost=%d\n",
+				   (int)captHdrP->seq, (unsigned)captHdrP->tstamp,
+				   (int)captHdrP->frames, (int)captHdrP->trigPos,
+				   (int)captHdrP->frameWords, (int)captHdrP->lost);
+			datap   = blkbuf + sizeof(M34_CAPT_HDR);
+			gotsize -= sizeof(M34_CAPT_HDR);
+		}
+
+		/* raw block read: convert to cpu byte order */
+		if (rawSwap)
+			SwapRaw(datap, gotsize);
+
 		/* raw hex value */
 		if (disp == 0) {
-				UTL_Memdump("raw hex value:",(char*)blkbuf,gotsize,2);
+				UTL_Memdump("raw hex value:",(char*)datap,gotsize,2);
 		}
 		/* voltage or current */
 		else {
-			bmax = blkbuf + gotsize;
+			bmax = datap + gotsize;
 
 			if (disp==1)
 				printf("voltage: (%ld bytes)\n",gotsize);
 			else
 				printf("current: (%ld bytes)\n",gotsize);
 			
-			for (bp=bp0=blkbuf; bp0<bmax; bp0+=16) {
+			for (bp=bp0=datap; bp0<bmax; bp0+=16) {
 #ifndef MENTYPS_64BIT
-				printf("%08x+%04x: ",(int32)blkbuf, (int16)(bp-blkbuf));
+				printf("%08x+%04x: ",(int32)datap, (int16)(bp-datap));
 #else
-				printf("%016llx+%08x: ",(int64)blkbuf, (int32)(bp-blkbuf));
+				printf("%016llx+%08x: ",(int64)datap, (int32)(bp-datap));
 #endif
 				
 				for (bp=bp0,n=0; n<16; n+=2, bp+=2) {	/* word aligned */
@@ -444,8 +715,9 @@ int main( int argc, char *argv[])
     +--------------------*/
 	abort:
 
-	/* block mode with IRQ or fix irq mode */
-	if (blkmode || (irqMode == M34_IMODE_FIX)) {
+	/* block mode with IRQ, fix/burst irq mode, async slot or capture mode */
+	if (blkmode || (irqMode == M34_IMODE_FIX) || (irqMode == M34_IMODE_BURST) ||
+		async || capt) {
 
 		/*
 		* Lagacy irq mode: - Disable interrupt at carrier and M-Module.
@@ -456,12 +728,51 @@ int main( int argc, char *argv[])
 			PrintMdisError("setstat M_MK_IRQ_ENABLE");
 		}
 
+		if (async && (M_setstat(path, M34_ASYNC_ENABLE, 0)) < 0)
+			PrintMdisError("setstat M34_ASYNC_ENABLE");
+
+		if (capt && (M_setstat(path, M34_CAPT_ENABLE, 0)) < 0)
+			PrintMdisError("setstat M34_CAPT_ENABLE");
+
 		if ((M_getstat(path, M_LL_IRQ_COUNT, &irqCount)) < 0)
 			PrintMdisError("getstat M_LL_IRQ_COUNT");
 
+		if ((M_getstat(path, M34_RD_LEVEL_MAX, &levelMax)) < 0)
+			PrintMdisError("getstat M34_RD_LEVEL_MAX");
+
 		printf("\n");
 		printf("irq mode                    : %d\n", irqMode);
 		printf("irq calls                   : %d\n", irqCount);
+		printf("max read buffer level       : %d bytes\n", levelMax);
+
+		/* externally triggered modes: trigger estimate */
+		if ((irqMode == M34_IMODE_LEGACY) || (irqMode == M34_IMODE_CHIRQ)) {
+			if ((M_getstat(path, M34_TRIG_PERIOD, &trigPer)) < 0 ||
+				(M_getstat(path, M34_TRIG_JITTER, &trigJit)) < 0)
+				PrintMdisError("getstat M34_TRIG_PERIOD/JITTER");
+			else {
+				printf("trigger period              : %dus\n", trigPer);
+				printf("trigger jitter              : %dus\n", trigJit);
+			}
+		}
+
+		/* adaptive irq mode: switches */
+		if (adapt) {
+			M_SETGETSTAT_BLOCK	blk;
+			M34_TELEMETRY		tele;
+
+			blk.size = sizeof(tele);
+			blk.data = (void*)&tele;
+			if ((M_getstat(path, M34_BLK_TELEMETRY, (int32*)&blk)) < 0)
+				PrintMdisError("getstat M34_BLK_TELEMETRY");
+			else {
+				printf("adaptive irq mode switches  : %d (last mode %d)\n",
+					   (int)tele.adaptSwitches, (int)tele.adaptMode);
+				printf("irq rate / isr load         : %dHz / %d%%\n",
+					   (int)tele.adaptIrqRate, (int)tele.adaptIsrLoad);
+			}
+			M_setstat(path, M34_IRQ_ADAPT, 0);
+		}
 
 #ifdef WINNT
 		if ((M_getstat(path, M34_ISR_TIME, &isrTime)) < 0)
@@ -475,10 +786,18 @@ int main( int argc, char *argv[])
 
 	}
 
+	/* remove data ready signal */
+	if (nonblk && path > 0)
+		M_setstat(path, M34_SIG_DATA_CLR, 0);
+
+	if (rawRd && path > 0)
+		M_setstat(path, M34_RD_RAW, 0);
+
 	/* terminate signal handling */
 	UOS_SigExit();
 	printf("\n");
 	printf("Count of buffer highwater signals : %d \n", G_SigCountBufHigh);
+	printf("Count of data ready signals       : %d \n", G_SigCountData);
 	printf("Count of other signals            : %d \n", G_SigCountOthers);
 
 	if (M_close(path) < 0)
@@ -515,6 +834,38 @@ static void PrintUosError(char *info)
 	printf("*** can't %s: %s\n", info, UOS_ErrString(UOS_ErrnoGet()));
 }
 
+/********************************* SwapRaw **********************************
+ *
+ *  Description: Swap the bytes of raw block read words (M34_RD_RAW),
+ *               two words per 32-bit access
+ *			   
+ *---------------------------------------------------------------------------
+ *  Input......: data	read data (16-bit aligned)
+ *               size	byte size of data
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void SwapRaw(u_int8 *data, int32 size)
+{
+	u_int16	*wP = (u_int16*)data;
+	u_int32	*dP;
+	int32	n = size / 2;
+
+	if (n && ((U_INT32_OR_64)wP & 2)) {		/* align to 32 bit */
+		*wP = (u_int16)((*wP >> 8) | (*wP << 8));
+		wP++;
+		n--;
+	}
+
+	for (dP = (u_int32*)wP; n >= 2; n -= 2, dP++)
+		*dP = M34_SWAP16X2(*dP);
+
+	if (n) {								/* odd word left */
+		wP  = (u_int16*)dP;
+		*wP = (u_int16)((*wP >> 8) | (*wP << 8));
+	}
+}
+
 /********************************* SigHandler *******************************
  *
  *  Description: Signal handler
@@ -528,6 +879,8 @@ static void __MAPILIB SigHandler(u_int32 sigCode)
 {
 	if ( sigCode == UOS_SIG_USR1)
 		G_SigCountBufHigh++;
+	else if ( sigCode == UOS_SIG_USR2)
+		G_SigCountData++;
 	else
 		G_SigCountOthers++;
 }
@@ -0,0 +1,765 @@
+/****************************************************************************
+ ************                                                    ************
+ ************                  M 3 4 _ L A T                     ************
+ ************                                                    ************
+ ****************************************************************************
+ *
+ *       Author: ds
+ *
+ *  Description: Trigger-to-application latency of M34/M35 block reads
+ *
+ *               The tool sets M34_LAT_SAMPLE, starts the acquisition and
+ *               reads blocks. Right after each block read it gets the
+ *               driver timestamp (M34_LAT_TSTAMP) as application stamp.
+ *               The latency records of the sampled frames (M34_BLK_LAT)
+ *               are matched with it by block read number and the
+ *               percentiles of each stage are printed:
+ *
+ *                 isr      isr entry of the frame start -> frame converted
+ *                 publish  -> frame ready in the read buffer
+ *                 wakeup   -> block read got it from MBUF_Read (wait, copy)
+ *                 return   -> M34_BlockRead returns
+ *                 app      -> application after M_getblock()
+ *                 total    isr entry -> application
+ *
+ *               The time from the trigger edge to the isr entry is not
+ *               visible to the driver.
+ *
+ *               With -m the same stages are run in user space against
+ *               the register model (m34_model.h): a thread converts the
+ *               frames at the model frame rate into a ring buffer, the
+ *               main thread reads it like the block read does. This is a
+ *               pthread simulation of the stages, the latency code of
+ *               the driver is not run.
+ *
+ *     Required: Libraries: mdis_api, usr_oss, usr_utl (-m: pthread)
+ *     Switches: LINUX
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 2026, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef LINUX
+# include <time.h>
+# include <pthread.h>
+#endif
+#include <MEN/men_typs.h>
+#include <MEN/usr_oss.h>
+#include <MEN/usr_utl.h>
+#include <MEN/mdis_api.h>
+#include <MEN/mdis_err.h>
+#include <MEN/m34_drv.h>
+
+/* scan sequence on the register model */
+#define M34_SCAN_MA					M34_MODEL*
+#define M34_SCAN_RD(ma,offs)		M34_ModelRd(ma,offs)
+#define M34_SCAN_WR(ma,offs,val)	M34_ModelWr(ma,offs,val)
+#include <MEN/m34_scan.h>
+#include <MEN/m34_model.h>
+
+static const char IdentString[]=MENT_XSTR(MAK_REVISION);
+
+/*--------------------------------------+
+|   DEFINES                             |
++--------------------------------------*/
+#define MAX_CH		M34_SINGLE_ENDED_MAX_CH
+#define MAX_RECS	64			/* records per M34_BLK_LAT */
+#define FETCH_READS	16			/* get records every n block reads */
+#define NBR_STAGES	6
+#define MODEL_FRAMES 256		/* model read buffer [frames] */
+
+/*--------------------------------------+
+|   TYPDEFS                             |
++--------------------------------------*/
+#ifdef LINUX
+/*
+ * register model pipeline, the stages of the driver read buffer path
+ * (see latFrame/latReady/latRead/latDone in the driver)
+ */
+typedef struct {
+	pthread_mutex_t	lock;
+	pthread_cond_t	cond;		/* frame ready */
+	pthread_t		thread;		/* frame conversion ("isr") */
+	int				run;
+	M34_MODEL		model;		/* registers */
+	u_int32			nbrCh;		/* channels per frame */
+	u_int32			nbrDummy;	/* dummy reads per channel */
+	u_int32			periodUs;	/* frame period [us] */
+	u_int16			*ring;		/* read buffer */
+	u_int32			ringWords;
+	u_int32			wr, rd, avail;
+	u_int32			lost;		/* frames lost (buffer full) */
+	u_int32			sample;		/* sample every n-th frame */
+	u_int32			frames;		/* frames since start */
+	u_int32			state;		/* 0=idle, 1=ready, 2=copied */
+	u_int32			ahead;		/* words to read before the sample */
+	u_int32			rdSeq;		/* block reads since start */
+	M34_LAT_REC		rec;		/* sample in flight */
+	M34_LAT_REC		recs[MAX_RECS];
+	u_int32			nbrRecs;
+} MODEL_PIPE;
+#endif
+
+/*--------------------------------------+
+|   GLOBALS                             |
++--------------------------------------*/
+static const char *G_StageName[NBR_STAGES] = {
+	"isr", "publish", "wakeup", "return", "app", "total"
+};
+
+static double	*G_Lat[NBR_STAGES];	/* stage latencies [us or ticks] */
+static u_int32	G_NbrLat;
+#ifdef LINUX
+static MODEL_PIPE	*G_Pipe;		/* register model (-m) */
+static double		G_T0;			/* model time base */
+#endif
+
+/*--------------------------------------+
+|   PROTOTYPES                          |
++--------------------------------------*/
+static void usage(void);
+static void PrintMdisError(char *info);
+static int32 GetRecs(MDIS_PATH path, M34_LAT_REC *recs, u_int32 *appTs,
+					 u_int32 nbrReads, double unit);
+static void AddRec(M34_LAT_REC *recP, u_int32 tApp, double unit);
+static void PrintStages(const char *unitStr);
+static int CmpDouble(const void *a, const void *b);
+#ifdef LINUX
+static u_int32 ModelTs(void);
+static void *ModelThread(void *arg);
+static int32 ModelStart(u_int32 nbrCh, u_int32 settle, u_int32 nbrDummy,
+						u_int32 rate, u_int32 sample);
+static void ModelStop(void);
+static int32 ModelRead(u_int16 *buf, u_int32 words);
+#endif
+
+/********************************* usage ************************************
+ *
+ *  Description: Print program usage
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void usage(void)
+{
+	printf("Usage: m34_lat [<opts>] <device> [<opts>]\n");
+	printf("Function: Trigger-to-application latency per stage\n");
+	printf("          of M34/M35 block reads\n");
+	printf("Options:\n");
+	printf("    device       device name (not with -m)        [none]\n");
+	printf("    -i=<mode>    irq mode 0/1/2/4                 [desc]\n");
+	printf("    -s=<n>       trace every n-th frame           [10]\n");
+	printf("    -n=<nbr>     number of block reads            [1000]\n");
+	printf("    -b=<size>    block size [byte]                [one frame]\n");
+	printf("    -m=<settle>  run against the register model,\n");
+	printf("                 input settles after <settle> conv. [no]\n");
+	printf("                 (user space simulation, the driver\n");
+	printf("                 latency code is not run)\n");
+	printf("    -c=<nbr>     model: number of channels        [16]\n");
+	printf("    -d=<nbr>     model: dummy reads per channel   [0]\n");
+	printf("    -f=<hz>      model: frame rate                [1000]\n");
+	printf("    -v           print each record                [no]\n");
+	printf("\n");
+	printf("Copyright 2026, MEN Mikro Elektronik GmbH\n%s\n", IdentString);
+}
+
+/********************************* main *************************************
+ *
+ *  Description: Program main function
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: argc,argv	argument counter, data ..
+ *  Output.....: return	    success (0) or error (1)
+ *  Globals....: -
+ ****************************************************************************/
+int main(int argc, char *argv[])
+{
+	MDIS_PATH			path=0;
+	int32				n, chNbr, irqMode=-1, freq=0, settle=-1, verbose;
+	int32				size, started=0, ret = 1;
+	u_int32				ch, nbrCh=0, nbrDummy, rate, sample, nbrReads, rd;
+	u_int32				*appTs=NULL;
+	char				*device, *str, *errstr, *unitStr, buf[40];
+	double				unit;
+	u_int16				*data=NULL;
+	M_SETGETSTAT_BLOCK	blk;
+	M34_CH_CFG			chCfg[MAX_CH];
+	M34_LAT_REC			recs[MAX_RECS];
+
+	/*--------------------+
+    |  check arguments    |
+    +--------------------*/
+	if ((errstr = UTL_ILLIOPT("i=s=n=b=m=c=d=f=v?", buf))) {	/* check args */
+		printf("*** %s\n", errstr);
+		return(1);
+	}
+
+	if (UTL_TSTOPT("?")) {						/* help requested ? */
+		usage();
+		return(1);
+	}
+
+	/*--------------------+
+    |  get arguments      |
+    +--------------------*/
+	for (device=NULL, n=1; n<argc; n++)
+		if (*argv[n] != '-') {
+			device = argv[n];
+			break;
+		}
+
+	irqMode  = ((str = UTL_TSTOPT("i=")) ? atoi(str) : -1);
+	sample   = ((str = UTL_TSTOPT("s=")) ? atoi(str) : 10);
+	nbrReads = ((str = UTL_TSTOPT("n=")) ? atoi(str) : 1000);
+	size     = ((str = UTL_TSTOPT("b=")) ? atoi(str) : 0);
+	settle   = ((str = UTL_TSTOPT("m=")) ? atoi(str) : -1);
+	verbose  = (UTL_TSTOPT("v") ? 1 : 0);
+
+	if (((settle >= 0) == (device != NULL)) || sample == 0 ||
+		nbrReads == 0 || size < 0) {
+		usage();
+		return(1);
+	}
+
+	if ((appTs = (u_int32*)calloc(nbrReads, sizeof(u_int32))) == NULL) {
+		printf("*** can't alloc memory\n");
+		return(1);
+	}
+	for (n=0; n<NBR_STAGES; n++)
+		if ((G_Lat[n] = (double*)calloc(nbrReads, sizeof(double))) == NULL) {
+			printf("*** can't alloc memory\n");
+			goto abort;
+		}
+
+	/*--------------------+
+    |  register model     |
+    +--------------------*/
+	if (settle >= 0) {
+#ifdef LINUX
+		nbrCh    = ((str = UTL_TSTOPT("c=")) ? atoi(str) : MAX_CH);
+		nbrDummy = ((str = UTL_TSTOPT("d=")) ? atoi(str) : 0);
+		rate     = ((str = UTL_TSTOPT("f=")) ? atoi(str) : 1000);
+		if (nbrCh < 1 || nbrCh > MAX_CH || rate < 1 || rate > 1000000) {
+			usage();
+			goto abort;
+		}
+		if (ModelStart(nbrCh, settle, nbrDummy, rate, sample))
+			goto abort;
+		started = 1;
+		freq    = 1000000;
+#else
+		printf("*** register model not supported on this OS\n");
+		goto abort;
+#endif
+	}
+	/*--------------------+
+    |  device             |
+    +--------------------*/
+	else {
+		if ((path = M_open(device)) < 0) {
+			PrintMdisError("open");
+			goto abort;
+		}
+
+		if (irqMode >= 0 && (M_setstat(path, M34_IRQ_MODE, irqMode)) < 0) {
+			PrintMdisError("setstat M34_IRQ_MODE");
+			goto abort;
+		}
+		if ((M_getstat(path, M34_IRQ_MODE, &irqMode)) < 0) {
+			PrintMdisError("getstat M34_IRQ_MODE");
+			goto abort;
+		}
+		if (irqMode == M34_IMODE_FIX || irqMode == M34_IMODE_BURST) {
+			printf("*** irq mode %d has no read buffer\n", (int)irqMode);
+			goto abort;
+		}
+
+		/* frame size */
+		if ((M_getstat(path, M_LL_CH_NUMBER, &chNbr)) < 0) {
+			PrintMdisError("getstat M_LL_CH_NUMBER");
+			goto abort;
+		}
+		blk.size = chNbr * sizeof(M34_CH_CFG);
+		blk.data = (void*)chCfg;
+		if ((M_getstat(path, M34_BLK_CH_CFG, (int32*)&blk)) < 0) {
+			PrintMdisError("getstat M34_BLK_CH_CFG");
+			goto abort;
+		}
+		for (ch=0; ch<(u_int32)chNbr; ch++)
+			nbrCh += chCfg[ch].rdBlkIrq;
+		if (nbrCh == 0) {
+			printf("*** no channel configured for block read\n");
+			goto abort;
+		}
+
+		if ((M_getstat(path, M34_TRACE_TSFREQ, &freq)) < 0) {
+			PrintMdisError("getstat M34_TRACE_TSFREQ");
+			goto abort;
+		}
+		if (freq < M34_LAT_TSFREQ_MIN) {
+			printf("*** driver timestamp %d Hz too coarse for the stages "
+				   "(min %d Hz)\n", (int)freq, M34_LAT_TSFREQ_MIN);
+			goto abort;
+		}
+
+		/* restarts the frame and block read count */
+		if ((M_setstat(path, M34_LAT_SAMPLE, sample)) < 0) {
+			PrintMdisError("setstat M34_LAT_SAMPLE");
+			goto abort;
+		}
+
+		/* irq mode 2 enables the irq per block read */
+		if (irqMode != M34_IMODE_CHIRQ_AUTO &&
+			(M_setstat(path, M_MK_IRQ_ENABLE, 1)) < 0) {
+			PrintMdisError("setstat M_MK_IRQ_ENABLE");
+			goto abort;
+		}
+		started = 1;
+	}
+
+	if (size == 0)
+		size = nbrCh * 2;
+	if ((data = (u_int16*)malloc(size)) == NULL) {
+		printf("*** can't alloc memory\n");
+		goto abort;
+	}
+
+	unit    = freq ? 1000000.0 / freq : 1.0;
+	unitStr = freq ? "us" : "ticks";
+
+	printf("channels: %d, block size: %d, every %d. frame, %s\n",
+		   (int)nbrCh, (int)size, (int)sample,
+		   settle >= 0 ? "register model" : "device");
+
+	/*--------------------+
+    |  read blocks        |
+    +--------------------*/
+	for (rd=0; rd<nbrReads; rd++) {
+#ifdef LINUX
+		if (G_Pipe) {
+			ModelRead(data, size / 2);
+			appTs[rd] = ModelTs();
+		}
+		else
+#endif
+		{
+			/* adaptive irq mode switched: counted read, no data */
+			if ((M_getblock(path, (u_int8*)data, size)) < 0) {
+				if (UOS_ErrnoGet() != M34_ERR_IRQ_ADAPT) {
+					PrintMdisError("getblock");
+					goto abort;
+				}
+				printf("irq mode switched (read %d)\n", (int)rd + 1);
+			}
+			if ((M_getstat(path, M34_LAT_TSTAMP, (int32*)&appTs[rd])) < 0) {
+				PrintMdisError("getstat M34_LAT_TSTAMP");
+				goto abort;
+			}
+		}
+
+		if ((rd + 1) % FETCH_READS == 0 &&
+			GetRecs(path, recs, appTs, rd + 1, unit) < 0)
+			goto abort;
+	}
+
+	/* records of the last reads */
+	if (GetRecs(path, recs, appTs, nbrReads, unit) < 0)
+		goto abort;
+
+	if (verbose)
+		for (n=0; n<(int32)G_NbrLat; n++)
+			printf("%5d: %10.1f %10.1f %10.1f %10.1f %10.1f  total %10.1f\n",
+				   (int)n, G_Lat[0][n], G_Lat[1][n], G_Lat[2][n],
+				   G_Lat[3][n], G_Lat[4][n], G_Lat[5][n]);
+
+	PrintStages(unitStr);
+	ret = 0;
+
+	/*--------------------+
+    |  cleanup            |
+    +--------------------*/
+	abort:
+#ifdef LINUX
+	if (G_Pipe) {
+		printf("model frames lost (buffer full): %d\n", (int)G_Pipe->lost);
+		ModelStop();
+	}
+#endif
+	if (path > 0) {
+		if (started && (M_setstat(path, M_MK_IRQ_ENABLE, 0)) < 0)
+			PrintMdisError("setstat M_MK_IRQ_ENABLE");
+		if ((M_setstat(path, M34_LAT_SAMPLE, 0)) < 0)
+			PrintMdisError("setstat M34_LAT_SAMPLE");
+		if (M_close(path) < 0)
+			PrintMdisError("close");
+	}
+
+	for (n=0; n<NBR_STAGES; n++)
+		free(G_Lat[n]);
+	free(appTs);
+	free(data);
+
+	return(ret);
+}
+
+/********************************* GetRecs **********************************
+ *
+ *  Description: Get the completed latency records and add the ones of
+ *               the block reads done so far
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: path		device path (0=register model)
+ *               recs		record buffer (MAX_RECS)
+ *               appTs		application stamps per block read
+ *               nbrReads	block reads done
+ *               unit		us per timestamp tick
+ *  Output.....: return		number of records | -1
+ *  Globals....: G_Pipe
+ ****************************************************************************/
+static int32 GetRecs(MDIS_PATH path, M34_LAT_REC *recs, u_int32 *appTs,
+					 u_int32 nbrReads, double unit)
+{
+	M_SETGETSTAT_BLOCK	blk;
+	int32				n, nbrRecs;
+
+#ifdef LINUX
+	if (G_Pipe) {
+		pthread_mutex_lock(&G_Pipe->lock);
+		nbrRecs = G_Pipe->nbrRecs;
+		memcpy(recs, G_Pipe->recs, nbrRecs * sizeof(M34_LAT_REC));
+		G_Pipe->nbrRecs = 0;
+		pthread_mutex_unlock(&G_Pipe->lock);
+	}
+	else
+#endif
+	{
+		blk.size = MAX_RECS * sizeof(M34_LAT_REC);
+		blk.data = (void*)recs;
+		if ((M_getstat(path, M34_BLK_LAT, (int32*)&blk)) < 0) {
+			PrintMdisError("getstat M34_BLK_LAT");
+			return( -1 );
+		}
+		nbrRecs = blk.size / sizeof(M34_LAT_REC);
+	}
+
+	/* records of unknown reads (other process) are skipped */
+	for (n=0; n<nbrRecs; n++)
+		if (recs[n].rdSeq >= 1 && recs[n].rdSeq <= nbrReads)
+			AddRec(&recs[n], appTs[recs[n].rdSeq - 1], unit);
+
+	return( nbrRecs );
+}
+
+/********************************* AddRec ***********************************
+ *
+ *  Description: Add the stage latencies of a record
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: recP		latency record
+ *               tApp		application stamp
+ *               unit		us per timestamp tick
+ *  Output.....: -
+ *  Globals....: G_Lat, G_NbrLat
+ ****************************************************************************/
+static void AddRec(M34_LAT_REC *recP, u_int32 tApp, double unit)
+{
+	G_Lat[0][G_NbrLat] = (u_int32)(recP->tFrame - recP->tIsr) * unit;
+	G_Lat[1][G_NbrLat] = (u_int32)(recP->tReady - recP->tFrame) * unit;
+	G_Lat[2][G_NbrLat] = (u_int32)(recP->tWake - recP->tReady) * unit;
+	G_Lat[3][G_NbrLat] = (u_int32)(recP->tRet - recP->tWake) * unit;
+	G_Lat[4][G_NbrLat] = (u_int32)(tApp - recP->tRet) * unit;
+	G_Lat[5][G_NbrLat] = (u_int32)(tApp - recP->tIsr) * unit;
+	G_NbrLat++;
+}
+
+/********************************* PrintStages ******************************
+ *
+ *  Description: Print the percentiles of each stage
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: unitStr	time unit
+ *  Output.....: -
+ *  Globals....: G_Lat, G_NbrLat, G_StageName
+ ****************************************************************************/
+static void PrintStages(const char *unitStr)
+{
+	u_int32	n, last;
+	double	*latP;
+
+	printf("\nsampled frames: %d\n", (int)G_NbrLat);
+	if (G_NbrLat == 0)
+		return;
+
+	last = G_NbrLat - 1;
+	printf("stage [%s]       min        p50        p90        p99        max\n",
+		   unitStr);
+
+	for (n=0; n<NBR_STAGES; n++) {
+		latP = G_Lat[n];
+		qsort(latP, G_NbrLat, sizeof(double), CmpDouble);
+		printf("%-10s %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+			   G_StageName[n], latP[0], latP[last / 2],
+			   latP[last * 90 / 100], latP[last * 99 / 100], latP[last]);
+	}
+}
+
+/********************************* CmpDouble ********************************
+ *
+ *  Description: qsort compare function
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: a, b		values
+ *  Output.....: return		<0, 0, >0
+ *  Globals....: -
+ ****************************************************************************/
+static int CmpDouble(const void *a, const void *b)
+{
+	double	da = *(const double*)a, db = *(const double*)b;
+
+	return( da < db ? -1 : da > db ? 1 : 0 );
+}
+
+#ifdef LINUX
+/********************************* ModelTs **********************************
+ *
+ *  Description: Register model timestamp
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: return		time since start [us]
+ *  Globals....: G_T0
+ ****************************************************************************/
+static u_int32 ModelTs(void)
+{
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return( (u_int32)(ts.tv_sec * 1000000.0 + ts.tv_nsec / 1000.0 - G_T0) );
+}
+
+/********************************* ModelThread ******************************
+ *
+ *  Description: Register model: converts one frame per period into the
+ *               read buffer (the isr of the driver)
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: arg		MODEL_PIPE
+ *  Output.....: return		NULL
+ *  Globals....: -
+ ****************************************************************************/
+static void *ModelThread(void *arg)
+{
+	MODEL_PIPE		*p = (MODEL_PIPE*)arg;
+	struct timespec	next;
+	u_int16			frame[MAX_CH];
+	u_int32			ch, tIsr, tFrame;
+
+	clock_gettime(CLOCK_MONOTONIC, &next);
+
+	while (p->run) {
+		next.tv_nsec += p->periodUs * 1000;
+		while (next.tv_nsec >= 1000000000) {
+			next.tv_nsec -= 1000000000;
+			next.tv_sec++;
+		}
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+
+		/* "isr": scan the frame */
+		tIsr = ModelTs();
+		for (ch=0; ch<p->nbrCh; ch++) {
+			M34_SCAN_SETTLE(&p->model, M34_CTRL_WORD(ch, 0, 0), p->nbrDummy);
+			frame[ch] = M34_SCAN_CONV(&p->model);
+		}
+		tFrame = ModelTs();
+
+		/* publish */
+		pthread_mutex_lock(&p->lock);
+		if (p->avail + p->nbrCh > p->ringWords) {
+			p->lost++;
+			pthread_mutex_unlock(&p->lock);
+			continue;
+		}
+		for (ch=0; ch<p->nbrCh; ch++) {
+			p->ring[p->wr] = frame[ch];
+			p->wr = (p->wr + 1) % p->ringWords;
+		}
+
+		if (++p->frames % p->sample == 0 && p->state == 0) {
+			p->rec.frame  = p->frames;
+			p->rec.tIsr   = tIsr;
+			p->rec.tFrame = tFrame;
+			p->rec.tReady = ModelTs();
+			p->ahead      = p->avail;
+			p->state      = 1;
+		}
+		p->avail += p->nbrCh;
+
+		pthread_cond_signal(&p->cond);
+		pthread_mutex_unlock(&p->lock);
+	}
+
+	return( NULL );
+}
+
+/********************************* ModelStart *******************************
+ *
+ *  Description: Register model: create and start the pipeline
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: nbrCh		channels per frame
+ *               settle		conversions until the input settled
+ *               nbrDummy	dummy reads per channel
+ *               rate		frame rate [Hz]
+ *               sample		sample every n-th frame
+ *  Output.....: return		0 | -1
+ *  Globals....: G_Pipe, G_T0
+ ****************************************************************************/
+static int32 ModelStart(u_int32 nbrCh, u_int32 settle, u_int32 nbrDummy,
+						u_int32 rate, u_int32 sample)
+{
+	MODEL_PIPE		*p;
+	struct timespec	ts;
+
+	if ((p = (MODEL_PIPE*)calloc(1, sizeof(MODEL_PIPE))) == NULL ||
+		(p->ring = (u_int16*)calloc(MODEL_FRAMES * nbrCh,
+									sizeof(u_int16))) == NULL) {
+		printf("*** can't alloc memory\n");
+		free(p);
+		return( -1 );
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	G_T0 = ts.tv_sec * 1000000.0 + ts.tv_nsec / 1000.0;
+
+	p->model.settle = settle;
+	p->nbrCh     = nbrCh;
+	p->nbrDummy  = nbrDummy;
+	p->periodUs  = 1000000 / rate;
+	p->ringWords = MODEL_FRAMES * nbrCh;
+	p->sample    = sample;
+	p->run       = 1;
+	pthread_mutex_init(&p->lock, NULL);
+	pthread_cond_init(&p->cond, NULL);
+
+	if (pthread_create(&p->thread, NULL, ModelThread, p)) {
+		printf("*** can't create model thread\n");
+		free(p->ring);
+		free(p);
+		return( -1 );
+	}
+
+	G_Pipe = p;
+	return( 0 );
+}
+
+/********************************* ModelStop ********************************
+ *
+ *  Description: Register model: stop and free the pipeline
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: -
+ *  Globals....: G_Pipe
+ ****************************************************************************/
+static void ModelStop(void)
+{
+	G_Pipe->run = 0;
+	pthread_join(G_Pipe->thread, NULL);
+	pthread_cond_destroy(&G_Pipe->cond);
+	pthread_mutex_destroy(&G_Pipe->lock);
+	free(G_Pipe->ring);
+	free(G_Pipe);
+	G_Pipe = NULL;
+}
+
+/********************************* ModelRead ********************************
+ *
+ *  Description: Register model: blocking read of words from the read
+ *               buffer (the block read of the driver)
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: buf		data buffer
+ *               words		words to read (max buffer size)
+ *  Output.....: return		read words
+ *  Globals....: G_Pipe
+ ****************************************************************************/
+static int32 ModelRead(u_int16 *buf, u_int32 words)
+{
+	MODEL_PIPE	*p = G_Pipe;
+	u_int32		n, copied;
+
+	if (words > p->ringWords)
+		words = p->ringWords;
+
+	pthread_mutex_lock(&p->lock);
+	p->rdSeq++;
+
+	while (p->avail < words)
+		pthread_cond_wait(&p->cond, &p->lock);
+
+	for (n=0; n<words; n++) {
+		buf[n] = p->ring[p->rd];
+		p->rd = (p->rd + 1) % p->ringWords;
+	}
+	p->avail -= words;
+
+	if (p->state == 1) {
+		if (words > p->ahead) {
+			p->rec.tWake = ModelTs();
+			p->state     = 2;
+		}
+		else
+			p->ahead -= words;
+	}
+	/* state is shared with the model thread: test it under the lock */
+	copied = (p->state == 2);
+	pthread_mutex_unlock(&p->lock);
+
+	if (copied) {
+		p->rec.tRet  = ModelTs();
+		p->rec.rdSeq = p->rdSeq;
+
+		pthread_mutex_lock(&p->lock);
+		if (p->nbrRecs < MAX_RECS)
+			p->recs[p->nbrRecs++] = p->rec;
+		p->state = 0;
+		pthread_mutex_unlock(&p->lock);
+	}
+
+	return( (int32)words );
+}
+#endif /* LINUX */
+
+/********************************* PrintMdisError ***************************
+ *
+ *  Description: Print MDIS error message
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: info	info string
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+
+static void PrintMdisError(char *info)
+{
+	printf("*** can't %s: %s\n", info, M_errstring(UOS_ErrnoGet()));
+}
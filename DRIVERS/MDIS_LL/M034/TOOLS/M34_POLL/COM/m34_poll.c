@@ -0,0 +1,502 @@
+/****************************************************************************
+ ************                                                    ************
+ ************                 M 3 4 _ P O L L                    ************
+ ************                                                    ************
+ ****************************************************************************
+ *
+ *       Author: ds
+ *
+ *  Description: Busy-poll acquisition of M34/M35 channels from user space
+ *
+ *               The tool takes the channel setup from the driver, gets
+ *               the registers with M34_POLL_OWNER and scans the block
+ *               read channels in a busy loop with the module irq disabled
+ *               (M_MK_IRQ_ENABLE 0), using the scan sequence of the
+ *               driver (m34_scan.h). CPU irqs and scheduling are not
+ *               touched, the loop may be preempted. Consecutive
+ *               channels with equal gain/polarity use the auto-increment
+ *               conversion instead of a control write.
+ *
+ *               The register window (M34_ADDRSPACE_SIZE byte at the
+ *               physical M-Module A08 address) is mapped via /dev/mem.
+ *               With -m the scan runs against a register model instead
+ *               and every value is checked (no device needed).
+ *
+ *               SIGINT/SIGTERM end the scan, M34_POLL_OWNER is released
+ *               and the window unmapped as at the normal end.
+ *
+ *     Required: Libraries: mdis_api, usr_oss, usr_utl
+ *     Switches: LINUX
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 2026, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#ifdef LINUX
+# include <fcntl.h>
+# include <unistd.h>
+# include <time.h>
+# include <sys/mman.h>
+#endif
+#include <MEN/men_typs.h>
+#include <MEN/usr_oss.h>
+#include <MEN/usr_utl.h>
+#include <MEN/mdis_api.h>
+#include <MEN/m34_drv.h>
+
+/* scan sequence on the mapped window or the register model */
+#define M34_SCAN_MA					u_int8*
+#define M34_SCAN_RD(ma,offs)		RegRd(ma,offs)
+#define M34_SCAN_WR(ma,offs,val)	RegWr(ma,offs,val)
+#include <MEN/m34_scan.h>
+#include <MEN/m34_model.h>
+
+static const char IdentString[]=MENT_XSTR(MAK_REVISION);
+
+/*--------------------------------------+
+|   DEFINES                             |
++--------------------------------------*/
+#define MAX_CH		M34_SINGLE_ENDED_MAX_CH
+
+/*--------------------------------------+
+|   TYPDEFS                             |
++--------------------------------------*/
+/* scan list entry */
+typedef struct {
+	u_int16	ctrl;		/* control word */
+	u_int16	noCtrl;		/* ch selected by increment of previous entry */
+	u_int16	inc;		/* convert with auto-increment */
+	u_int32	nbrDummy;	/* dummy reads (M34_DUMMY_READS + settle) */
+} SCAN_ENTRY;
+
+/*--------------------------------------+
+|   GLOBALS                             |
++--------------------------------------*/
+static M34_MODEL	*G_Model;		/* register model (m34_model.h) */
+static volatile sig_atomic_t G_Stop;	/* SIGINT/SIGTERM: end the scan */
+
+/*--------------------------------------+
+|   PROTOTYPES                          |
++--------------------------------------*/
+static void usage(void);
+static void PrintMdisError(char *info);
+static u_int16 RegRd(u_int8 *ma, u_int32 offs);
+static void RegWr(u_int8 *ma, u_int32 offs, u_int16 val);
+static u_int32 ScanSetup(SCAN_ENTRY *scan, M34_CH_CFG *chCfg, u_int32 chNbr,
+						 u_int32 nbrDummy);
+static void ScanFrame(u_int8 *ma, SCAN_ENTRY *scan, u_int32 nbrScan,
+					  u_int16 *buf);
+static double TimeUs(void);
+static void SigHandler(int sig);
+
+/********************************* usage ************************************
+ *
+ *  Description: Print program usage
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void usage(void)
+{
+	printf("Usage: m34_poll [<opts>] <device> [<opts>]\n");
+	printf("Function: Busy-poll acquisition of M34/M35 channels\n");
+	printf("          from user space (module irq disabled)\n");
+	printf("Options:\n");
+	printf("    device       device name (not with -m)        [none]\n");
+	printf("    -a=<addr>    phys. address of the M-Module\n");
+	printf("                 A08 register window (hex)        [none]\n");
+	printf("    -n=<nbr>     number of frames                 [1000]\n");
+	printf("    -m=<settle>  scan the register model, input\n");
+	printf("                 settles after <settle> conv.     [no]\n");
+	printf("    -c=<nbr>     model: number of channels        [16]\n");
+	printf("    -d=<nbr>     model: dummy reads per channel   [0]\n");
+	printf("    -v           print values of the last frame   [no]\n");
+	printf("\n");
+	printf("Copyright 2026, MEN Mikro Elektronik GmbH\n%s\n", IdentString);
+}
+
+/********************************* main *************************************
+ *
+ *  Description: Program main function
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: argc,argv	argument counter, data ..
+ *  Output.....: return	    success (0) or error (1)
+ *  Globals....: -
+ ****************************************************************************/
+int main(int argc, char *argv[])
+{
+	MDIS_PATH			path=0;
+	int32				n, chNbr, nbrDummy, owner=0, verbose, ret = 1;
+	u_int32				ch, frame, nbrFrames, nbrScan, errors=0;
+	u_int32				addr=0, physBase=0, mapSize=0;
+	char				*device, *str, *errstr, buf[40];
+	M_SETGETSTAT_BLOCK	blk;
+	M34_CH_CFG			chCfg[MAX_CH];
+	SCAN_ENTRY			scan[MAX_CH];
+	u_int16				val[MAX_CH];
+	M34_MODEL			model;
+	u_int8				*ma=NULL;
+	double				t0, t, tMin=0.0, tMax=0.0, tSum=0.0;
+#ifdef LINUX
+	int					memFd=-1;
+	void				*mapP=MAP_FAILED;
+#endif
+
+	/*--------------------+
+    |  check arguments    |
+    +--------------------*/
+	if ((errstr = UTL_ILLIOPT("a=n=m=c=d=v?", buf))) {	/* check args */
+		printf("*** %s\n", errstr);
+		return(1);
+	}
+
+	if (UTL_TSTOPT("?")) {						/* help requested ? */
+		usage();
+		return(1);
+	}
+
+	/*--------------------+
+    |  get arguments      |
+    +--------------------*/
+	for (device=NULL, n=1; n<argc; n++)
+		if (*argv[n] != '-') {
+			device = argv[n];
+			break;
+		}
+
+	nbrFrames = ((str = UTL_TSTOPT("n=")) ? atoi(str) : 1000);
+	verbose   = (UTL_TSTOPT("v") ? 1 : 0);
+
+	if ((str = UTL_TSTOPT("m="))) {
+		memset(&model, 0, sizeof(model));
+		model.settle = atoi(str);
+		G_Model = &model;
+	}
+	if ((str = UTL_TSTOPT("a=")))
+		addr = strtoul(str, NULL, 16);
+
+	if ((G_Model && device) || (!G_Model && (!device || !addr)) ||
+		nbrFrames == 0) {
+		usage();
+		return(1);
+	}
+
+	/*--------------------+
+    |  channel setup      |
+    +--------------------*/
+	if (G_Model) {
+		/* model: all channels, gain 1, unipolar */
+		chNbr    = ((str = UTL_TSTOPT("c=")) ? atoi(str) : MAX_CH);
+		nbrDummy = ((str = UTL_TSTOPT("d=")) ? atoi(str) : 0);
+		if (chNbr < 1 || chNbr > MAX_CH || nbrDummy < 0) {
+			usage();
+			return(1);
+		}
+		memset(chCfg, 0, sizeof(chCfg));
+		for (ch=0; ch<(u_int32)chNbr; ch++)
+			chCfg[ch].rdBlkIrq = 1;
+	}
+	else {
+		if ((path = M_open(device)) < 0) {
+			PrintMdisError("open");
+			return(1);
+		}
+		if ((M_getstat(path, M_LL_CH_NUMBER, &chNbr)) < 0) {
+			PrintMdisError("getstat M_LL_CH_NUMBER");
+			goto abort;
+		}
+		if ((M_getstat(path, M34_DUMMY_READS, &nbrDummy)) < 0) {
+			PrintMdisError("getstat M34_DUMMY_READS");
+			goto abort;
+		}
+		blk.size = chNbr * sizeof(M34_CH_CFG);
+		blk.data = (void*)chCfg;
+		if ((M_getstat(path, M34_BLK_CH_CFG, (int32*)&blk)) < 0) {
+			PrintMdisError("getstat M34_BLK_CH_CFG");
+			goto abort;
+		}
+	}
+
+	if ((nbrScan = ScanSetup(scan, chCfg, chNbr, nbrDummy)) == 0) {
+		printf("*** no channel configured for block read\n");
+		goto abort;
+	}
+
+	/*--------------------+
+    |  get registers      |
+    +--------------------*/
+	/* Ctrl-C must not leave the registers owned by this process */
+	signal(SIGINT, SigHandler);
+	signal(SIGTERM, SigHandler);
+
+	if (!G_Model) {
+		/* stop acquisition, driver leaves the registers alone */
+		if ((M_setstat(path, M_MK_IRQ_ENABLE, 0)) < 0) {
+			PrintMdisError("setstat M_MK_IRQ_ENABLE");
+			goto abort;
+		}
+		if ((M_setstat(path, M34_POLL_OWNER, 1)) < 0) {
+			PrintMdisError("setstat M34_POLL_OWNER");
+			goto abort;
+		}
+		owner = 1;
+
+#ifdef LINUX
+		physBase = addr & ~((u_int32)getpagesize() - 1);
+		mapSize  = addr - physBase + M34_ADDRSPACE_SIZE;
+		if ((memFd = open("/dev/mem", O_RDWR | O_SYNC)) < 0) {
+			printf("*** can't open /dev/mem\n");
+			goto abort;
+		}
+		mapP = mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+					memFd, (off_t)physBase);
+		if (mapP == MAP_FAILED) {
+			printf("*** can't map 0x%x\n", (unsigned)addr);
+			goto abort;
+		}
+		ma = (u_int8*)mapP + (addr - physBase);
+#else
+		printf("*** register mapping not supported on this OS\n");
+		goto abort;
+#endif
+	}
+
+	printf("channels: %d, frames: %d, %s\n", (int)nbrScan, (int)nbrFrames,
+		   G_Model ? "register model" : "hardware");
+
+	/*--------------------+
+    |  busy-poll scan     |
+    +--------------------*/
+	for (frame=0; frame<nbrFrames && !G_Stop; frame++) {
+		t0 = TimeUs();
+		ScanFrame(ma, scan, nbrScan, val);
+		t  = TimeUs() - t0;
+
+		if (frame == 0 || t < tMin)
+			tMin = t;
+		if (t > tMax)
+			tMax = t;
+		tSum += t;
+
+		/* model: every value must come from the selected input */
+		if (G_Model)
+			for (n=0; n<(int32)nbrScan; n++)
+				if (val[n] != M34_ModelInput(scan[n].ctrl))
+					errors++;
+	}
+
+	if (G_Stop) {
+		printf("*** stopped after %d frames\n", (int)frame);
+		if (frame == 0)
+			goto abort;
+		nbrFrames = frame;
+	}
+
+	printf("frame time [us]: min %.2f  avg %.2f  max %.2f\n",
+		   tMin, tSum / nbrFrames, tMax);
+
+	if (verbose)
+		for (n=0; n<(int32)nbrScan; n++)
+			printf("ch %2d: 0x%04x\n",
+				   (int)(scan[n].ctrl & M34_CTRL_CH_MASK), val[n]);
+
+	if (G_Model) {
+		printf("model check: %d of %d values wrong\n",
+			   (int)errors, (int)(nbrScan * nbrFrames));
+		if (errors)
+			goto abort;
+	}
+
+	ret = 0;
+
+	/*--------------------+
+    |  cleanup            |
+    +--------------------*/
+	abort:
+#ifdef LINUX
+	if (mapP != MAP_FAILED)
+		munmap(mapP, mapSize);
+	if (memFd >= 0)
+		close(memFd);
+#endif
+	if (owner && (M_setstat(path, M34_POLL_OWNER, 0)) < 0)
+		PrintMdisError("setstat M34_POLL_OWNER");
+
+	if (path && M_close(path) < 0)
+		PrintMdisError("close");
+
+	return(ret);
+}
+
+/********************************* ScanSetup ********************************
+ *
+ *  Description: Build the scan list from the channel config table
+ *               (block read channels, as the driver scanList)
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: scan		scan list to fill (MAX_CH entries)
+ *               chCfg		channel config table
+ *               chNbr		number of channels
+ *               nbrDummy	M34_DUMMY_READS
+ *  Output.....: return	    number of scan list entries
+ *  Globals....: -
+ ****************************************************************************/
+static u_int32 ScanSetup(SCAN_ENTRY *scan, M34_CH_CFG *chCfg, u_int32 chNbr,
+						 u_int32 nbrDummy)
+{
+	u_int32	ch, n = 0;
+
+	for (ch=0; ch<chNbr; ch++) {
+		if (!chCfg[ch].rdBlkIrq)
+			continue;
+
+		scan[n].ctrl     = M34_CTRL_WORD(ch, chCfg[ch].gain, chCfg[ch].bipolar);
+		scan[n].nbrDummy = nbrDummy + chCfg[ch].settle;
+		scan[n].inc      = 0;
+
+		/* previous entry can select this ch by increment */
+		scan[n].noCtrl = (n > 0 && scan[n].ctrl == scan[n-1].ctrl + 1) ? 1 : 0;
+		if (scan[n].noCtrl)
+			scan[n-1].inc = 1;
+		n++;
+	}
+
+	return( n );
+}
+
+/********************************* ScanFrame ********************************
+ *
+ *  Description: Read one frame in a busy loop
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: ma			register window
+ *               scan		scan list
+ *               nbrScan	number of scan list entries
+ *               buf		values (nbrScan)
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void ScanFrame(u_int8 *ma, SCAN_ENTRY *scan, u_int32 nbrScan,
+					  u_int16 *buf)
+{
+	u_int32	n;
+
+	for (n=0; n<nbrScan; n++, scan++) {
+		if (scan->noCtrl)
+			M34_SCAN_DUMMY(ma, scan->nbrDummy);
+		else
+			M34_SCAN_SETTLE(ma, scan->ctrl, scan->nbrDummy);
+
+		*buf++ = scan->inc ? M34_SCAN_CONV_INC(ma) : M34_SCAN_CONV(ma);
+	}
+}
+
+/********************************* RegRd ************************************
+ *
+ *  Description: Register read (mapped window or register model)
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: ma			register window
+ *               offs		register offset
+ *  Output.....: return		register value
+ *  Globals....: G_Model
+ ****************************************************************************/
+static u_int16 RegRd(u_int8 *ma, u_int32 offs)
+{
+	if (G_Model)
+		return( M34_ModelRd(G_Model, offs) );
+
+	return( *(volatile u_int16*)(ma + offs) );
+}
+
+/********************************* RegWr ************************************
+ *
+ *  Description: Register write (mapped window or register model)
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: ma			register window
+ *               offs		register offset
+ *               val		value to write
+ *  Output.....: -
+ *  Globals....: G_Model
+ ****************************************************************************/
+static void RegWr(u_int8 *ma, u_int32 offs, u_int16 val)
+{
+	if (G_Model)
+		M34_ModelWr(G_Model, offs, val);
+	else
+		*(volatile u_int16*)(ma + offs) = val;
+}
+
+/********************************* TimeUs ***********************************
+ *
+ *  Description: Monotonic time
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: return		time [us]
+ *  Globals....: -
+ ****************************************************************************/
+static double TimeUs(void)
+{
+#ifdef LINUX
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return( ts.tv_sec * 1000000.0 + ts.tv_nsec / 1000.0 );
+#else
+	return( UOS_MsecTimerGet() * 1000.0 );
+#endif
+}
+
+/********************************* SigHandler *******************************
+ *
+ *  Description: SIGINT/SIGTERM handler, ends the scan loop (main releases
+ *               the registers)
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: sig		signal
+ *  Output.....: -
+ *  Globals....: G_Stop
+ ****************************************************************************/
+static void SigHandler(int sig)
+{
+	(void)sig;
+	G_Stop = 1;
+}
+
+/********************************* PrintMdisError ***************************
+ *
+ *  Description: Print MDIS error message
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: info	info string
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+
+static void PrintMdisError(char *info)
+{
+	printf("*** can't %s: %s\n", info, M_errstring(UOS_ErrnoGet()));
+}
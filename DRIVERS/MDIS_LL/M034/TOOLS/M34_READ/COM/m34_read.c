@@ -45,6 +45,7 @@ static const char IdentString[]=MENT_XSTR(MAK_REVISION);
 +--------------------------------------*/
 static void usage(void);
 static void PrintError(char *info);
+static void PrintValue(int32 value, int32 gainfac, int32 mode, int32 res, int32 disp);
 
 /********************************* usage ************************************
  *
@@ -61,10 +62,12 @@ static void usage(void)
 	printf("Function: Configure and read M34/M35 channel\n");
 	printf("Options:\n");
 	printf("    device       device name                 [none]\n");
-	printf("    -r=<res>     resolution                  [none]\n");
+	printf("    -r=<res>     resolution                  [from ID]\n");
 	printf("                  12 = 12-bit (for M34)\n");
 	printf("                  14 = 14-bit (for M35)\n");
 	printf("    -c=<chan>    channel number (0..7/15)    [0]\n");
+	printf("    -e=<chan>    read channels -c..-e with   [-c]\n");
+	printf("                 one call (M34_BLK_MULTI_READ)\n");
 	printf("    -g=<gain>    gain factor                 [x1]\n");			
 	printf("                  0 = x1\n");
 	printf("                  1 = x2\n");
@@ -95,14 +98,15 @@ static void usage(void)
 int main(int argc, char *argv[])
 {
 	MDIS_PATH   path=0;
-	int32        res, chan, gain, mode, disp, loopmode, value, n, gainfac;
+	int32        res, chan, lastChan, chNbr, gain, mode, disp, loopmode, value, n, gainfac;
 	char	    *device, *str, *errstr, buf[40];
-	double	    volt, curr;
+	M34_MULTI_READ	mrd[M34_SINGLE_ENDED_MAX_CH];
+	M_SETGETSTAT_BLOCK mrdBlk;
 
 	/*--------------------+
     |  check arguments    |
     +--------------------*/
-	if ((errstr = UTL_ILLIOPT("r=c=g=m=d=l?", buf))) {	/* check args */
+	if ((errstr = UTL_ILLIOPT("r=c=e=g=m=d=l?", buf))) {	/* check args */
 		printf("*** %s\n", errstr);
 		return(1);
 	}
@@ -128,17 +132,24 @@ int main(int argc, char *argv[])
 
 	res      = ((str = UTL_TSTOPT("r=")) ? atoi(str) : 0);
 	chan     = ((str = UTL_TSTOPT("c=")) ? atoi(str) : 0);
+	lastChan = ((str = UTL_TSTOPT("e=")) ? atoi(str) : chan);
 	gain     = ((str = UTL_TSTOPT("g=")) ? atoi(str) : 0);
 	mode     = ((str = UTL_TSTOPT("m=")) ? atoi(str) : 0);
 	disp     = ((str = UTL_TSTOPT("d=")) ? atoi(str) : 0);
 	loopmode = (UTL_TSTOPT("l") ? 1 : 0);
 
 	/* check for option conflict */
-	if ( (res != 12) && (res != 14) ) {
+	if ( (res != 0) && (res != 12) && (res != 14) ) {
 		printf("\n*** option -r= must be 12 (for M34) or 14 (for M35)\n\n");
 		usage();
 		return(1);
 	}
+	if ((chan < 0) || (lastChan < chan) ||
+		(lastChan >= M34_SINGLE_ENDED_MAX_CH)) {
+		printf("\n*** option -c= must be 0..15, -e= in range -c..15\n\n");
+		usage();
+		return(1);
+	}
 	if ((disp == 2) && (gain != 3)) {
 		printf("\n*** option -d=2 only available with option -g=3\n\n");
 		usage();
@@ -155,9 +166,38 @@ int main(int argc, char *argv[])
 		return(1);
 	}
 
+	/* channels of the module: 16 single ended, 8 differential */
+	if ((M_getstat(path, M_LL_CH_NUMBER, &chNbr)) < 0) {
+		PrintError("getstat M_LL_CH_NUMBER");
+		goto abort;
+	}
+	if (lastChan >= chNbr) {
+		printf("\n*** option -c=/-e= must be in range 0..%d\n\n",
+			   (int)chNbr - 1);
+		goto abort;
+	}
+
+	/* resolution from the module ID-PROM */
+	if (res == 0) {
+		if ((M_getstat(path, M34_RESOLUTION, &res)) < 0) {
+			PrintError("getstat M34_RESOLUTION (use option -r=)");
+			goto abort;
+		}
+	}
+
 	/*--------------------+
     |  config             |
     +--------------------*/
+	/* channel list: gain/mode are passed with each entry */
+	for (n=0; n<=lastChan-chan; n++) {
+		mrd[n].ch      = (u_int8)(chan + n);
+		mrd[n].flags   = M34_MRD_BIPOLAR | ((gain != 4) ? M34_MRD_GAIN : 0);
+		mrd[n].gain    = (u_int8)((gain != 4) ? gain : 0);
+		mrd[n].bipolar = (u_int8)mode;
+	}
+	mrdBlk.size = (lastChan - chan + 1) * sizeof(M34_MULTI_READ);
+	mrdBlk.data = (void*)mrd;
+
 	/* set current channel */
 	if ((M_setstat(path, M_MK_CH_CURRENT, chan)) < 0) {
 		PrintError("setstat M_MK_CH_CURRENT");
@@ -181,7 +221,10 @@ int main(int argc, char *argv[])
     |  print info         |
     +--------------------*/
 	printf("resolution          : %d-bit\n", res);
-	printf("channel number      : %d\n", chan);
+	if (lastChan != chan)
+		printf("channel numbers     : %d..%d\n", chan, lastChan);
+	else
+		printf("channel number      : %d\n", chan);
 	printf("gain factor         : x%d\n", gainfac);
 	printf("measuring mode      : %s\n\n",(mode==0 ? "unipolar":"bipolar"));
 
@@ -189,31 +232,24 @@ int main(int argc, char *argv[])
     |  read               |
     +--------------------*/
 	do {
-		if ((M_read(path,&value)) < 0) {
-			PrintError("read");
-			goto abort;
+		/* single channel */
+		if (lastChan == chan) {
+			if ((M_read(path,&value)) < 0) {
+				PrintError("read");
+				goto abort;
+			}
+			PrintValue(value, gainfac, mode, res, disp);
 		}
-		switch (disp) {
-			/* raw hex value */
-			case 0:
-				printf("read: 0x%04x (value is %s)\n",
-					value, ((value & 0x0001) ? "invalid":"valid"));
-				break;
-			/* voltage */
-			case 1:
-				M34_CALC_VOLTAGE( value, gainfac, mode, res, volt );
-				printf("read: 0x%04x = %7.3f V (value is %s)\n",
-					value, volt, ((value & 0x0001) ? "invalid":"valid"));
-				break;
-			/* current */
-			case 2:
-				M34_CALC_CURRENT( value, mode, res, curr );
-				printf("read: 0x%04x = %7.3f mA (value is %s)\n",
-					value, curr, ((value & 0x0001) ? "invalid":"valid"));
-				break;
-			/* invalid */
-			default:
-				printf("*** option -d=%d out of range (-d=0..2)\n", disp);
+		/* channel list */
+		else {
+			if ((M_getstat(path, M34_BLK_MULTI_READ, (int32*)&mrdBlk)) < 0) {
+				PrintError("getstat M34_BLK_MULTI_READ");
+				goto abort;
+			}
+			for (n=0; n<=lastChan-chan; n++) {
+				printf("ch %2d ", (int)mrd[n].ch);
+				PrintValue(mrd[n].value, gainfac, mode, res, disp);
+			}
 		}
 
 		UOS_Delay(100);
@@ -229,6 +265,47 @@ int main(int argc, char *argv[])
 	return(0);
 }
 
+/********************************* PrintValue ********************************
+ *
+ *  Description: Print read value in selected display mode
+ *			   
+ *---------------------------------------------------------------------------
+ *  Input......: value		read value
+ *               gainfac	gain factor
+ *               mode		measuring mode
+ *               res		resolution
+ *               disp		display mode
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void PrintValue(int32 value, int32 gainfac, int32 mode, int32 res, int32 disp)
+{
+	double	    volt, curr;
+
+	switch (disp) {
+		/* raw hex value */
+		case 0:
+			printf("read: 0x%04x (value is %s)\n",
+				value, ((value & 0x0001) ? "invalid":"valid"));
+			break;
+		/* voltage */
+		case 1:
+			M34_CALC_VOLTAGE( value, gainfac, mode, res, volt );
+			printf("read: 0x%04x = %7.3f V (value is %s)\n",
+				value, volt, ((value & 0x0001) ? "invalid":"valid"));
+			break;
+		/* current */
+		case 2:
+			M34_CALC_CURRENT( value, mode, res, curr );
+			printf("read: 0x%04x = %7.3f mA (value is %s)\n",
+				value, curr, ((value & 0x0001) ? "invalid":"valid"));
+			break;
+		/* invalid */
+		default:
+			printf("*** option -d=%d out of range (-d=0..2)\n", disp);
+	}
+}
+
 /********************************* PrintError ********************************
  *
  *  Description: Print MDIS error message
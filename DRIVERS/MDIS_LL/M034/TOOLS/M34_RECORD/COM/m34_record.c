@@ -0,0 +1,779 @@
+/****************************************************************************
+ ************                                                    ************
+ ************               M 3 4 _ R E C O R D                  ************
+ ************                                                    ************
+ ****************************************************************************
+ *
+ *       Author: ds
+ *
+ *  Description: Record M34/M35 block reads of one or more modules to disk
+ *
+ *               An acquisition thread per module reads blocks with the
+ *               current driver configuration (irq mode, buffer mode,
+ *               channel table) and collects them in chunks. Full chunks
+ *               are passed to the writer thread through a lock-free
+ *               single producer/single consumer queue per module. The
+ *               writer writes whole chunks (multiple of 4 KiB, aligned
+ *               buffers) to one file per module, <prefix>_<n>.m34, which
+ *               is preallocated in steps (fallocate) and optionally
+ *               opened with O_DIRECT.
+ *
+ *               The memory is bounded by modules * queue depth * chunk
+ *               size. If the queue of a module is full the chunk is
+ *               dropped: the chunk number (seq) has a gap and the drop
+ *               counters in the next chunk header are incremented.
+ *               Frames lost by the driver (read buffer full, telemetry
+ *               rdLost) are reported in the chunk header too, as are the
+ *               adaptive irq mode switches (M34_ERR_IRQ_ADAPT, the frame
+ *               layout stays the same).
+ *
+ *               File format (host byte order):
+ *
+ *                 chunk    REC_CHUNK_HDR, padded to hdrSize
+ *                          dataSize bytes of raw samples (frames of
+ *                          nbrCh 16-bit values, as read by M_getblock)
+ *                          padding up to chunkSize
+ *                 chunk    ..
+ *
+ *               The samples of a module are a continuous stream. Short
+ *               block reads (non-blocking buffer) are stored too, so a
+ *               chunk may start and end within a frame: chFirst is the
+ *               frame position (index of ch[]) of its first sample.
+ *
+ *               Irq mode 5 (burst) records one channel (nbrCh 1), each
+ *               block is a separate burst. Async (M34_ASYNC_ENABLE),
+ *               capture (M34_CAPT_ENABLE) and raw (M34_RD_RAW) block
+ *               reads are refused.
+ *
+ *     Required: Libraries: mdis_api, usr_oss, usr_utl, pthread
+ *     Switches: LINUX
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 2026, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifdef LINUX
+# define _GNU_SOURCE		/* O_DIRECT, fallocate */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef LINUX
+# include <errno.h>
+# include <fcntl.h>
+# include <time.h>
+# include <unistd.h>
+# include <pthread.h>
+#endif
+#include <MEN/men_typs.h>
+#include <MEN/usr_oss.h>
+#include <MEN/usr_utl.h>
+#include <MEN/mdis_api.h>
+#include <MEN/mdis_err.h>
+#include <MEN/m34_drv.h>
+
+static const char IdentString[]=MENT_XSTR(MAK_REVISION);
+
+#ifdef LINUX
+/*--------------------------------------+
+|   DEFINES                             |
++--------------------------------------*/
+#define MAX_CH		M34_SINGLE_ENDED_MAX_CH
+#define MAX_MOD		8			/* modules */
+#define MAX_QUEUE	256			/* queue depth [chunks] */
+#define REC_ALIGN	4096		/* chunk size/buffer alignment (O_DIRECT) */
+#define REC_HDR_SIZE 256		/* chunk header size incl. padding */
+#define REC_MAGIC	0x4334334dUL	/* "M34C" (little endian) */
+#define REC_VERSION	2
+
+/* memory barrier between queue slot access and index update */
+#define REC_BARRIER()	__sync_synchronize()
+
+/*--------------------------------------+
+|   TYPDEFS                             |
++--------------------------------------*/
+/* chunk header (file format) */
+typedef struct {
+	u_int32	magic;		/* REC_MAGIC */
+	u_int16	version;	/* REC_VERSION */
+	u_int16	hdrSize;	/* header size incl. padding (data offset) */
+	u_int32	chunkSize;	/* chunk size incl. header and padding */
+	u_int32	dataSize;	/* sample data [byte] */
+	u_int32	module;		/* module number (order of the devices) */
+	u_int32	seq;		/* chunk number 0.. (gap: chunks dropped) */
+	u_int32	tsSec;		/* CLOCK_REALTIME when the first block was read */
+	u_int32	tsNsec;
+	u_int32	frames;		/* frames in the chunk (dataSize / (nbrCh*2),
+						   chFirst != 0: frame positions not aligned) */
+	u_int32	dropped;	/* chunks dropped since start (queue full) */
+	u_int32	rdLost;		/* frames lost by the driver since start,
+						   telemetry rdLost */
+	u_int32	rdErrors;	/* short block reads since start (stored) */
+	u_int16	resolution;	/* 12/14 bit */
+	u_int16	irqMode;	/* M34_IMODE_xxx */
+	u_int16	nbrCh;		/* samples per frame */
+	u_int16	chNbr;		/* channels of the module */
+	u_int16	chFirst;	/* frame position of the first sample 0..nbrCh-1 */
+	u_int16	adaptSwitches;	/* irq mode switches since start
+							   (M34_IRQ_ADAPT, low 16 bit) */
+	u_int8	ch[MAX_CH];		/* channel of sample n of a frame */
+	u_int8	gain[MAX_CH];	/* gain of ch[n] (M34_GAIN_x) */
+	u_int8	bipolar[MAX_CH];/* polarity of ch[n] (M34_UNIPOLAR/BIPOLAR) */
+	char	device[32];	/* device name */
+} REC_CHUNK_HDR;
+
+/* module */
+typedef struct {
+	int32			num;		/* module number */
+	char			*device;
+	MDIS_PATH		path;
+	REC_CHUNK_HDR	hdr;		/* header template */
+	int32			blkSize;	/* block read size [byte] */
+	int32			blkPerChunk;
+	/* queue (acquisition thread -> writer thread) */
+	u_int8			*slots;		/* queue depth * chunk size, aligned */
+	u_int8			*scratch;	/* chunk if the queue is full */
+	volatile u_int32 head;		/* chunks queued (acquisition thread) */
+	volatile u_int32 tail;		/* chunks written (writer thread) */
+	/* acquisition thread */
+	pthread_t		thread;
+	int32			running;
+	u_int32			seq;
+	u_int32			dropped;
+	u_int32			rdErrors;
+	u_int32			chPos;		/* frame position of the next sample */
+	u_int32			timeouts;	/* incl. trigger lost */
+	u_int32			adaptSwitches;	/* M34_ERR_IRQ_ADAPT */
+	volatile u_int32 rdLost;
+	int32			err;		/* fatal MDIS error (0=none) */
+	/* writer thread */
+	int				fd;
+	double			written;	/* [byte] */
+	double			alloc;		/* preallocated [byte] */
+} REC_MOD;
+
+/*--------------------------------------+
+|   GLOBALS                             |
++--------------------------------------*/
+static REC_MOD		G_Mod[MAX_MOD];
+static int32		G_NbrMod;
+static int32		G_ChunkSize;	/* [byte] */
+static int32		G_Depth;		/* queue depth [chunks] */
+static double		G_AllocStep;	/* preallocation step [byte] (0=off) */
+static volatile int	G_Stop;			/* stop acquisition */
+static volatile int	G_WrDone;		/* acquisition stopped, drain queues */
+static volatile int	G_WrErr;		/* writer failed (errno) */
+
+/*--------------------------------------+
+|   PROTOTYPES                          |
++--------------------------------------*/
+static void usage(void);
+static void PrintMdisError(char *device, char *info);
+static int32 ModInit(REC_MOD *mod, int32 frames);
+static void *AcqThread(void *arg);
+static void *WrThread(void *arg);
+static int32 WrChunk(REC_MOD *mod, u_int8 *chunk);
+static double TimeSec(void);
+
+/********************************* usage ************************************
+ *
+ *  Description: Print program usage
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void usage(void)
+{
+	printf("Usage: m34_record [<opts>] <device> [<device>..] [<opts>]\n");
+	printf("Function: Record M34/M35 block reads to disk (binary chunks)\n");
+	printf("          with the current driver configuration\n");
+	printf("Options:\n");
+	printf("    device       device name(s), max %d         [none]\n", MAX_MOD);
+	printf("    -o=<prefix>  file prefix, <prefix>_<n>.m34  [m34rec]\n");
+	printf("    -t=<sec>     recording time (0=until key)   [0]\n");
+	printf("    -s=<frames>  block read size [frames]       [64]\n");
+	printf("                 (irq mode 3: always 1)\n");
+	printf("    -k=<KiB>     chunk size, multiple of 4      [1024]\n");
+	printf("    -q=<chunks>  queue depth per module 2..%d  [16]\n", MAX_QUEUE);
+	printf("    -p=<MiB>     preallocation step (0=off)     [256]\n");
+	printf("    -x           write with O_DIRECT            [no]\n");
+	printf("    -n           no status line per second      [no]\n");
+	printf("\n");
+	printf("Memory: modules * queue depth * chunk size\n");
+	printf("\n");
+	printf("Copyright 2026, MEN Mikro Elektronik GmbH\n%s\n", IdentString);
+}
+
+/********************************* main *************************************
+ *
+ *  Description: Program main function
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: argc,argv	argument counter, data ..
+ *  Output.....: return	    success (0) or error (1)
+ *  Globals....: G_Mod, G_NbrMod, G_ChunkSize, G_Depth, G_AllocStep,
+ *               G_Stop, G_WrDone, G_WrErr
+ ****************************************************************************/
+int main(int argc, char *argv[])
+{
+	int32		n, m, secs, frames, kib, quiet, direct, ret = 1;
+	char		*str, *errstr, *prefix, buf[40], file[256];
+	pthread_t	wrThread;
+	int32		wrRunning = 0;
+	double		t0, t, tLast, wrLast = 0.0, wr;
+	u_int32		drops, lost;
+	REC_MOD		*mod;
+
+	/*--------------------+
+    |  check arguments    |
+    +--------------------*/
+	if ((errstr = UTL_ILLIOPT("o=t=s=k=q=p=xn?", buf))) {	/* check args */
+		printf("*** %s\n", errstr);
+		return(1);
+	}
+
+	if (UTL_TSTOPT("?")) {						/* help requested ? */
+		usage();
+		return(1);
+	}
+
+	/*--------------------+
+    |  get arguments      |
+    +--------------------*/
+	for (G_NbrMod=0, n=1; n<argc; n++)
+		if (*argv[n] != '-') {
+			if (G_NbrMod == MAX_MOD) {
+				usage();
+				return(1);
+			}
+			G_Mod[G_NbrMod].num    = G_NbrMod;
+			G_Mod[G_NbrMod].device = argv[n];
+			G_NbrMod++;
+		}
+
+	if (!G_NbrMod) {
+		usage();
+		return(1);
+	}
+
+	prefix  = ((str = UTL_TSTOPT("o=")) ? str : "m34rec");
+	secs    = ((str = UTL_TSTOPT("t=")) ? atoi(str) : 0);
+	frames  = ((str = UTL_TSTOPT("s=")) ? atoi(str) : 64);
+	kib     = ((str = UTL_TSTOPT("k=")) ? atoi(str) : 1024);
+	G_Depth = ((str = UTL_TSTOPT("q=")) ? atoi(str) : 16);
+	G_AllocStep = ((str = UTL_TSTOPT("p=")) ? atoi(str) : 256) * 1048576.0;
+	direct  = (UTL_TSTOPT("x") ? 1 : 0);
+	quiet   = (UTL_TSTOPT("n") ? 1 : 0);
+
+	if (secs < 0 || frames < 1 || kib < 8 || (kib % 4) ||
+		G_Depth < 2 || G_Depth > MAX_QUEUE || G_AllocStep < 0.0) {
+		usage();
+		return(1);
+	}
+	G_ChunkSize = kib * 1024;
+
+	/*--------------------+
+    |  open modules       |
+    +--------------------*/
+	/* no file yet (cleanup), also for the modules after a failing one */
+	for (m=0; m<G_NbrMod; m++)
+		G_Mod[m].fd = -1;
+
+	for (m=0; m<G_NbrMod; m++) {
+		mod = &G_Mod[m];
+
+		if ((mod->path = M_open(mod->device)) < 0) {
+			PrintMdisError(mod->device, "open");
+			goto abort;
+		}
+		if (ModInit(mod, frames))
+			goto abort;
+
+		sprintf(file, "%s_%d.m34", prefix, (int)m);
+		if ((mod->fd = open(file, O_WRONLY | O_CREAT | O_TRUNC |
+							(direct ? O_DIRECT : 0), 0644)) < 0) {
+			printf("*** can't open %s: %s\n", file, strerror(errno));
+			goto abort;
+		}
+
+		printf("%s: irq mode %d, %d channels, %d-bit, block %d bytes, "
+			   "%d blocks/chunk -> %s\n",
+			   mod->device, (int)mod->hdr.irqMode, (int)mod->hdr.nbrCh,
+			   (int)mod->hdr.resolution, (int)mod->blkSize,
+			   (int)mod->blkPerChunk, file);
+	}
+	printf("chunk %d KiB, queue %d chunks/module, memory %d KiB%s\n",
+		   (int)kib, (int)G_Depth, (int)(G_NbrMod * (G_Depth + 1) * kib),
+		   direct ? ", O_DIRECT" : "");
+
+	/*--------------------+
+    |  start threads      |
+    +--------------------*/
+	if (pthread_create(&wrThread, NULL, WrThread, NULL)) {
+		printf("*** can't create writer thread\n");
+		goto abort;
+	}
+	wrRunning = 1;
+
+	for (m=0; m<G_NbrMod; m++) {
+		if (pthread_create(&G_Mod[m].thread, NULL, AcqThread, &G_Mod[m])) {
+			printf("*** can't create acquisition thread\n");
+			goto abort;
+		}
+		G_Mod[m].running = 1;
+	}
+
+	/*--------------------+
+    |  record             |
+    +--------------------*/
+	printf("recording%s ..\n", secs ? "" : ", press any key to stop");
+	t0 = tLast = TimeSec();
+	for (;;) {
+		UOS_Delay(100);
+		t = TimeSec();
+
+		if ((secs && t - t0 >= secs) || (!secs && UOS_KeyPressed() != -1))
+			break;
+		if (G_WrErr)
+			break;
+		for (m=0; m<G_NbrMod; m++)
+			if (G_Mod[m].err)
+				break;
+		if (m < G_NbrMod)
+			break;
+
+		if (!quiet && t - tLast >= 1.0) {
+			for (wr=0.0, drops=lost=0, m=0; m<G_NbrMod; m++) {
+				wr    += G_Mod[m].written;
+				drops += G_Mod[m].dropped;
+				lost  += G_Mod[m].rdLost;
+			}
+			printf("%6.0fs %9.1f MiB %7.2f MiB/s  dropped chunks %u  "
+				   "lost frames %u\n", t - t0, wr / 1048576.0,
+				   (wr - wrLast) / 1048576.0 / (t - tLast),
+				   (unsigned)drops, (unsigned)lost);
+			wrLast = wr;
+			tLast  = t;
+		}
+	}
+
+	ret = 0;
+
+	/*--------------------+
+    |  cleanup            |
+    +--------------------*/
+	abort:
+	/* stop acquisition (ends with the next block read), drain queues */
+	G_Stop = 1;
+	for (m=0; m<G_NbrMod; m++)
+		if (G_Mod[m].running)
+			pthread_join(G_Mod[m].thread, NULL);
+	G_WrDone = 1;
+	if (wrRunning)
+		pthread_join(wrThread, NULL);
+
+	if (G_WrErr) {
+		printf("*** write failed: %s\n", strerror(G_WrErr));
+		ret = 1;
+	}
+
+	for (m=0; m<G_NbrMod; m++) {
+		mod = &G_Mod[m];
+
+		if (mod->fd >= 0) {
+			/* release preallocated space behind the data */
+			if (ftruncate(mod->fd, (off_t)mod->written) < 0)
+				printf("*** can't truncate file %d: %s\n", (int)m,
+					   strerror(errno));
+			close(mod->fd);
+		}
+
+		if (mod->running) {
+			printf("%s: %u chunks written (%.1f MiB), %u dropped, "
+				   "%u frames lost by driver, %u short reads, "
+				   "%u timeouts, %u irq mode switches\n", mod->device,
+				   (unsigned)(mod->seq - mod->dropped),
+				   mod->written / 1048576.0, (unsigned)mod->dropped,
+				   (unsigned)mod->rdLost, (unsigned)mod->rdErrors,
+				   (unsigned)mod->timeouts, (unsigned)mod->adaptSwitches);
+			if (mod->err) {
+				printf("*** %s: can't read block: %s\n", mod->device,
+					   M_errstring(mod->err));
+				ret = 1;
+			}
+		}
+
+		if (mod->path > 0 && M_close(mod->path) < 0)
+			PrintMdisError(mod->device, "close");
+
+		free(mod->slots);
+		free(mod->scratch);
+	}
+
+	return(ret);
+}
+
+/********************************* ModInit **********************************
+ *
+ *  Description: Get the module config, build the chunk header template
+ *               and allocate the queue
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: mod		module (path open)
+ *               frames		block read size [frames]
+ *  Output.....: return		0 | -1
+ *  Globals....: G_ChunkSize, G_Depth
+ ****************************************************************************/
+static int32 ModInit(REC_MOD *mod, int32 frames)
+{
+	M_SETGETSTAT_BLOCK	blk;
+	M34_CH_CFG			chCfg[MAX_CH];
+	REC_CHUNK_HDR		*hdr = &mod->hdr;
+	int32				ch, chNbr, irqMode, res, async, capt, raw;
+	void				*p;
+
+	if ((M_getstat(mod->path, M_LL_CH_NUMBER, &chNbr)) < 0 ||
+		(M_getstat(mod->path, M34_IRQ_MODE, &irqMode)) < 0 ||
+		(M_getstat(mod->path, M34_RESOLUTION, &res)) < 0) {
+		PrintMdisError(mod->device, "getstat config");
+		return( -1 );
+	}
+
+	/* async/capture records and raw bus words don't fit the file format */
+	if ((M_getstat(mod->path, M34_ASYNC_ENABLE, &async)) < 0 ||
+		(M_getstat(mod->path, M34_CAPT_ENABLE, &capt)) < 0 ||
+		(M_getstat(mod->path, M34_RD_RAW, &raw)) < 0) {
+		PrintMdisError(mod->device, "getstat read mode");
+		return( -1 );
+	}
+	if (async || capt || raw) {
+		printf("*** %s: %s not supported, disable it\n", mod->device,
+			   async ? "M34_ASYNC_ENABLE" :
+			   capt ? "M34_CAPT_ENABLE" : "M34_RD_RAW");
+		return( -1 );
+	}
+
+	blk.size = chNbr * sizeof(M34_CH_CFG);
+	blk.data = (void*)chCfg;
+	if ((M_getstat(mod->path, M34_BLK_CH_CFG, (int32*)&blk)) < 0) {
+		PrintMdisError(mod->device, "getstat M34_BLK_CH_CFG");
+		return( -1 );
+	}
+
+	/* frame layout: selected channels (irq mode 3: all, irq mode 5:
+	   the first selected channel, a "frame" is one sample of it) */
+	memset(hdr, 0, sizeof(*hdr));
+	for (ch=0; ch<chNbr; ch++) {
+		if (irqMode != M34_IMODE_FIX && !chCfg[ch].rdBlkIrq)
+			continue;
+		if (irqMode == M34_IMODE_BURST && hdr->nbrCh == 1)
+			break;
+		hdr->ch[hdr->nbrCh]      = (u_int8)ch;
+		hdr->gain[hdr->nbrCh]    = chCfg[ch].gain;
+		hdr->bipolar[hdr->nbrCh] = chCfg[ch].bipolar;
+		hdr->nbrCh++;
+	}
+	if (hdr->nbrCh == 0) {
+		printf("*** %s: no channel selected (M34_BLK_CH_CFG)\n",
+			   mod->device);
+		return( -1 );
+	}
+
+	hdr->magic      = REC_MAGIC;
+	hdr->version    = REC_VERSION;
+	hdr->hdrSize    = REC_HDR_SIZE;
+	hdr->chunkSize  = G_ChunkSize;
+	hdr->module     = mod->num;
+	hdr->resolution = (u_int16)res;
+	hdr->irqMode    = (u_int16)irqMode;
+	hdr->chNbr      = (u_int16)chNbr;
+	strncpy(hdr->device, mod->device, sizeof(hdr->device) - 1);
+
+	if (irqMode == M34_IMODE_FIX)
+		frames = 1;
+	mod->blkSize     = frames * hdr->nbrCh * 2;
+	mod->blkPerChunk = (G_ChunkSize - REC_HDR_SIZE) / mod->blkSize;
+	if (mod->blkPerChunk < 1) {
+		printf("*** %s: block (%d bytes) exceeds chunk\n", mod->device,
+			   (int)mod->blkSize);
+		return( -1 );
+	}
+
+	/* queue slots and scratch chunk, aligned for O_DIRECT */
+	if (posix_memalign(&p, REC_ALIGN, (size_t)G_ChunkSize * G_Depth)) {
+		printf("*** can't alloc memory\n");
+		return( -1 );
+	}
+	mod->slots = (u_int8*)p;
+	if (posix_memalign(&p, REC_ALIGN, G_ChunkSize)) {
+		printf("*** can't alloc memory\n");
+		return( -1 );
+	}
+	mod->scratch = (u_int8*)p;
+
+	/* touch all pages before recording */
+	memset(mod->slots, 0, (size_t)G_ChunkSize * G_Depth);
+	memset(mod->scratch, 0, G_ChunkSize);
+
+	return( 0 );
+}
+
+/********************************* AcqThread ********************************
+ *
+ *  Description: Acquisition thread of a module
+ *
+ *               Reads blocks into the next free queue slot (scratch chunk
+ *               if the queue is full) and queues the full chunk. Short
+ *               blocks are appended as they are, the frame position of
+ *               the chunk start is kept in chFirst. The driver telemetry
+ *               (rdLost) is read between chunks.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: arg		module
+ *  Output.....: return		NULL
+ *  Globals....: G_Stop, G_ChunkSize, G_Depth
+ ****************************************************************************/
+static void *AcqThread(void *arg)
+{
+	REC_MOD				*mod = (REC_MOD*)arg;
+	REC_CHUNK_HDR		*hdr;
+	M_SETGETSTAT_BLOCK	blk;
+	M34_TELEMETRY		tele;
+	struct timespec		ts;
+	u_int8				*chunk;
+	int32				got, fill, max, full, err;
+	u_int32				chFirst;
+
+	/* reset driver statistics, start acquisition (see m34_blkread) */
+	if ((M_setstat(mod->path, M34_RD_LEVEL_MAX, 0)) < 0 ||
+		(M_setstat(mod->path, M_MK_IRQ_ENABLE, 1)) < 0) {
+		mod->err = UOS_ErrnoGet();
+		return( NULL );
+	}
+
+	while (!G_Stop) {
+		/* queue full: read into scratch chunk and drop it */
+		full  = (mod->head - mod->tail) >= (u_int32)G_Depth;
+		chunk = full ? mod->scratch :
+			mod->slots + (size_t)(mod->head % G_Depth) * G_ChunkSize;
+		hdr   = (REC_CHUNK_HDR*)chunk;
+
+		max = mod->blkPerChunk * mod->blkSize;
+		chFirst = mod->chPos;
+
+		for (fill=0; fill + mod->blkSize <= max && !G_Stop; ) {
+			got = M_getblock(mod->path, chunk + REC_HDR_SIZE + fill,
+							 mod->blkSize);
+			if (got < 0) {
+				/* adaptive irq mode switched: same frame layout, go on */
+				if (UOS_ErrnoGet() == M34_ERR_IRQ_ADAPT) {
+					mod->adaptSwitches++;
+					continue;
+				}
+				/* no trigger: wait for the next edge */
+				if ((err = UOS_ErrnoGet()) == ERR_OSS_TIMEOUT ||
+					err == M34_ERR_TRIG_LOST) {
+					mod->timeouts++;
+					if (err == M34_ERR_TRIG_LOST)
+						UOS_Delay(10);
+					continue;
+				}
+				mod->err = err;		/* not recoverable */
+				G_Stop   = 1;
+				continue;
+			}
+			/* short block (non-blocking buffer): keep the samples */
+			if (got != mod->blkSize)
+				mod->rdErrors++;
+			if (got == 0)
+				continue;
+			if (fill == 0)
+				clock_gettime(CLOCK_REALTIME, &ts);
+			fill += got;
+			mod->chPos = (mod->chPos + got / 2) % mod->hdr.nbrCh;
+		}
+
+		if (fill == 0)
+			break;
+
+		blk.size = sizeof(tele);
+		blk.data = (void*)&tele;
+		memset(&tele, 0, sizeof(tele));
+		if ((M_getstat(mod->path, M34_BLK_TELEMETRY, (int32*)&blk)) == 0)
+			mod->rdLost = tele.rdLost;
+
+		if (full) {
+			mod->dropped++;
+			mod->seq++;
+			continue;
+		}
+
+		*hdr = mod->hdr;
+		hdr->dataSize = fill;
+		hdr->frames   = hdr->dataSize / (hdr->nbrCh * 2);
+		hdr->chFirst  = (u_int16)chFirst;
+		hdr->seq      = mod->seq++;
+		hdr->tsSec    = (u_int32)ts.tv_sec;
+		hdr->tsNsec   = (u_int32)ts.tv_nsec;
+		hdr->dropped  = mod->dropped;
+		hdr->rdLost   = mod->rdLost;
+		hdr->rdErrors = mod->rdErrors;
+		hdr->adaptSwitches = (u_int16)mod->adaptSwitches;
+		/* zero the rest of a partial last chunk */
+		memset(chunk + REC_HDR_SIZE + hdr->dataSize, 0,
+			   G_ChunkSize - REC_HDR_SIZE - hdr->dataSize);
+
+		REC_BARRIER();		/* chunk complete before it is queued */
+		mod->head++;
+	}
+
+	M_setstat(mod->path, M_MK_IRQ_ENABLE, 0);
+	return( NULL );
+}
+
+/********************************* WrThread *********************************
+ *
+ *  Description: Writer thread, writes the queued chunks of all modules
+ *               until acquisition stopped and the queues are empty
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: arg		-
+ *  Output.....: return		NULL
+ *  Globals....: G_Mod, G_NbrMod, G_WrDone, G_WrErr, G_Stop
+ ****************************************************************************/
+static void *WrThread(void *arg)
+{
+	REC_MOD		*mod;
+	int32		m, idle, done;
+
+	(void)arg;
+
+	for (;;) {
+		done = G_WrDone;
+		idle = 1;
+
+		for (m=0; m<G_NbrMod; m++) {
+			mod = &G_Mod[m];
+			if (mod->tail == mod->head)
+				continue;
+
+			REC_BARRIER();	/* index read before the chunk */
+			if (WrChunk(mod, mod->slots +
+						(size_t)(mod->tail % G_Depth) * G_ChunkSize)) {
+				G_Stop = 1;
+				return( NULL );
+			}
+			REC_BARRIER();	/* chunk written before the slot is freed */
+			mod->tail++;
+			idle = 0;
+		}
+
+		if (idle) {
+			if (done)
+				break;
+			usleep(1000);
+		}
+	}
+
+	return( NULL );
+}
+
+/********************************* WrChunk **********************************
+ *
+ *  Description: Write a chunk, preallocate the next file section if
+ *               required
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: mod		module
+ *               chunk		chunk (G_ChunkSize)
+ *  Output.....: return		0 | -1 (G_WrErr set)
+ *  Globals....: G_ChunkSize, G_AllocStep, G_WrErr
+ ****************************************************************************/
+static int32 WrChunk(REC_MOD *mod, u_int8 *chunk)
+{
+	ssize_t	n;
+	int32	done;
+
+	/* keep the allocated space ahead of the data, file size unchanged */
+	if (G_AllocStep > 0.0 && mod->written + G_ChunkSize > mod->alloc) {
+		if (fallocate(mod->fd, FALLOC_FL_KEEP_SIZE, (off_t)mod->alloc,
+					  (off_t)G_AllocStep) == 0)
+			mod->alloc += G_AllocStep;
+		else
+			G_AllocStep = 0.0;		/* not supported by the filesystem */
+	}
+
+	for (done=0; done<G_ChunkSize; done+=n) {
+		n = write(mod->fd, chunk + done, G_ChunkSize - done);
+		if (n < 0 && errno == EINTR) {
+			n = 0;
+			continue;
+		}
+		if (n <= 0) {
+			G_WrErr = n < 0 ? errno : ENOSPC;
+			return( -1 );
+		}
+	}
+	mod->written += G_ChunkSize;
+
+	return( 0 );
+}
+
+/********************************* TimeSec **********************************
+ *
+ *  Description: Monotonic time
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: return		time [s]
+ *  Globals....: -
+ ****************************************************************************/
+static double TimeSec(void)
+{
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return( ts.tv_sec + ts.tv_nsec / 1000000000.0 );
+}
+
+/********************************* PrintMdisError ***************************
+ *
+ *  Description: Print MDIS error message
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: device	device name
+ *               info	info string
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+
+static void PrintMdisError(char *device, char *info)
+{
+	printf("*** %s: can't %s: %s\n", device, info,
+		   M_errstring(UOS_ErrnoGet()));
+}
+
+#else /* LINUX */
+int main(void)
+{
+	printf("*** m34_record requires LINUX\n%s\n", IdentString);
+	return(1);
+}
+#endif /* LINUX */
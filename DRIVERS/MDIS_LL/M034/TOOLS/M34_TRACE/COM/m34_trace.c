@@ -0,0 +1,313 @@
+/****************************************************************************
+ ************                                                    ************
+ ************                M 3 4 _ T R A C E                   ************
+ ************                                                    ************
+ ****************************************************************************
+ *
+ *       Author: ds
+ *
+ *  Description: Configure, dump and decode the M34/M35 driver trace ring
+ *
+ *     Required: Libraries: mdis_api, usr_oss, usr_utl
+ *     Switches: -
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 2026, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <MEN/men_typs.h>
+#include <MEN/usr_oss.h>
+#include <MEN/usr_utl.h>
+#include <MEN/mdis_api.h>
+#include <MEN/m34_drv.h>
+
+static const char IdentString[]=MENT_XSTR(MAK_REVISION);
+
+/*--------------------------------------+
+|   DEFINES                             |
++--------------------------------------*/
+#define MAX_RECS	1024		/* more than the driver ring holds */
+
+/*--------------------------------------+
+|   TYPDEFS                             |
++--------------------------------------*/
+/* event decoding table entry */
+typedef struct {
+	u_int16	event;
+	char	*name;
+	char	*arg1;
+	char	*arg2;
+} EVENT_DESC;
+
+/*--------------------------------------+
+|   GLOBALS                             |
++--------------------------------------*/
+static const EVENT_DESC G_EventDesc[] = {
+	{ M34_TEV_READ,			"READ",			"value",	NULL		},
+	{ M34_TEV_BLKRD,		"BLKRD",		"size",		"irqmode"	},
+	{ M34_TEV_BLKRD_END,	"BLKRD_END",	"bytes",	"err"		},
+	{ M34_TEV_SETSTAT,		"SETSTAT",		"code",		"value"		},
+	{ M34_TEV_GETSTAT,		"GETSTAT",		"code",		NULL		},
+	{ M34_TEV_IRQ_FIX,		"IRQ_FIX",		"currch",	"skip"		},
+	{ M34_TEV_IRQ_CHIRQ,	"IRQ_CHIRQ",	"readch",	"gotwords"	},
+	{ M34_TEV_IRQ_LEGACY,	"IRQ_LEGACY",	"readch",	"irqcount"	},
+	{ M34_TEV_IRQ_DISABLE,	"IRQ_DISABLE",	"irqmode",	NULL		},
+	{ M34_TEV_BUF_READY,	"BUF_READY",	"words",	NULL		},
+	{ M34_TEV_BUF_NOSPACE,	"BUF_NOSPACE",	"irqmode",	NULL		},
+	{ M34_TEV_BUF_HIGH,		"BUF_HIGH",		"level",	"size"		},
+	{ M34_TEV_ERR_WRAP,		"ERR_WRAP",		"missing",	NULL		},
+	{ M34_TEV_ERR_NOCH,		"ERR_NOCH",		"irqmode",	NULL		},
+	{ M34_TEV_ERR_TIMEOUT,	"ERR_TIMEOUT",	"err",		NULL		},
+	{ M34_TEV_ERR_TRIG_LOST,"ERR_TRIG_LOST","period",	"elapsed"	},
+	{ M34_TEV_TMR_FRAME,	"TMR_FRAME",	"period",	"missed"	},
+	{ M34_TEV_IRQ_BURST,	"IRQ_BURST",	"index",	"skip"		},
+	{ M34_TEV_IRQ_ADAPT,	"IRQ_ADAPT",	"mode",		"irqrate"	},
+	{ 0,					NULL,			NULL,		NULL		}
+};
+
+static M34_TRACE_REC G_Recs[MAX_RECS];
+
+/*--------------------------------------+
+|   PROTOTYPES                          |
++--------------------------------------*/
+static void usage(void);
+static void PrintError(char *info);
+static void DumpRecs(M34_TRACE_REC *recs, int32 nbrRecs, u_int32 freq, int32 raw);
+
+/********************************* usage ************************************
+ *
+ *  Description: Print program usage
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void usage(void)
+{
+	printf("Usage: m34_trace [<opts>] <device> [<opts>]\n");
+	printf("Function: Configure, dump and decode the M34/M35 trace ring\n");
+	printf("Options:\n");
+	printf("    device       device name                 [none]\n");
+	printf("    -m=<mask>    set trace class mask (hex)  [unchanged]\n");
+	printf("                  01 = entry points\n");
+	printf("                  02 = isr branches\n");
+	printf("                  04 = buffer events\n");
+	printf("                  08 = errors\n");
+	printf("                  ff = all\n");
+	printf("    -c           clear trace ring            [no]\n");
+	printf("    -d           dump trace ring             [yes if no -m/-c]\n");
+	printf("    -r           dump raw records            [no]\n");
+	printf("\n");
+	printf("Copyright 2026, MEN Mikro Elektronik GmbH\n%s\n", IdentString);
+}
+
+/********************************* main *************************************
+ *
+ *  Description: Program main function
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: argc,argv	argument counter, data ..
+ *  Output.....: return	    success (0) or error (1)
+ *  Globals....: -
+ ****************************************************************************/
+int main(int argc, char *argv[])
+{
+	MDIS_PATH			path=0;
+	int32				n, mask, clear, dump, raw, freq, curMask, ret = 1;
+	char				*device, *str, *errstr, buf[40];
+	M_SETGETSTAT_BLOCK	blk;
+
+	/*--------------------+
+    |  check arguments    |
+    +--------------------*/
+	if ((errstr = UTL_ILLIOPT("m=cdr?", buf))) {	/* check args */
+		printf("*** %s\n", errstr);
+		return(1);
+	}
+
+	if (UTL_TSTOPT("?")) {						/* help requested ? */
+		usage();
+		return(1);
+	}
+
+	/*--------------------+
+    |  get arguments      |
+    +--------------------*/
+	for (device=NULL, n=1; n<argc; n++)
+		if (*argv[n] != '-') {
+			device = argv[n];
+			break;
+		}
+
+	if (!device) {
+		usage();
+		return(1);
+	}
+
+	mask  = ((str = UTL_TSTOPT("m=")) ? (int32)strtoul(str, NULL, 16) : -1);
+	clear = (UTL_TSTOPT("c") ? 1 : 0);
+	raw   = (UTL_TSTOPT("r") ? 1 : 0);
+	dump  = (UTL_TSTOPT("d") || raw || (mask == -1 && !clear)) ? 1 : 0;
+
+	/*--------------------+
+    |  open path          |
+    +--------------------*/
+	if ((path = M_open(device)) < 0) {
+		PrintError("open");
+		return(1);
+	}
+
+	/*--------------------+
+    |  dump               |
+    +--------------------*/
+	if (dump) {
+		if ((M_getstat(path, M34_TRACE_MASK, &curMask)) < 0) {
+			PrintError("getstat M34_TRACE_MASK");
+			goto abort;
+		}
+		if ((M_getstat(path, M34_TRACE_TSFREQ, &freq)) < 0) {
+			PrintError("getstat M34_TRACE_TSFREQ");
+			goto abort;
+		}
+
+		blk.size = sizeof(G_Recs);
+		blk.data = (void*)G_Recs;
+		if ((M_getstat(path, M34_BLK_TRACE, (int32*)&blk)) < 0) {
+			PrintError("getstat M34_BLK_TRACE");
+			goto abort;
+		}
+
+		printf("trace mask          : 0x%02x\n", (int)curMask);
+		printf("timestamp frequency : %d Hz\n", (int)freq);
+		printf("records             : %d\n\n",
+			   (int)(blk.size / sizeof(M34_TRACE_REC)));
+
+		DumpRecs(G_Recs, blk.size / sizeof(M34_TRACE_REC), (u_int32)freq, raw);
+	}
+
+	/*--------------------+
+    |  clear / set mask   |
+    +--------------------*/
+	if (clear) {
+		if ((M_setstat(path, M34_TRACE_CLEAR, 0)) < 0) {
+			PrintError("setstat M34_TRACE_CLEAR");
+			goto abort;
+		}
+	}
+
+	if (mask != -1) {
+		if ((M_setstat(path, M34_TRACE_MASK, mask)) < 0) {
+			PrintError("setstat M34_TRACE_MASK");
+			goto abort;
+		}
+		printf("trace mask set to 0x%02x\n", (int)mask);
+	}
+
+	ret = 0;
+
+	/*--------------------+
+    |  cleanup            |
+    +--------------------*/
+	abort:
+	if (M_close(path) < 0)
+		PrintError("close");
+
+	return(ret);
+}
+
+/********************************* DumpRecs *********************************
+ *
+ *  Description: Decode and print trace records
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: recs		trace records (oldest first)
+ *               nbrRecs	number of records
+ *               freq		timestamp frequency [Hz] (0=unknown)
+ *               raw		print raw records
+ *  Output.....: -
+ *  Globals....: G_EventDesc
+ ****************************************************************************/
+static void DumpRecs(M34_TRACE_REC *recs, int32 nbrRecs, u_int32 freq, int32 raw)
+{
+	int32				n;
+	const EVENT_DESC	*descP;
+	double				tRel, tDelta;
+	char				chStr[8];
+
+	if (freq)
+		printf("      time[us]    delta[us]  event        ch   arguments\n");
+	else
+		printf("     time[tck]   delta[tck]  event        ch   arguments\n");
+
+	for (n=0; n<nbrRecs; n++) {
+		tRel   = (double)(u_int32)(recs[n].tstamp - recs[0].tstamp);
+		tDelta = n ? (double)(u_int32)(recs[n].tstamp - recs[n-1].tstamp) : 0.0;
+		if (freq) {
+			tRel   = tRel * 1000000.0 / freq;
+			tDelta = tDelta * 1000000.0 / freq;
+		}
+
+		if (recs[n].ch == 0xffff)
+			strcpy(chStr, "-");
+		else
+			sprintf(chStr, "%d", recs[n].ch);
+
+		if (raw) {
+			printf("%14.1f %12.1f  0x%04x  %4s   0x%08x 0x%08x\n",
+				   tRel, tDelta, recs[n].event, chStr,
+				   (unsigned)recs[n].arg1, (unsigned)recs[n].arg2);
+			continue;
+		}
+
+		for (descP=G_EventDesc; descP->name; descP++)
+			if (descP->event == recs[n].event)
+				break;
+
+		if (descP->name == NULL) {
+			printf("%14.1f %12.1f  ?0x%04x      %4s   0x%08x 0x%08x\n",
+				   tRel, tDelta, recs[n].event, chStr,
+				   (unsigned)recs[n].arg1, (unsigned)recs[n].arg2);
+			continue;
+		}
+
+		printf("%14.1f %12.1f  %-12s %4s  ", tRel, tDelta, descP->name, chStr);
+		if (descP->arg1)
+			printf(" %s=0x%x", descP->arg1, (unsigned)recs[n].arg1);
+		if (descP->arg2)
+			printf(" %s=0x%x", descP->arg2, (unsigned)recs[n].arg2);
+		printf("\n");
+	}
+}
+
+/********************************* PrintError ********************************
+ *
+ *  Description: Print MDIS error message
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: info	info string
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+
+static void PrintError(char *info)
+{
+	printf("*** can't %s: %s\n", info, M_errstring(UOS_ErrnoGet()));
+}
@@ -55,6 +55,55 @@
 #ifdef WINNT
 #define M34_ISR_TIME              M_DEV_OF+0x08   /* G  : accumulated isr time */
 #endif
+#define M34_TRACE_MASK            M_DEV_OF+0x09   /* G,S: enabled trace classes */
+#define M34_TRACE_TSFREQ          M_DEV_OF+0x0a   /* G  : trace timestamp freq [Hz] */
+#define M34_TRACE_CLEAR           M_DEV_OF+0x0b   /*   S: clear trace ring */
+#define M34_ID_REFRESH            M_DEV_OF+0x0c   /*   S: re-read ID-PROM cache */
+#define M34_RESOLUTION            M_DEV_OF+0x0d   /* G  : ADC resolution 12/14 bit */
+#define M34_SAMPLE_RATE           M_DEV_OF+0x0e   /* G,S: frame rate [Hz] (IMODE_TIMER) */
+#define M34_READ_AHEAD            M_DEV_OF+0x0f   /* G,S: read-ahead blocks (IMODE_CHIRQ_AUTO) */
+#define M34_BATCH_FRAMES          M_DEV_OF+0x10   /* G,S: min frames per block read wakeup */
+#define M34_BATCH_LATENCY         M_DEV_OF+0x11   /* G,S: max wakeup latency [us] */
+#define M34_RD_NONBLOCK           M_DEV_OF+0x12   /* G,S: non-blocking block read */
+#define M34_RD_AVAIL              M_DEV_OF+0x13   /* G  : bytes ready in read buffer */
+#define M34_SIG_DATA_SET          M_DEV_OF+0x14   /*   S: install data ready signal */
+#define M34_SIG_DATA_CLR          M_DEV_OF+0x15   /*   S: remove data ready signal */
+#define M34_ASYNC_ENABLE          M_DEV_OF+0x16   /* G,S: async slot acquisition */
+#define M34_ASYNC_SUBMIT          M_DEV_OF+0x17   /* G,S: submit slots / get free slots */
+#define M34_ASYNC_RECSIZE         M_DEV_OF+0x18   /* G  : async block read record size */
+#define M34_CAPT_ENABLE           M_DEV_OF+0x19   /* G,S: triggered capture mode */
+#define M34_CAPT_RECSIZE          M_DEV_OF+0x1a   /* G  : capture record size */
+#define M34_FRAME_ALIGN           M_DEV_OF+0x1b   /* G,S: frame aligned read buffer */
+#define M34_RD_LEVEL_MAX          M_DEV_OF+0x1c   /* G,S: max read buffer level (S: reset) */
+#define M34_SETTLE_CAL            M_DEV_OF+0x1d   /* G,S: settle calibration / frame rate */
+#define M34_DEFER_MASK            M_DEV_OF+0x1e   /* G,S: work done in deferred stage */
+#define M34_POLL_OWNER            M_DEV_OF+0x1f   /* G,S: registers owned by user space */
+#define M34_BURST_RATE            M_DEV_OF+0x20   /* G  : sample rate of last burst [Hz] */
+#define M34_RD_RAW                M_DEV_OF+0x21   /* G,S: block read returns raw bus words */
+#define M34_RAW_SWAPPED           M_DEV_OF+0x22   /* G  : raw words are byte swapped */
+#define M34_TRIG_LOST_K           M_DEV_OF+0x23   /* G,S: trigger lost after k periods */
+#define M34_TRIG_PERIOD           M_DEV_OF+0x24   /* G  : estimated trigger period [us] */
+#define M34_TRIG_JITTER           M_DEV_OF+0x25   /* G  : estimated trigger jitter [us] */
+#define M34_SIG_TRIG_SET          M_DEV_OF+0x26   /*   S: install trigger lost signal */
+#define M34_SIG_TRIG_CLR          M_DEV_OF+0x27   /*   S: remove trigger lost signal */
+#define M34_IRQ_ADAPT             M_DEV_OF+0x28   /* G,S: adaptive irq mode 0/1 switching */
+#define M34_ADAPT_IRQ_RATE        M_DEV_OF+0x29   /* G,S: max irq rate [Hz] for mode 1 */
+#define M34_ADAPT_ISR_LOAD        M_DEV_OF+0x2a   /* G,S: isr load [%] for mode 0 -> 1 */
+#define M34_LAT_SAMPLE            M_DEV_OF+0x2b   /* G,S: latency trace every n-th frame */
+#define M34_LAT_TSTAMP            M_DEV_OF+0x2c   /* G  : current latency timestamp */
+#define M34_ISR_STATS             M_DEV_OF+0x2d   /* G,S: isr time statistics 0/1 */
+
+/*--------- M34 specific block codes (M_DEV_BLK_OF...M_DEV_BLK_OF+0xff) ----*/
+#define M34_BLK_TRACE             M_DEV_BLK_OF+0x00 /* G  : read trace ring */
+#define M34_BLK_CH_CFG            M_DEV_BLK_OF+0x01 /* G,S: channel config table */
+#define M34_BLK_MULTI_READ        M_DEV_BLK_OF+0x02 /* G  : read channel list */
+#define M34_BLK_TELEMETRY         M_DEV_BLK_OF+0x03 /* G  : acquisition statistics */
+#define M34_BLK_CAPT_CFG          M_DEV_BLK_OF+0x04 /* G,S: capture trigger config */
+#define M34_BLK_LAT               M_DEV_BLK_OF+0x05 /* G  : read latency records */
+
+/*--------- M34 specific error codes (ERR_DEV...ERR_DEV+0xff) --------------*/
+#define M34_ERR_TRIG_LOST         (ERR_DEV+0x01)  /* no trigger edge (M34_TRIG_LOST_K) */
+#define M34_ERR_IRQ_ADAPT         (ERR_DEV+0x02)  /* irq mode switched (M34_IRQ_ADAPT) */
 
 /*------ set/getstat and descriptor values --------*/
 #define M34_IS_DIFFERENTIAL		0
@@ -72,10 +121,208 @@
 #define M34_IMODE_CHIRQ			1		/*	yes  |      yes    | yes  |	   no  |   yes   */
 #define M34_IMODE_CHIRQ_AUTO	2		/*	yes  |       no    | yes  |	  yes  |   yes   */
 #define M34_IMODE_FIX			3		/*	 no  |       no    | yes  |	  yes  |    no   */
+#define M34_IMODE_TIMER			4		/*	yes  |      yes    |  no  |	   no  |    no   */
+#define M34_IMODE_BURST			5		/*	 no  |       no    | yes  |	  yes  |    no   */
+
+#define M34_SAMPLE_RATE_MAX		1000	/* M34_IMODE_TIMER: max frame rate [Hz] */
+#define M34_READ_AHEAD_MAX		64		/* M34_IMODE_CHIRQ_AUTO: max read-ahead blocks */
+#define M34_BATCH_LATENCY_MAX	10000000	/* max wakeup latency [us] */
+#define M34_ASYNC_SLOTS_MAX		64		/* max async slots */
+#define M34_ASYNC_SLOT_SIZE_MAX	0x10000	/* max async slot data size [byte] */
+#define M34_CAPT_FRAMES_MAX		0x10000	/* max capture history [frames] */
+#define M34_RD_LATENCY_MAX		10000	/* max M34_RD_LATENCY [ms] */
+#define M34_RD_RATE_MAX			100000	/* max M34_RD_RATE [Hz] */
+#define M34_RD_BUF_AUTO_MAX		0x100000 /* max computed read buffer [byte] */
+#define M34_STAGE_FRAMES_MAX	4096	/* max staging ring size [frames] */
+#define M34_BURST_POLL_MAX		1024	/* M34_IMODE_BURST, M_BUF_USRCTRL: max
+										   samples per block read */
+#define M34_TRIG_LOST_K_MAX		1000	/* max M34_TRIG_LOST_K [periods] */
+#define M34_ADAPT_IRQ_RATE_MAX	1000000	/* max M34_ADAPT_IRQ_RATE [Hz] */
+#define M34_LAT_TSFREQ_MIN		1000000	/* M34_LAT_SAMPLE: min M34_TRACE_TSFREQ [Hz] */
+
+/* deferred stage work (M34_DEFER_MASK) */
+#define M34_DEFER_PUBLISH		0x01	/* frame publishing (mode 0/4) */
+#define M34_DEFER_WAKEUP		0x02	/* reader wakeups and data signal */
+
+/* capture trigger source (M34_CAPT_CFG.source) */
+#define M34_CAPT_EXT_RISE		0		/* EXT pin (data bit 1) 0->1 */
+#define M34_CAPT_EXT_FALL		1		/* EXT pin (data bit 1) 1->0 */
+#define M34_CAPT_LVL_RISE		2		/* channel value rises to level */
+#define M34_CAPT_LVL_FALL		3		/* channel value falls to level */
 
 #define M34_UNIPOLAR			0
 #define M34_BIPOLAR				1
 
+#define M34_SETTLE_MAX			10		/* max additional dummy reads per ch */
+
+#define M34_MRD_GAIN			0x01	/* M34_MULTI_READ: use entry gain */
+#define M34_MRD_BIPOLAR			0x02	/* M34_MULTI_READ: use entry bipolar */
+
+/* swap the bytes of two raw words at once (M34_RD_RAW, M34_RAW_SWAPPED) */
+#define M34_SWAP16X2(w)			((u_int32)( (((w) & 0x00ff00ff) << 8) | \
+											(((w) >> 8) & 0x00ff00ff) ))
+
+/*------ trace classes (M34_TRACE_MASK) --------*/
+#define M34_TCL_CALL			0x01	/* driver entry points */
+#define M34_TCL_IRQ				0x02	/* isr branches */
+#define M34_TCL_BUF				0x04	/* buffer events */
+#define M34_TCL_ERR				0x08	/* errors */
+#define M34_TCL_ALL				0xff
+
+/*------ trace event ids (class in high byte) --------*/
+#define M34_TEV(cls,nbr)		((u_int16)(((cls)<<8) | (nbr)))
+#define M34_TEV_CLASS(ev)		((ev)>>8)
+
+										/* arg1          | arg2       */
+#define M34_TEV_READ		M34_TEV(M34_TCL_CALL,0x01)	/* value    | -          */
+#define M34_TEV_BLKRD		M34_TEV(M34_TCL_CALL,0x02)	/* size     | irq mode   */
+#define M34_TEV_BLKRD_END	M34_TEV(M34_TCL_CALL,0x03)	/* got bytes| error      */
+#define M34_TEV_SETSTAT		M34_TEV(M34_TCL_CALL,0x04)	/* code     | value      */
+#define M34_TEV_GETSTAT		M34_TEV(M34_TCL_CALL,0x05)	/* code     | -          */
+#define M34_TEV_IRQ_FIX		M34_TEV(M34_TCL_IRQ,0x01)	/* curr ch  | skip       */
+#define M34_TEV_IRQ_CHIRQ	M34_TEV(M34_TCL_IRQ,0x02)	/* read ch  | got words  */
+#define M34_TEV_IRQ_LEGACY	M34_TEV(M34_TCL_IRQ,0x03)	/* read ch  | irq count  */
+#define M34_TEV_IRQ_DISABLE	M34_TEV(M34_TCL_IRQ,0x04)	/* irq mode | -          */
+#define M34_TEV_TMR_FRAME	M34_TEV(M34_TCL_IRQ,0x05)	/* period   | missed     */
+#define M34_TEV_IRQ_BURST	M34_TEV(M34_TCL_IRQ,0x06)	/* index    | skip       */
+#define M34_TEV_IRQ_ADAPT	M34_TEV(M34_TCL_IRQ,0x07)	/* new mode | irq rate   */
+#define M34_TEV_BUF_READY	M34_TEV(M34_TCL_BUF,0x01)	/* words    | -          */
+#define M34_TEV_BUF_NOSPACE	M34_TEV(M34_TCL_BUF,0x02)	/* irq mode | -          */
+#define M34_TEV_BUF_HIGH	M34_TEV(M34_TCL_BUF,0x03)	/* level    | size       */
+#define M34_TEV_ERR_WRAP	M34_TEV(M34_TCL_ERR,0x01)	/* missing  | -          */
+#define M34_TEV_ERR_NOCH	M34_TEV(M34_TCL_ERR,0x02)	/* irq mode | -          */
+#define M34_TEV_ERR_TIMEOUT	M34_TEV(M34_TCL_ERR,0x03)	/* error    | -          */
+#define M34_TEV_ERR_TRIG_LOST	M34_TEV(M34_TCL_ERR,0x04)	/* period   | elapsed    */
+
+/*-----------------------------------------+
+|  TYPEDEFS                                |
++------------------------------------------*/
+/* trace record (M34_BLK_TRACE) */
+typedef struct
+{
+	u_int32	tstamp;		/* timestamp (see M34_TRACE_TSFREQ) */
+	u_int16	event;		/* event id M34_TEV_xxx */
+	u_int16	ch;			/* channel (0xffff if not applicable) */
+	u_int32	arg1;		/* event specific argument */
+	u_int32	arg2;		/* event specific argument */
+} M34_TRACE_REC;
+
+/*
+ * latency record of a sampled frame (M34_BLK_LAT), timestamps see
+ * M34_TRACE_TSFREQ. The application adds M34_LAT_TSTAMP got right after
+ * its block read number rdSeq.
+ */
+typedef struct
+{
+	u_int32	frame;		/* frame number since M34_LAT_SAMPLE set (1..) */
+	u_int32	rdSeq;		/* block read number since M34_LAT_SAMPLE set (1..) */
+	u_int32	tIsr;		/* isr entry of the frame start (timer: callback) */
+	u_int32	tFrame;		/* frame converted */
+	u_int32	tReady;		/* frame ready in read buffer (MBUF_ReadyBuf) */
+	u_int32	tWake;		/* block read returned from MBUF_Read with it */
+	u_int32	tRet;		/* block read returns */
+} M34_LAT_REC;
+
+/* channel config table entry (M34_BLK_CH_CFG), entry n is channel n */
+typedef struct
+{
+	u_int8	gain;		/* M34_GAIN_1..M34_GAIN_8 */
+	u_int8	bipolar;	/* M34_UNIPOLAR/M34_BIPOLAR */
+	u_int8	rdBlkIrq;	/* read ch in blk rd and irq (0/1) */
+	u_int8	settle;		/* additional dummy reads 0..M34_SETTLE_MAX */
+} M34_CH_CFG;
+
+/*
+ * acquisition statistics (M34_BLK_TELEMETRY)
+ * append only: new members are added at the end, the driver returns
+ * min(blockStruct->size, sizeof(M34_TELEMETRY)) bytes
+ */
+typedef struct
+{
+	u_int32	tsFreq;			/* time unit of the periods [Hz] (0=unknown) */
+	/* M34_IMODE_TIMER (reset at start) */
+	u_int32	tmrFrames;		/* frames stored */
+	u_int32	tmrMissed;		/* frames lost (no buffer space) */
+	u_int32	tmrPeriod;		/* nominal timer period */
+	/* timestamp of 10 kHz or more only: else 0 */
+	u_int32	tmrPeriodMin;	/* min measured period */
+	u_int32	tmrPeriodMax;	/* max measured period */
+	u_int32	tmrJitterMax;	/* max deviation from nominal period */
+	/* read buffer (reset with M34_RD_LEVEL_MAX) */
+	u_int32	rdBufSize;		/* read buffer size [byte] */
+	u_int32	rdLevelMax;		/* max ready data in read buffer [byte] */
+	u_int32	rdLevelWarn;	/* level reached 7/8 of the buffer size */
+	/* deferred stage */
+	u_int32	stageLost;		/* frames lost (staging ring full) */
+	u_int32	stageMax;		/* max staged frames */
+	/* external trigger, irq mode 0/1 (reset at start) */
+	u_int32	trigEdges;		/* trigger edges */
+	u_int32	trigPeriod;		/* estimated period (running average),
+							   0: too short for the timestamp */
+	u_int32	trigJitter;		/* estimated jitter (mean deviation) */
+	u_int32	trigLost;		/* trigger loss events (M34_TRIG_LOST_K) */
+	/* adaptive irq mode, M34_IRQ_ADAPT (reset at start) */
+	u_int32	adaptMode;		/* current isr strategy (M34_IMODE_LEGACY/CHIRQ) */
+	u_int32	adaptSwitches;	/* strategy switches */
+	u_int32	adaptIrqRate;	/* irq rate of the last window [Hz] */
+	u_int32	adaptIsrLoad;	/* isr load of the last window [%] */
+	/* read buffer (reset with M34_RD_LEVEL_MAX) */
+	u_int32	rdLost;			/* frames dropped or overwritten, read buffer
+							   full (irq mode 1: per channels of a frame) */
+	/* isr time, M34_ISR_STATS only: else 0 (reset with M_LL_IRQ_COUNT) */
+	u_int32	isrCount;		/* timed irqs */
+	u_int32	isrTime;		/* sum of isr times */
+	u_int32	isrTimeMax;		/* max isr time */
+} M34_TELEMETRY;
+
+/*
+ * async block read record (M34_ASYNC_ENABLE): header followed by the slot
+ * data, records are M34_ASYNC_RECSIZE bytes apart
+ */
+typedef struct
+{
+	u_int32	seq;		/* slot sequence number (free running) */
+	u_int32	tstamp;		/* timestamp of first frame (see M34_TRACE_TSFREQ) */
+	u_int32	bytes;		/* valid data bytes (complete frames) */
+	u_int32	lost;		/* acquisitions dropped before this slot (no slot) */
+} M34_ASYNC_HDR;
+
+/* capture trigger config (M34_BLK_CAPT_CFG) */
+typedef struct
+{
+	u_int8	source;		/* M34_CAPT_XXX */
+	u_int8	ch;			/* level channel (must be read in blk rd/irq) */
+	u_int16	hyst;		/* level hysteresis [raw] */
+	int32	level;		/* trigger level [raw, signed if ch is bipolar] */
+	u_int32	pre;		/* frames before the trigger frame */
+	u_int32	post;		/* frames after the trigger frame */
+} M34_CAPT_CFG;
+
+/*
+ * capture record (M34_CAPT_ENABLE): header followed by frames*frameWords
+ * values, oldest frame first
+ */
+typedef struct
+{
+	u_int32	seq;		/* capture sequence number (free running) */
+	u_int32	tstamp;		/* trigger timestamp (see M34_TRACE_TSFREQ) */
+	u_int32	frames;		/* frames in record */
+	u_int32	trigPos;	/* index of the trigger frame in record */
+	u_int32	frameWords;	/* values per frame (blk rd/irq channels) */
+	u_int32	lost;		/* acquisitions dropped while record was pending */
+} M34_CAPT_HDR;
+
+/* channel list entry (M34_BLK_MULTI_READ) */
+typedef struct
+{
+	u_int8	ch;			/* channel to read */
+	u_int8	flags;		/* M34_MRD_XXX, else channel config is used */
+	u_int8	gain;		/* M34_GAIN_1..M34_GAIN_8 (with M34_MRD_GAIN) */
+	u_int8	bipolar;	/* M34_UNIPOLAR/M34_BIPOLAR (with M34_MRD_BIPOLAR) */
+	u_int16	value;		/* returned: read value */
+	u_int16	reserved;
+} M34_MULTI_READ;
+
 /******************************* M34_CALC_VOLTAGE ***************************
  *
  *  Description:  Macro for calculating voltage
@@ -0,0 +1,121 @@
+/***********************  I n c l u d e  -  F i l e  ************************
+ *
+ *         Name: m34_model.h
+ *
+ *      Author: ds
+ *
+ *  Description: M34/M35 register model for user space tools
+ *               (m34_poll, m34_lat) to run the scan sequence of
+ *               m34_scan.h without a device
+ *
+ *               The input multiplexer settles <settle> conversions
+ *               after a channel switch, until then the previous input
+ *               is converted. The value of an input is
+ *               0x8000 | its control word (without CTRL_IRQ) << 4, so a
+ *               conversion before the first switch (0) is recognized as
+ *               wrong too.
+ *
+ *               Include after m34_scan.h (register offsets).
+ *
+ *     Switches: -
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 2026, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _M34_MODEL_H
+#  define _M34_MODEL_H
+
+#  ifdef __cplusplus
+      extern "C" {
+#  endif
+
+/*-----------------------------------------+
+|  TYPEDEFS                                |
++------------------------------------------*/
+typedef struct {
+	u_int16	ctrl;		/* control register */
+	u_int16	data;		/* last conversion */
+	u_int16	prev;		/* input before the last switch */
+	u_int32	conv;		/* conversions since the last switch */
+	u_int32	settle;		/* conversions until settled */
+} M34_MODEL;
+
+/*-----------------------------------------+
+|  FUNCTIONS                               |
++------------------------------------------*/
+/* settled input value */
+static u_int16 M34_ModelInput(u_int16 ctrl)
+{
+	return( (u_int16)(0x8000 | ((ctrl & 0xff & ~(1 << CTRL_IRQ)) << 4)) );
+}
+
+/* set control word (channel switch) */
+static void M34_ModelSwitch(M34_MODEL *m, u_int16 ctrl)
+{
+	m->prev = m->conv > m->settle ? M34_ModelInput(m->ctrl) : m->prev;
+	m->ctrl = ctrl;
+	m->conv = 0;
+}
+
+/* conversion */
+static void M34_ModelConv(M34_MODEL *m)
+{
+	m->conv++;
+	m->data = m->conv > m->settle ? M34_ModelInput(m->ctrl) : m->prev;
+}
+
+/* register read */
+static u_int16 M34_ModelRd(M34_MODEL *m, u_int32 offs)
+{
+	u_int16	val;
+
+	switch (offs) {
+	case M34_DATA_RD:
+		return( m->data );
+	case M34_DATA_START_RD:
+		M34_ModelConv(m);
+		return( m->data );
+	case M34_DATA_START_RD_INC:
+		M34_ModelConv(m);
+		val = m->data;
+		M34_ModelSwitch(m, (u_int16)((m->ctrl & ~M34_CTRL_CH_MASK) |
+									 ((m->ctrl + 1) & M34_CTRL_CH_MASK)));
+		return( val );
+	default:
+		return( 0xffff );
+	}
+}
+
+/* register write */
+static void M34_ModelWr(M34_MODEL *m, u_int32 offs, u_int16 val)
+{
+	switch (offs) {
+	case M34_CTRL_WR:
+		M34_ModelSwitch(m, val);
+		break;
+	case M34_CTRL_START_WR:
+		M34_ModelSwitch(m, val);
+		M34_ModelConv(m);
+		break;
+	}
+}
+
+#  ifdef __cplusplus
+      }
+#  endif
+
+#endif/*_M34_MODEL_H*/
@@ -0,0 +1,119 @@
+/***********************  I n c l u d e  -  F i l e  ************************
+ *
+ *         Name: m34_scan.h
+ *
+ *      Author: ds
+ *
+ *  Description: M34/M35 register layout and channel scan sequence
+ *               shared by the driver and user space register access
+ *               (m34_poll busy-poll tool)
+ *               - register offsets and control word layout
+ *               - settle handling (dummy conversions) per channel
+ *
+ *               The register access defaults to the MACCESS macros.
+ *               A user of the header may define all of the following
+ *               before including it, e.g. to run the scan against a
+ *               register model:
+ *
+ *                 M34_SCAN_MA              type of the register window
+ *                 M34_SCAN_RD(ma,offs)     16-bit register read
+ *                 M34_SCAN_WR(ma,offs,val) 16-bit register write
+ *
+ *     Switches: -
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 2026, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _M34_SCAN_H
+#  define _M34_SCAN_H
+
+#  ifdef __cplusplus
+      extern "C" {
+#  endif
+
+/*-----------------------------------------+
+|  DEFINES & CONST                         |
++------------------------------------------*/
+#define M34_ADDRSPACE_SIZE	  0x100	/* size of the register window */
+
+/*--------------------- M34 register defs/offsets ------------------------*/
+#define M34_DATA_RD           0x00  /* read converted data */
+#define M34_CTRL_WR           0x00  /* set control data  */
+#define M34_DATA_RD_START     0x02  /* read data, start conv. */
+#define M34_CTRL_START_WR     0x02  /* start conv., set control data  */
+#define M34_DATA_RD_START_INC 0x06  /* read data, start conv., incr. */
+#define M34_DATA_START_RD     0x0A  /* start conv., read data */
+#define M34_DATA_START_RD_INC 0x0E  /* start conv., read data, incr. */
+#define M34_MODID			  0xFE  /* module id register */
+#define M34_MODID_BUSERBIT	  0x04  /* bit to prevent bus error */
+
+/*--------------------------- control word -------------------------------*/
+#define CTRL_IRQ			  4		/* bit shifts */
+#define CTRL_GAIN			  5		/* bit shifts */
+#define CTRL_BIPOLAR		  7		/* bit shifts */
+
+#define M34_CTRL_CH_MASK	  0x0f	/* channel field (incremented by hw) */
+
+/* control word for a channel with irq disabled */
+#define M34_CTRL_WORD(ch,gain,bipolar)					\
+	((u_int16)( ((ch) & M34_CTRL_CH_MASK)				\
+			  | ((gain) << CTRL_GAIN)					\
+			  | ((bipolar) << CTRL_BIPOLAR) ))
+
+/*---------------------------- register access ---------------------------*/
+#ifndef M34_SCAN_MA
+# define M34_SCAN_MA				MACCESS
+# define M34_SCAN_RD(ma,offs)		MREAD_D16(ma,offs)
+# define M34_SCAN_WR(ma,offs,val)	MWRITE_D16(ma,offs,val)
+#endif
+
+/*----------------------------- scan sequence ----------------------------*/
+/*
+ * Channel read sequence (all irq modes except M34_IMODE_FIX):
+ *
+ *   M34_SCAN_SETTLE( ma, ctrl, nbrDummy );   set channel, let input settle
+ *   val = M34_SCAN_CONV( ma );               conversion
+ *
+ * nbrDummy is the per channel dummy read count (M34_DUMMY_READS + channel
+ * settle), at least one dummy conversion is always done.
+ *
+ * M34_SCAN_CONV_INC() increments the channel field of the control word
+ * after the conversion, so consecutive channels with the same gain and
+ * polarity need no control write, only M34_SCAN_DUMMY(). It must not be
+ * used for channel 15 (the increment would carry into CTRL_IRQ).
+ */
+#define M34_SCAN_DUMMY(ma,nbrDummy)								\
+	do {														\
+		u_int32 _t_;											\
+		for( _t_=0; _t_<=(u_int32)(nbrDummy); _t_++ )			\
+			(void)M34_SCAN_RD( ma, M34_DATA_START_RD );			\
+	} while(0)
+
+#define M34_SCAN_SETTLE(ma,ctrl,nbrDummy)						\
+	do {														\
+		M34_SCAN_WR( ma, M34_CTRL_WR, ctrl );					\
+		M34_SCAN_DUMMY( ma, nbrDummy );							\
+	} while(0)
+
+#define M34_SCAN_CONV(ma)		M34_SCAN_RD( ma, M34_DATA_START_RD )
+#define M34_SCAN_CONV_INC(ma)	M34_SCAN_RD( ma, M34_DATA_START_RD_INC )
+
+#  ifdef __cplusplus
+      }
+#  endif
+
+#endif/*_M34_SCAN_H*/